@@ -0,0 +1,89 @@
+/**
+ * @file AsyncResult.h
+ * @brief Eagerly started asynchronous result that a coroutine can co_await
+ */
+#pragma once
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+/**
+ * @class AsyncResult
+ * @brief Single-assignment result of work that is already running
+ *
+ * The coroutine-side counterpart of std::future: the producer calls setValue() or
+ * setException() once, and a coroutine that co_awaits the result is suspended
+ * without holding a thread until then. The awaiting coroutine resumes on the
+ * producer's thread; hop with CoroutineScheduler::schedule() for anything long.
+ * Copies share the same result, and only one coroutine may await it.
+ */
+template<class T>
+class AsyncResult {
+private:
+    struct State {
+        std::mutex mutex;
+        std::optional<T> value;
+        std::exception_ptr error;
+        bool done = false;
+        std::coroutine_handle<> waiter;
+    };
+
+    std::shared_ptr<State> state;
+
+    void complete() const {
+        std::coroutine_handle<> waiter;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->done = true;
+            waiter = std::exchange(state->waiter, nullptr);
+        }
+        if (waiter) {
+            waiter.resume();
+        }
+    }
+
+public:
+    AsyncResult() : state(std::make_shared<State>()) {}
+
+    void setValue(T value) const {
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->value.emplace(std::move(value));
+        }
+        complete();
+    }
+
+    void setException(std::exception_ptr error) const {
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->error = error;
+        }
+        complete();
+    }
+
+    bool await_ready() const {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->done;
+    }
+
+    // Returns false, resuming at once, when the result arrived in the meantime
+    bool await_suspend(std::coroutine_handle<> awaiting) const {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->done) {
+            return false;
+        }
+        state->waiter = awaiting;
+        return true;
+    }
+
+    T await_resume() const {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->error) {
+            std::rethrow_exception(state->error);
+        }
+        return std::move(*state->value);
+    }
+};
\ No newline at end of file
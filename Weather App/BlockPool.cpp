@@ -0,0 +1,129 @@
+/**
+ * @file BlockPool.cpp
+ * @brief Implementation of the BlockPool class
+ */
+#include "BlockPool.h"
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace {
+    constexpr size_t kSizeClasses = BlockPool::kMaxBlockSize / BlockPool::kBlockSize;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    // A chain of kBatchSize free blocks, linked through their first word
+    struct Batch {
+        FreeBlock* head;
+    };
+
+    constexpr size_t kBatchSize = BlockPool::kMaxCachedBlocks / 2;
+
+    // Full batches handed between threads, so blocks freed on one thread can serve allocations on another
+    struct Depot {
+        std::mutex mutex;
+        std::vector<Batch> batches[kSizeClasses];
+    };
+
+    Depot& depot() {
+        // Never destroyed: threads may still return blocks during static destruction
+        static Depot* instance = new Depot();
+        return *instance;
+    }
+
+    struct ThreadCache {
+        FreeBlock* lists[kSizeClasses] = {};
+        size_t counts[kSizeClasses] = {};
+
+        ~ThreadCache();
+    };
+
+    enum class CacheState { Unused, Alive, Destroyed };
+
+    thread_local ThreadCache cache;
+    // Trivially destructible, so it stays readable while later thread_locals release blocks
+    thread_local CacheState cacheState = CacheState::Unused;
+
+    ThreadCache::~ThreadCache() {
+        cacheState = CacheState::Destroyed;
+        for (FreeBlock*& list : lists) {
+            while (list) {
+                ::operator delete(std::exchange(list, list->next));
+            }
+        }
+    }
+
+    ThreadCache* currentCache() {
+        if (cacheState == CacheState::Unused) {
+            cacheState = CacheState::Alive;
+        }
+        // Naming the cache constructs it on first use and registers its destructor
+        return cacheState == CacheState::Alive ? &cache : nullptr;
+    }
+
+    size_t sizeClass(size_t bytes) {
+        return bytes == 0 ? 0 : (bytes - 1) / BlockPool::kBlockSize;
+    }
+}
+
+void* BlockPool::allocate(size_t bytes) {
+    if (bytes > kMaxBlockSize) {
+        return ::operator new(bytes);
+    }
+    size_t index = sizeClass(bytes);
+    ThreadCache* local = currentCache();
+    if (!local) {
+        return ::operator new((index + 1) * kBlockSize);
+    }
+
+    if (!local->lists[index]) {
+        Depot& shared = depot();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        if (shared.batches[index].empty()) {
+            return ::operator new((index + 1) * kBlockSize);
+        }
+        local->lists[index] = shared.batches[index].back().head;
+        local->counts[index] = kBatchSize;
+        shared.batches[index].pop_back();
+    }
+    FreeBlock* block = local->lists[index];
+    local->lists[index] = block->next;
+    local->counts[index]--;
+    return block;
+}
+
+void BlockPool::deallocate(void* block, size_t bytes) noexcept {
+    if (!block) {
+        return;
+    }
+    size_t index = sizeClass(bytes);
+    ThreadCache* local = bytes > kMaxBlockSize ? nullptr : currentCache();
+    if (!local) {
+        ::operator delete(block);
+        return;
+    }
+
+    if (local->counts[index] == kMaxCachedBlocks) {
+        // Hand the oldest half to the depot, for threads that allocate more than they free
+        FreeBlock* kept = local->lists[index];
+        for (size_t i = 1; i < kMaxCachedBlocks - kBatchSize; ++i) {
+            kept = kept->next;
+        }
+        Batch batch{ std::exchange(kept->next, nullptr) };
+        local->counts[index] -= kBatchSize;
+        try {
+            Depot& shared = depot();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            shared.batches[index].push_back(batch);
+        }
+        catch (...) {
+            while (batch.head) {
+                ::operator delete(std::exchange(batch.head, batch.head->next));
+            }
+        }
+    }
+    local->lists[index] = ::new (block) FreeBlock{ local->lists[index] };
+    local->counts[index]++;
+}
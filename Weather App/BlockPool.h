@@ -0,0 +1,66 @@
+/**
+ * @file BlockPool.h
+ * @brief Per-thread free lists of small fixed-size blocks, and an allocator on top of them
+ */
+#pragma once
+#include <cstddef>
+#include <new>
+
+/**
+ * @class BlockPool
+ * @brief Recycles small allocations through per-thread free lists
+ *
+ * Requests are rounded up to a multiple of kBlockSize and served from the
+ * calling thread's free list of that size, falling back to operator new when
+ * the list is empty or the request is larger than kMaxBlockSize. A block may be
+ * released on any thread; it joins that thread's list, up to
+ * kMaxCachedBlocks per size, and goes back to operator delete beyond that or
+ * when the thread exits. Blocks are never shared between threads while cached,
+ * so no lock is taken.
+ */
+class BlockPool {
+public:
+    static constexpr size_t kBlockSize = 64;
+    static constexpr size_t kMaxBlockSize = 256;
+    static constexpr size_t kMaxCachedBlocks = 512;
+
+    static void* allocate(size_t bytes);
+    static void deallocate(void* block, size_t bytes) noexcept;
+};
+
+/**
+ * @class BlockPoolAllocator
+ * @brief Standard allocator over BlockPool, for shared states such as std::promise's
+ */
+template<class T>
+class BlockPoolAllocator {
+public:
+    using value_type = T;
+
+    BlockPoolAllocator() noexcept = default;
+    template<class U>
+    BlockPoolAllocator(const BlockPoolAllocator<U>&) noexcept {}
+
+    T* allocate(size_t count) {
+        if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(alignof(T))));
+        }
+        else {
+            return static_cast<T*>(BlockPool::allocate(count * sizeof(T)));
+        }
+    }
+
+    void deallocate(T* pointer, size_t count) noexcept {
+        if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            ::operator delete(pointer, std::align_val_t(alignof(T)));
+        }
+        else {
+            BlockPool::deallocate(pointer, count * sizeof(T));
+        }
+    }
+
+    template<class U>
+    bool operator==(const BlockPoolAllocator<U>&) const noexcept { return true; }
+    template<class U>
+    bool operator!=(const BlockPoolAllocator<U>&) const noexcept { return false; }
+};
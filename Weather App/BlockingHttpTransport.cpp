@@ -0,0 +1,75 @@
+/**
+ * @file BlockingHttpTransport.cpp
+ * @brief Implementation of the BlockingHttpTransport class
+ */
+#include "BlockingHttpTransport.h"
+
+// Stops a leased client when the token is cancelled, for as long as it is in scope
+class CancelRegistration {
+private:
+    const CancellationToken& token;
+    size_t id;
+
+public:
+    CancelRegistration(const CancellationToken& token, HttpClientPool::Lease& client)
+        : token(token), id(token.onCancel([&client](CancelReason) { client->stop(); })) {
+    }
+    ~CancelRegistration() { token.removeCallback(id); }
+};
+
+void BlockingHttpTransport::get(Request request, ResponseHandler onResponse, ContentReceiver onContent, Completion done) {
+    Response response;
+    auto cli = clientPool.acquire(request.host);
+    cli->set_connection_timeout(request.timeouts.connectTimeout);
+    cli->set_read_timeout(request.timeouts.readTimeout);
+    cli->set_write_timeout(request.timeouts.readTimeout);
+    // Compressed bodies are passed through; the caller decodes them as they stream in
+    cli->set_decompress(false);
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+    cli->enable_server_certificate_verification(tls.verifyPeer);
+    if (!tls.caFile.empty()) {
+        cli->set_ca_cert_path(tls.caFile.c_str());
+    }
+#endif
+
+    httplib::Result res;
+    {
+        CancelRegistration registration(request.token, cli);
+        if (request.token.isCancelled()) {
+            response.error = "Canceled";
+            done(std::move(response));
+            return;
+        }
+
+        res = cli->Get(request.path, request.headers,
+            [&onResponse](const httplib::Response& r) {
+                Response head;
+                head.status = r.status;
+                head.headers = r.headers;
+                return onResponse(head);
+            },
+            [&onContent](const char* data, size_t length) { return onContent(data, length); });
+    }
+
+    if (!res || request.token.isCancelled()) {
+        // Transport error or stopped mid-request - don't hand the connection to the next request
+        cli.discard();
+    }
+    if (res) {
+        response.status = res->status;
+        response.headers = res->headers;
+    }
+    else {
+        response.error = httplib::to_string(res.error());
+    }
+    done(std::move(response));
+}
+
+void BlockingHttpTransport::configure(size_t maxConnectionsPerHost, std::chrono::seconds idleTimeout) {
+    clientPool.setMaxConnectionsPerHost(maxConnectionsPerHost);
+    clientPool.setIdleTimeout(idleTimeout);
+}
+
+HttpPoolStats BlockingHttpTransport::getStats() const {
+    return clientPool.getStats();
+}
\ No newline at end of file
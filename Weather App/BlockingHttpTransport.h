@@ -0,0 +1,29 @@
+/**
+ * @file BlockingHttpTransport.h
+ * @brief HttpTransport over pooled blocking httplib clients
+ */
+#pragma once
+#include "HttpTransport.h"
+#include "HttpClientPool.h"
+
+/**
+ * @class BlockingHttpTransport
+ * @brief Runs each request to completion on the calling thread
+ *
+ * Portable fallback for platforms without the event loop engine. Cancellation
+ * stops the client, which aborts a call blocked on the socket. https:// hosts
+ * keep their pooled connections warm, but a new connection always does a full
+ * TLS handshake since httplib doesn't share sessions between clients.
+ */
+class BlockingHttpTransport : public HttpTransport {
+private:
+    HttpClientPool clientPool;
+    TlsOptions tls;
+
+public:
+    explicit BlockingHttpTransport(const TlsOptions& tls = {}) : tls(tls) {}
+
+    void get(Request request, ResponseHandler onResponse, ContentReceiver onContent, Completion done) override;
+    void configure(size_t maxConnectionsPerHost, std::chrono::seconds idleTimeout) override;
+    HttpPoolStats getStats() const override;
+};
\ No newline at end of file
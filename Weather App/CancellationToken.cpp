@@ -0,0 +1,82 @@
+/**
+ * @file CancellationToken.cpp
+ * @brief Implementation of the CancellationToken class
+ */
+#include "CancellationToken.h"
+
+CancellationToken CancellationToken::create() {
+    CancellationToken token;
+    token.state = std::make_shared<State>();
+    return token;
+}
+
+bool CancellationToken::cancel(CancelReason reason) const {
+    if (!state || reason == CancelReason::None) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    if (state->reason != CancelReason::None) {
+        return false;
+    }
+    state->reason = reason;
+
+    // One at a time and unlocked, so a callback may remove others that haven't run yet
+    while (!state->callbacks.empty()) {
+        auto entry = state->callbacks.begin();
+        std::function<void(CancelReason)> callback = std::move(entry->second);
+        state->runningId = entry->first;
+        state->runningThread = std::this_thread::get_id();
+        state->callbacks.erase(entry);
+
+        lock.unlock();
+        callback(reason);
+        lock.lock();
+
+        state->runningId = 0;
+        state->runningDone.notify_all();
+    }
+    return true;
+}
+
+bool CancellationToken::isCancelled() const {
+    return getReason() != CancelReason::None;
+}
+
+CancelReason CancellationToken::getReason() const {
+    if (!state) {
+        return CancelReason::None;
+    }
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->reason;
+}
+
+size_t CancellationToken::onCancel(std::function<void(CancelReason)> callback) const {
+    if (!state) {
+        return 0;
+    }
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    if (state->reason != CancelReason::None) {
+        CancelReason reason = state->reason;
+        lock.unlock();
+        callback(reason);
+        return 0;
+    }
+    size_t id = state->nextId++;
+    state->callbacks.emplace(id, std::move(callback));
+    return id;
+}
+
+void CancellationToken::removeCallback(size_t id) const {
+    if (!state || id == 0) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(state->mutex);
+    if (state->callbacks.erase(id) != 0 || state->runningThread == std::this_thread::get_id()) {
+        return;
+    }
+
+    // Running on the cancelling thread right now; wait so its captures stay valid until it returns
+    state->runningDone.wait(lock, [this, id] { return state->runningId != id; });
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+/**
+ * @file CancellationToken.h
+ * @brief Cooperative cancellation of API requests, including ones blocked on a socket
+ */
+#pragma once
+#include <string>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
+#include <functional>
+#include <stdexcept>
+
+/**
+ * @brief Why a request stopped before it completed
+ */
+enum class CancelReason {
+    None,
+    Cancelled,  // Cancelled by the caller or by shutdown
+    TimedOut    // Its total deadline passed
+};
+
+/**
+ * @class RequestCancelled
+ * @brief Error of a request that was cancelled or ran out of time
+ */
+class RequestCancelled : public std::runtime_error {
+private:
+    CancelReason reason;
+
+public:
+    explicit RequestCancelled(CancelReason reason)
+        : std::runtime_error(reason == CancelReason::TimedOut ? "API request timed out" : "API operation canceled"),
+        reason(reason) {
+    }
+
+    CancelReason getReason() const { return reason; }
+};
+
+/**
+ * @class CancellationToken
+ * @brief Shared handle that can be cancelled once; copies observe the same state
+ *
+ * Work in progress registers a callback that aborts it (for HTTP calls, one that
+ * stops the client so a blocked read returns). Callbacks run one at a time on the
+ * cancelling thread, outside the token's lock, so they may call back into the
+ * token. After removeCallback() returns the callback is neither running nor going
+ * to run, except when a callback removes itself. A default constructed token can
+ * never be cancelled.
+ */
+class CancellationToken {
+private:
+    struct State {
+        std::mutex mutex;
+        CancelReason reason = CancelReason::None;
+        std::unordered_map<size_t, std::function<void(CancelReason)>> callbacks;
+        size_t nextId = 1;
+
+        // The callback cancel() is running, which removeCallback() waits for
+        size_t runningId = 0;
+        std::thread::id runningThread;
+        std::condition_variable runningDone;
+    };
+
+    std::shared_ptr<State> state;
+
+public:
+    CancellationToken() = default;
+
+    /**
+     * @brief Create a token that can be cancelled
+     */
+    static CancellationToken create();
+
+    /**
+     * @brief Cancel the token; only the first call has an effect
+     * @return True if this call cancelled it
+     */
+    bool cancel(CancelReason reason = CancelReason::Cancelled) const;
+
+    bool isCancelled() const;
+    CancelReason getReason() const;
+
+    /**
+     * @brief Run a callback when the token is cancelled
+     * @return Id for removeCallback(), or 0 if the token was already cancelled (the
+     *         callback then ran immediately) or can never be cancelled
+     */
+    size_t onCancel(std::function<void(CancelReason)> callback) const;
+    void removeCallback(size_t id) const;
+};
\ No newline at end of file
@@ -0,0 +1,311 @@
+/**
+ * @file CassetteTransport.cpp
+ * @brief Implementation of the cassette recorder and replayer
+ */
+#include "CassetteTransport.h"
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+static const char kMagic[8] = { 'W', 'X', 'C', 'A', 'S', 'S', '0', '1' };
+
+static void writeVarint(std::ostream& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.put(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.put(static_cast<char>(value));
+}
+
+static void writeString(std::ostream& out, const std::string& value) {
+    writeVarint(out, value.size());
+    out.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+static bool readVarint(std::istream& in, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = in.get();
+        if (byte == std::char_traits<char>::eof()) {
+            return false;
+        }
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool readString(std::istream& in, std::string& value) {
+    uint64_t length;
+    if (!readVarint(in, length)) {
+        return false;
+    }
+    value.resize(static_cast<size_t>(length));
+    return length == 0 || static_cast<bool>(in.read(&value[0], static_cast<std::streamsize>(length)));
+}
+
+static bool readEntry(std::istream& in, CassetteEntry& entry) {
+    uint64_t status, headerCount;
+    if (!readVarint(in, entry.startMicros) || !readVarint(in, entry.headersMicros) || !readVarint(in, entry.totalMicros) ||
+        !readString(in, entry.host) || !readString(in, entry.path) || !readVarint(in, status) || !readVarint(in, headerCount)) {
+        return false;
+    }
+    entry.status = static_cast<int>(status);
+
+    for (uint64_t i = 0; i < headerCount; ++i) {
+        std::string name, value;
+        if (!readString(in, name) || !readString(in, value)) {
+            return false;
+        }
+        entry.headers.emplace(std::move(name), std::move(value));
+    }
+    return readString(in, entry.error) && readString(in, entry.body);
+}
+
+std::vector<CassetteEntry> Cassette::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open cassette: " + path);
+    }
+
+    char magic[sizeof(kMagic)];
+    if (!file.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), kMagic)) {
+        throw std::runtime_error("Not a cassette: " + path);
+    }
+
+    // A truncated last entry (the recording was killed mid-write) is dropped
+    std::vector<CassetteEntry> entries;
+    CassetteEntry entry;
+    while (file.peek() != std::char_traits<char>::eof() && readEntry(file, entry)) {
+        entries.push_back(std::move(entry));
+        entry = CassetteEntry();
+    }
+
+    std::stable_sort(entries.begin(), entries.end(),
+        [](const CassetteEntry& a, const CassetteEntry& b) { return a.startMicros < b.startMicros; });
+    return entries;
+}
+
+std::string Cassette::scrubPath(const std::string& path) {
+    std::string scrubbed = path;
+    auto start = scrubbed.find("appid=");
+    if (start != std::string::npos) {
+        auto end = scrubbed.find('&', start);
+        scrubbed.erase(start, end == std::string::npos ? std::string::npos : end - start + 1);
+        if (!scrubbed.empty() && (scrubbed.back() == '&' || scrubbed.back() == '?')) {
+            scrubbed.pop_back();
+        }
+    }
+    return scrubbed;
+}
+
+void Cassette::writeHeader(std::ostream& out) {
+    out.write(kMagic, sizeof(kMagic));
+}
+
+void Cassette::writeEntry(std::ostream& out, const CassetteEntry& entry) {
+    writeVarint(out, entry.startMicros);
+    writeVarint(out, entry.headersMicros);
+    writeVarint(out, entry.totalMicros);
+    writeString(out, entry.host);
+    writeString(out, entry.path);
+    writeVarint(out, static_cast<uint64_t>(std::max(0, entry.status)));
+    writeVarint(out, entry.headers.size());
+    for (const auto& header : entry.headers) {
+        writeString(out, header.first);
+        writeString(out, header.second);
+    }
+    writeString(out, entry.error);
+    writeString(out, entry.body);
+}
+
+CassetteRecorder::CassetteRecorder(const std::string& path, std::unique_ptr<HttpTransport> inner)
+    : inner(std::move(inner)), file(path, std::ios::binary | std::ios::trunc), started(Clock::now()) {
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to create cassette: " + path);
+    }
+    Cassette::writeHeader(file);
+    file.flush();
+}
+
+void CassetteRecorder::get(Request request, ResponseHandler onResponse, ContentReceiver onContent, Completion done) {
+    auto start = Clock::now();
+    auto entry = std::make_shared<CassetteEntry>();
+    entry->startMicros = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(start - started).count());
+    entry->host = request.host;
+    entry->path = Cassette::scrubPath(request.path);
+
+    auto elapsedMicros = [start]() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+    };
+
+    inner->get(std::move(request),
+        [entry, elapsedMicros, onResponse = std::move(onResponse)](const Response& head) {
+            entry->headersMicros = elapsedMicros();
+            return onResponse(head);
+        },
+        [entry, onContent = std::move(onContent)](const char* data, size_t length) {
+            entry->body.append(data, length);
+            return onContent(data, length);
+        },
+        [this, entry, elapsedMicros, done = std::move(done)](Response response) {
+            entry->totalMicros = elapsedMicros();
+            entry->status = response.status;
+            entry->headers = response.headers;
+            entry->error = response.error;
+            {
+                std::lock_guard<std::mutex> lock(fileMutex);
+                Cassette::writeEntry(file, *entry);
+                file.flush();
+            }
+            done(std::move(response));
+        });
+}
+
+void CassetteRecorder::configure(size_t maxConnectionsPerHost, std::chrono::seconds idleTimeout) {
+    inner->configure(maxConnectionsPerHost, idleTimeout);
+}
+
+HttpPoolStats CassetteRecorder::getStats() const {
+    return inner->getStats();
+}
+
+CassetteReplayer::CassetteReplayer(const std::string& path, ReplayTiming timing) : timing(timing) {
+    for (auto& entry : Cassette::load(path)) {
+        std::string key = entry.path;
+        recordings[std::move(key)].entries.push_back(std::make_shared<const CassetteEntry>(std::move(entry)));
+    }
+}
+
+std::shared_ptr<const CassetteEntry> CassetteReplayer::take(const std::string& path) {
+    std::shared_ptr<const CassetteEntry> entry;
+    {
+        std::lock_guard<std::mutex> lock(recordingMutex);
+        auto it = recordings.find(Cassette::scrubPath(path));
+        if (it != recordings.end()) {
+            Recording& recording = it->second;
+            entry = recording.entries[std::min(recording.next, recording.entries.size() - 1)];
+            recording.next++;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    if (entry) {
+        stats.hits++;
+    }
+    else {
+        stats.misses++;
+    }
+    return entry;
+}
+
+bool CassetteReplayer::deliverBody(const CassetteEntry& entry, const ContentReceiver& onContent) {
+    // In chunks, like a socket, so streaming parsers see the same pattern as in production
+    for (size_t offset = 0; offset < entry.body.size(); offset += kChunkSize) {
+        if (!onContent(entry.body.data() + offset, std::min(kChunkSize, entry.body.size() - offset))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Response of a replayed exchange that ended early
+static HttpTransport::Response failedResponse(const std::string& error) {
+    HttpTransport::Response response;
+    response.error = error;
+    return response;
+}
+
+void CassetteReplayer::get(Request request, ResponseHandler onResponse, ContentReceiver onContent, Completion done) {
+    auto entry = take(request.path);
+    if (!entry) {
+        done(failedResponse("No recorded response for " + Cassette::scrubPath(request.path)));
+        return;
+    }
+
+    Response head;
+    head.status = entry->status;
+    head.headers = entry->headers;
+    head.error = entry->error;
+
+    if (timing == ReplayTiming::AsFastAsPossible) {
+        if (request.token.isCancelled()) {
+            done(failedResponse("Canceled"));
+        }
+        else if (entry->status != 0 && (!onResponse(head) || !deliverBody(*entry, onContent))) {
+            done(failedResponse("Canceled"));
+        }
+        else {
+            done(std::move(head));
+        }
+        return;
+    }
+
+    // Exactly one of the scheduled delivery and a cancellation completes the exchange
+    struct Exchange {
+        std::atomic<bool> finished{ false };
+        Request request;
+        ResponseHandler onResponse;
+        ContentReceiver onContent;
+        Completion done;
+        size_t cancelRegistration = 0;
+
+        bool finish() {
+            if (finished.exchange(true)) {
+                return false;
+            }
+            request.token.removeCallback(cancelRegistration);
+            return true;
+        }
+    };
+
+    auto exchange = std::make_shared<Exchange>();
+    exchange->request = std::move(request);
+    exchange->onResponse = std::move(onResponse);
+    exchange->onContent = std::move(onContent);
+    exchange->done = std::move(done);
+
+    // Completed on the timer thread like every other outcome, not on the cancelling one
+    exchange->cancelRegistration = exchange->request.token.onCancel([this, exchange](CancelReason) {
+        timers.schedule(std::chrono::milliseconds(0), [exchange]() {
+            if (exchange->finished.exchange(true)) {
+                return;
+            }
+            exchange->done(failedResponse("Canceled"));
+            });
+        });
+
+    auto start = TimerQueue::Clock::now();
+    timers.schedule(start + std::chrono::microseconds(entry->headersMicros), [this, exchange, entry, head, start]() {
+        if (exchange->finished.load()) {
+            return;
+        }
+        if (entry->status != 0 && !exchange->onResponse(head)) {
+            if (exchange->finish()) {
+                exchange->done(failedResponse("Canceled"));
+            }
+            return;
+        }
+
+        timers.schedule(start + std::chrono::microseconds(std::max(entry->headersMicros, entry->totalMicros)),
+            [exchange, entry, head]() {
+                // Claimed before the body is delivered, so a cancellation can't complete it meanwhile
+                if (!exchange->finish()) {
+                    return;
+                }
+                bool delivered = entry->status == 0 || deliverBody(*entry, exchange->onContent);
+                exchange->done(delivered ? head : failedResponse("Canceled"));
+            });
+        });
+}
+
+void CassetteReplayer::configure(size_t, std::chrono::seconds) {
+    // Nothing is connected during a replay
+}
+
+HttpPoolStats CassetteReplayer::getStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return stats;
+}
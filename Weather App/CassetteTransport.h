@@ -0,0 +1,143 @@
+/**
+ * @file CassetteTransport.h
+ * @brief Record HTTP exchanges to an on-disk cassette and replay them without a network
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <chrono>
+#include <cstdint>
+#include "HttpTransport.h"
+#include "TimerQueue.h"
+
+/**
+ * @struct CassetteEntry
+ * @brief One recorded request and its response
+ */
+struct CassetteEntry {
+    uint64_t startMicros = 0;       // Request start, since the recording started
+    uint64_t headersMicros = 0;     // Status and headers received, since the request start
+    uint64_t totalMicros = 0;       // Response complete, since the request start
+    std::string host;
+    std::string path;               // Without the API key
+    int status = 0;
+    httplib::Headers headers;
+    std::string error;
+    std::string body;
+};
+
+/**
+ * @class Cassette
+ * @brief Reads and writes cassette files
+ *
+ * The file is a magic number followed by entries in completion order, each a
+ * run of varint-prefixed fields, so bodies are stored as received with only a
+ * few bytes of framing per exchange.
+ */
+class Cassette {
+public:
+    /**
+     * @brief Read every entry of a cassette, ordered by request start
+     * @throws std::runtime_error if the file can't be read or isn't a cassette
+     */
+    static std::vector<CassetteEntry> load(const std::string& path);
+
+    /**
+     * @brief Path of a request as it is stored: the appid parameter is removed
+     */
+    static std::string scrubPath(const std::string& path);
+
+    static void writeHeader(std::ostream& out);
+    static void writeEntry(std::ostream& out, const CassetteEntry& entry);
+};
+
+/**
+ * @class CassetteRecorder
+ * @brief HttpTransport that forwards to another transport and records every exchange
+ *
+ * Entries are appended and flushed as requests complete, so a recording
+ * survives the process being killed mid-storm.
+ */
+class CassetteRecorder : public HttpTransport {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::unique_ptr<HttpTransport> inner;
+    std::ofstream file;
+    std::mutex fileMutex;
+    Clock::time_point started;
+
+public:
+    /**
+     * @brief Constructor
+     * @param path Cassette file, truncated
+     * @param inner Transport that sends the requests
+     */
+    CassetteRecorder(const std::string& path, std::unique_ptr<HttpTransport> inner);
+
+    void get(Request request, ResponseHandler onResponse, ContentReceiver onContent, Completion done) override;
+    void configure(size_t maxConnectionsPerHost, std::chrono::seconds idleTimeout) override;
+    HttpPoolStats getStats() const override;
+};
+
+/**
+ * @brief How a CassetteReplayer paces the responses
+ */
+enum class ReplayTiming {
+    Original,       // Headers and body arrive after their recorded delays
+    AsFastAsPossible  // Complete on the calling thread
+};
+
+/**
+ * @class CassetteReplayer
+ * @brief HttpTransport that answers from a cassette and never touches the network
+ *
+ * Requests are matched by path without the API key; the host is ignored so a
+ * cassette recorded against the provider replays against any base URL.
+ * Recordings of the same path are handed out in order and the last one is
+ * repeated once they run out. A request with no recording fails as a
+ * transport error.
+ */
+class CassetteReplayer : public HttpTransport {
+private:
+    struct Recording {
+        std::vector<std::shared_ptr<const CassetteEntry>> entries;
+        size_t next = 0;
+    };
+
+    static constexpr size_t kChunkSize = 16 * 1024;
+
+    ReplayTiming timing;
+    std::unordered_map<std::string, Recording> recordings;
+    std::mutex recordingMutex;
+    HttpPoolStats stats;
+    mutable std::mutex statsMutex;
+
+    // Declared last so pending deliveries are dropped before the recordings go away
+    TimerQueue timers;
+
+    std::shared_ptr<const CassetteEntry> take(const std::string& path);
+    static bool deliverBody(const CassetteEntry& entry, const ContentReceiver& onContent);
+
+public:
+    /**
+     * @brief Constructor
+     * @param path Cassette file to replay
+     * @param timing Recorded pacing or as fast as possible
+     * @throws std::runtime_error if the cassette can't be read
+     */
+    CassetteReplayer(const std::string& path, ReplayTiming timing);
+
+    void get(Request request, ResponseHandler onResponse, ContentReceiver onContent, Completion done) override;
+    void configure(size_t maxConnectionsPerHost, std::chrono::seconds idleTimeout) override;
+
+    /**
+     * @brief hits counts requests answered from the cassette, misses those with no recording
+     */
+    HttpPoolStats getStats() const override;
+};
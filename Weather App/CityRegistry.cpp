@@ -0,0 +1,206 @@
+/**
+ * @file CityRegistry.cpp
+ * @brief Implementation of the CityRegistry class
+ */
+#include "CityRegistry.h"
+#include <cctype>
+#include <stdexcept>
+
+namespace {
+
+    // Walks the normalized form of a name one character at a time
+    class KeyCursor {
+    private:
+        std::string_view name;
+        size_t position = 0;
+        bool pendingSpace = false;
+
+        static bool isSpace(char c) { return std::isspace(static_cast<unsigned char>(c)) != 0; }
+
+    public:
+        explicit KeyCursor(std::string_view name) : name(name) {
+            while (position < name.size() && isSpace(name[position])) {
+                position++;
+            }
+        }
+
+        // Next character, or false at the end; a run of spaces reads as one, trailing spaces as none
+        bool next(char& c) {
+            if (pendingSpace) {
+                pendingSpace = false;
+                c = ' ';
+                return true;
+            }
+            if (position == name.size()) {
+                return false;
+            }
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(name[position++])));
+            if (position < name.size() && isSpace(name[position])) {
+                while (position < name.size() && isSpace(name[position])) {
+                    position++;
+                }
+                pendingSpace = position < name.size();
+            }
+            return true;
+        }
+    };
+
+}
+
+size_t CityRegistry::KeyHash::operator()(std::string_view name) const {
+    // FNV-1a over the normalized characters
+    size_t hash = static_cast<size_t>(14695981039346656037ull);
+    KeyCursor cursor(name);
+    char c;
+    while (cursor.next(c)) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * static_cast<size_t>(1099511628211ull);
+    }
+    return hash;
+}
+
+bool CityRegistry::KeyEqual::operator()(std::string_view a, std::string_view b) const {
+    KeyCursor left(a);
+    KeyCursor right(b);
+    char l;
+    char r;
+    while (true) {
+        bool hasLeft = left.next(l);
+        bool hasRight = right.next(r);
+        if (!hasLeft || !hasRight) {
+            return hasLeft == hasRight;
+        }
+        if (l != r) {
+            return false;
+        }
+    }
+}
+
+std::string CityRegistry::normalize(std::string_view name) {
+    std::string key;
+    key.reserve(name.size());
+    KeyCursor cursor(name);
+    char c;
+    while (cursor.next(c)) {
+        key.push_back(c);
+    }
+    return key;
+}
+
+CityId CityRegistry::canonicalLocked(CityId city) const {
+    while (city < entries.size() && entries[city].mergedInto != kNoCity) {
+        city = entries[city].mergedInto;
+    }
+    return city;
+}
+
+CityId CityRegistry::add(std::string_view name) {
+    // Shown with surrounding spaces trimmed, as typed otherwise
+    size_t first = name.find_first_not_of(" \t\r\n");
+    size_t last = name.find_last_not_of(" \t\r\n");
+    names.emplace_back(name.substr(first, last - first + 1));
+    entries.push_back({ &names.back() });
+    CityId city = static_cast<CityId>(entries.size() - 1);
+    aliases.emplace(normalize(name), city);
+    return city;
+}
+
+CityId CityRegistry::intern(std::string_view name) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = aliases.find(name);
+        if (it != aliases.end()) {
+            return canonicalLocked(it->second);
+        }
+    }
+    if (normalize(name).empty()) {
+        return kNoCity;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = aliases.find(name);
+    if (it != aliases.end()) {
+        return canonicalLocked(it->second);
+    }
+    return add(name);
+}
+
+CityId CityRegistry::find(std::string_view name) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = aliases.find(name);
+    return it != aliases.end() ? canonicalLocked(it->second) : kNoCity;
+}
+
+CityId CityRegistry::bind(CityId city, long long providerId, std::string_view providerName) {
+    if (city == kNoCity || providerId == 0) {
+        return canonical(city);
+    }
+    {
+        // The common case, a refresh of a city bound long ago: no string is hashed
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        city = canonicalLocked(city);
+        auto known = byProvider.find(providerId);
+        if (known != byProvider.end() && canonicalLocked(known->second) == city) {
+            return city;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (city >= entries.size()) {
+        throw std::out_of_range("Unknown city ID");
+    }
+    city = canonicalLocked(city);
+    auto known = byProvider.find(providerId);
+    if (known != byProvider.end()) {
+        CityId bound = canonicalLocked(known->second);
+        if (bound != city && entries[city].providerId == 0) {
+            // Another name for a city we already know
+            entries[city].mergedInto = bound;
+            merges.fetch_add(1);
+        }
+        city = canonicalLocked(city);
+    }
+    else if (entries[city].providerId == 0) {
+        entries[city].providerId = providerId;
+        byProvider.emplace(providerId, city);
+    }
+
+    // The provider's spelling is shown from now on, and finds the city too
+    const std::string& shown = *entries[city].name;
+    if (!providerName.empty() && shown != providerName) {
+        names.emplace_back(providerName);
+        entries[city].name = &names.back();
+    }
+    if (!providerName.empty() && aliases.find(providerName) == aliases.end()) {
+        aliases.emplace(normalize(providerName), city);
+    }
+    return city;
+}
+
+CityId CityRegistry::bindProvider(long long providerId, std::string_view providerName) {
+    if (providerId != 0) {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto known = byProvider.find(providerId);
+        if (known != byProvider.end()) {
+            return canonicalLocked(known->second);
+        }
+    }
+    return bind(intern(providerName), providerId, providerName);
+}
+
+CityId CityRegistry::canonical(CityId city) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return canonicalLocked(city);
+}
+
+const std::string& CityRegistry::name(CityId city) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    if (city >= entries.size()) {
+        throw std::out_of_range("Unknown city ID");
+    }
+    return *entries[city].name;
+}
+
+size_t CityRegistry::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return entries.size();
+}
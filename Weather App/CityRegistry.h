@@ -0,0 +1,118 @@
+/**
+ * @file CityRegistry.h
+ * @brief Canonical city identities with dense integer IDs
+ */
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using CityId = std::uint32_t;
+
+/**
+ * @class CityRegistry
+ * @brief Maps city names to small integer IDs, one per real city
+ *
+ * Names are compared as keys: case-insensitively, with surrounding spaces
+ * dropped and inner runs of spaces read as one, so "jerusalem " and
+ * "Jerusalem" are the same city. Lookups hash the caller's string_view
+ * directly, without building a normalized copy.
+ *
+ * Once the provider answers for a name, bind() ties the ID to the provider's
+ * city ID and takes over its spelling. A second name for a city the provider
+ * already identified (say "NYC" after "New York") is merged into the first
+ * ID; canonical() follows such merges. IDs are handed out densely from zero
+ * and never reused, so data keyed by city can live in plain vectors.
+ */
+class CityRegistry {
+public:
+    static constexpr CityId kNoCity = std::numeric_limits<CityId>::max();
+
+private:
+    // Hash and equality over the normalized form of a name, for stored keys and string_view probes alike
+    struct KeyHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const;
+    };
+    struct KeyEqual {
+        using is_transparent = void;
+        bool operator()(std::string_view a, std::string_view b) const;
+    };
+
+    struct Entry {
+        const std::string* name;        // Points into names; swapped, never freed, when the provider renames
+        long long providerId = 0;       // 0 until bound
+        CityId mergedInto = kNoCity;    // Set when another ID turned out to be the same city
+    };
+
+    mutable std::shared_mutex mutex;
+    std::deque<Entry> entries;      // Indexed by CityId; a deque, so entries never move
+    std::deque<std::string> names;  // Every spelling ever shown, so references handed out stay valid
+    std::unordered_map<std::string, CityId, KeyHash, KeyEqual> aliases;
+    std::unordered_map<long long, CityId> byProvider;
+    std::atomic<unsigned long long> merges{ 0 };
+
+    static std::string normalize(std::string_view name);
+    CityId canonicalLocked(CityId city) const;
+    CityId add(std::string_view name);
+
+public:
+    CityRegistry() = default;
+
+    CityRegistry(const CityRegistry&) = delete;
+    CityRegistry& operator=(const CityRegistry&) = delete;
+
+    /**
+     * @brief ID of a city name, registering the name if it is new
+     * @return kNoCity for a blank name
+     */
+    CityId intern(std::string_view name);
+
+    /**
+     * @brief ID of a city name without registering it
+     * @return kNoCity if the name is unknown
+     */
+    CityId find(std::string_view name) const;
+
+    /**
+     * @brief Record the provider's identity for a city
+     * @param city ID the request was made for
+     * @param providerId Provider city ID from the response; 0 leaves the city unbound
+     * @param providerName Provider spelling, shown from now on
+     * @return The city's canonical ID, which differs from city if it was merged
+     */
+    CityId bind(CityId city, long long providerId, std::string_view providerName);
+
+    /**
+     * @brief Canonical ID of a city the provider reported on its own, as in a group response
+     *
+     * Known provider IDs resolve without hashing any string.
+     */
+    CityId bindProvider(long long providerId, std::string_view providerName);
+
+    /**
+     * @brief The ID a city was merged into, or the ID itself
+     */
+    CityId canonical(CityId city) const;
+
+    /**
+     * @brief Display name of a city; the reference stays valid for the registry's lifetime
+     */
+    const std::string& name(CityId city) const;
+
+    /**
+     * @brief Number of IDs handed out; every ID is below it
+     */
+    size_t size() const;
+
+    /**
+     * @brief Grows whenever two IDs are merged, so holders of IDs know to canonicalize them again
+     */
+    unsigned long long mergeCount() const { return merges.load(); }
+};
@@ -0,0 +1,136 @@
+/**
+ * @file ContentDecoder.cpp
+ * @brief Implementation of the ContentDecoder class
+ */
+#include "ContentDecoder.h"
+#include <algorithm>
+#include <cctype>
+#ifdef CPPHTTPLIB_ZLIB_SUPPORT
+#include <zlib.h>
+#endif
+
+#ifdef CPPHTTPLIB_ZLIB_SUPPORT
+struct ContentDecoder::Inflater {
+    static constexpr size_t kBlockSize = 16 * 1024;
+
+    z_stream stream{};
+    bool ended = false;     // The last compressed stream is complete
+    bool rawFallback;       // deflate: retry without the zlib header if it turns out to be missing
+    bool started = false;
+    char block[kBlockSize];
+
+    explicit Inflater(bool deflate) : rawFallback(deflate) {
+        // 15 + 32 detects a gzip or zlib header
+        inflateInit2(&stream, 15 + 32);
+    }
+    ~Inflater() { inflateEnd(&stream); }
+};
+#else
+struct ContentDecoder::Inflater {
+    bool ended = false;
+};
+#endif
+
+static std::string lowercase(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    value.erase(0, value.find_first_not_of(' '));
+    value.erase(value.find_last_not_of(' ') + 1);
+    return value;
+}
+
+ContentDecoder::ContentDecoder(const std::string& contentEncoding) : supported(true) {
+    std::string encoding = lowercase(contentEncoding);
+    if (encoding.empty() || encoding == "identity") {
+        return;
+    }
+#ifdef CPPHTTPLIB_ZLIB_SUPPORT
+    if (encoding == "gzip" || encoding == "x-gzip" || encoding == "deflate") {
+        inflater = std::make_unique<Inflater>(encoding == "deflate");
+        return;
+    }
+#endif
+    supported = false;
+    error = "Unsupported Content-Encoding: " + contentEncoding;
+}
+
+ContentDecoder::~ContentDecoder() = default;
+
+const char* ContentDecoder::acceptEncoding() {
+#ifdef CPPHTTPLIB_ZLIB_SUPPORT
+    return "gzip, deflate";
+#else
+    return "";
+#endif
+}
+
+bool ContentDecoder::feed(const char* data, size_t length, const Sink& sink) {
+    if (!supported || hasFailed()) {
+        return false;
+    }
+    if (!inflater) {
+        return sink(data, length);
+    }
+
+#ifdef CPPHTTPLIB_ZLIB_SUPPORT
+    z_stream& stream = inflater->stream;
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream.avail_in = static_cast<uInt>(length);
+
+    while (true) {
+        if (inflater->ended) {
+            if (stream.avail_in == 0) {
+                break;
+            }
+            // Another gzip member follows the one that just ended
+            inflateReset(&stream);
+            inflater->ended = false;
+        }
+
+        stream.next_out = reinterpret_cast<Bytef*>(inflater->block);
+        stream.avail_out = static_cast<uInt>(Inflater::kBlockSize);
+        int result = inflate(&stream, Z_NO_FLUSH);
+
+        if (result == Z_DATA_ERROR && inflater->rawFallback && !inflater->started) {
+            // Some servers send deflate without the zlib wrapper
+            inflater->rawFallback = false;
+            inflateEnd(&stream);
+            stream = z_stream{};
+            inflateInit2(&stream, -15);
+            stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+            stream.avail_in = static_cast<uInt>(length);
+            continue;
+        }
+        if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+            error = std::string("Failed to decompress body: ") + (stream.msg ? stream.msg : "corrupt data");
+            return false;
+        }
+        inflater->started = true;
+
+        size_t produced = Inflater::kBlockSize - stream.avail_out;
+        if (produced > 0 && !sink(inflater->block, produced)) {
+            return false;
+        }
+        if (result == Z_STREAM_END) {
+            inflater->ended = true;
+        }
+        else if (stream.avail_out != 0) {
+            // All input consumed and nothing left pending in zlib
+            break;
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ContentDecoder::finish() {
+    if (!supported || hasFailed()) {
+        return false;
+    }
+    if (inflater && !inflater->ended) {
+        error = "Compressed body ended early";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file ContentDecoder.h
+ * @brief Streaming decoder of gzip and deflate response bodies
+ */
+#pragma once
+#include <string>
+#include <memory>
+#include <functional>
+#include <cstddef>
+
+/**
+ * @struct TransferStats
+ * @brief Body bytes as transferred against the bytes after decoding
+ */
+struct TransferStats {
+    unsigned long long responses = 0;
+    unsigned long long compressedResponses = 0;
+    unsigned long long wireBytes = 0;       // Body bytes received, compressed or not
+    unsigned long long decodedBytes = 0;    // Body bytes handed to the parsers
+
+    double compressionRatio() const {
+        return wireBytes == 0 ? 1.0 : static_cast<double>(decodedBytes) / wireBytes;
+    }
+};
+
+/**
+ * @class ContentDecoder
+ * @brief Decodes a body in the chunks it arrives in, handing decoded chunks to a sink
+ *
+ * Nothing is buffered beyond one output block, so a compressed body goes
+ * straight into the streaming parser. gzip and deflate need zlib
+ * (CPPHTTPLIB_ZLIB_SUPPORT); without it only identity bodies are accepted and
+ * acceptEncoding() is empty, so servers never send anything else.
+ */
+class ContentDecoder {
+public:
+    using Sink = std::function<bool(const char*, size_t)>;
+
+private:
+    struct Inflater;
+
+    std::unique_ptr<Inflater> inflater;     // Null for identity bodies
+    bool supported;
+    std::string error;
+
+public:
+    /**
+     * @param contentEncoding Value of the Content-Encoding header
+     */
+    explicit ContentDecoder(const std::string& contentEncoding);
+    ~ContentDecoder();
+
+    ContentDecoder(const ContentDecoder&) = delete;
+    ContentDecoder& operator=(const ContentDecoder&) = delete;
+
+    /**
+     * @brief Value for the Accept-Encoding request header, empty without zlib
+     */
+    static const char* acceptEncoding();
+
+    bool isCompressed() const { return inflater != nullptr; }
+
+    /**
+     * @brief Decode a chunk of the body
+     * @return False on corrupt data, an unsupported encoding, or when the sink returns false
+     */
+    bool feed(const char* data, size_t length, const Sink& sink);
+
+    /**
+     * @brief True if the body ended with a complete compressed stream
+     */
+    bool finish();
+
+    bool hasFailed() const { return !error.empty(); }
+    const std::string& getError() const { return error; }
+};
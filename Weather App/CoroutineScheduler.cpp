@@ -0,0 +1,37 @@
+/**
+ * @file CoroutineScheduler.cpp
+ * @brief Implementation of the CoroutineScheduler class
+ */
+#include "CoroutineScheduler.h"
+#include <iostream>
+
+CoroutineScheduler::CoroutineScheduler(ThreadPool& pool) : pool(pool), active(0) {
+}
+
+CoroutineScheduler::~CoroutineScheduler() {
+    std::unique_lock<std::mutex> lock(activeMutex);
+    allDone.wait(lock, [this] { return active == 0; });
+}
+
+CoroutineScheduler::Detached CoroutineScheduler::runDetached(Task<> task, RequestPriority priority) {
+    try {
+        co_await schedule(priority);
+        co_await task;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Unhandled error in coroutine task: " << e.what() << std::endl;
+    }
+
+    std::lock_guard<std::mutex> lock(activeMutex);
+    if (--active == 0) {
+        allDone.notify_all();
+    }
+}
+
+void CoroutineScheduler::spawn(Task<> task, RequestPriority priority) {
+    {
+        std::lock_guard<std::mutex> lock(activeMutex);
+        active++;
+    }
+    runDetached(std::move(task), priority);
+}
\ No newline at end of file
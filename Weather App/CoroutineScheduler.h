@@ -0,0 +1,67 @@
+/**
+ * @file CoroutineScheduler.h
+ * @brief Runs coroutine tasks on a thread pool
+ */
+#pragma once
+#include <coroutine>
+#include <mutex>
+#include <condition_variable>
+#include "Task.h"
+#include "ThreadPool.h"
+
+/**
+ * @class CoroutineScheduler
+ * @brief Starts detached coroutine tasks and lets them move onto the pool
+ *
+ * A suspended coroutine holds no thread, so a few pool threads can drive any
+ * number of tasks that spend their time waiting on the network. The destructor
+ * waits for every spawned task to finish.
+ */
+class CoroutineScheduler {
+private:
+    ThreadPool& pool;
+    size_t active;
+    std::mutex activeMutex;
+    std::condition_variable allDone;
+
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() { return {}; }
+            std::suspend_never initial_suspend() const noexcept { return {}; }
+            std::suspend_never final_suspend() const noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() {}
+        };
+    };
+
+    Detached runDetached(Task<> task, RequestPriority priority);
+
+public:
+    /**
+     * @brief Awaitable that resumes the awaiting coroutine on a pool thread, in the given lane
+     */
+    struct ScheduleAwaiter {
+        ThreadPool& pool;
+        RequestPriority priority;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> awaiting) { pool.post([awaiting]() { awaiting.resume(); }, priority); }
+        void await_resume() const noexcept {}
+    };
+
+    explicit CoroutineScheduler(ThreadPool& pool);
+    ~CoroutineScheduler();
+
+    CoroutineScheduler(const CoroutineScheduler&) = delete;
+    CoroutineScheduler& operator=(const CoroutineScheduler&) = delete;
+
+    ScheduleAwaiter schedule(RequestPriority priority = RequestPriority::Interactive) { return ScheduleAwaiter{ pool, priority }; }
+
+    /**
+     * @brief Run a task to completion on the pool without waiting for it
+     *
+     * Exceptions escaping the task are reported on std::cerr.
+     * @param priority Lane the task starts in
+     */
+    void spawn(Task<> task, RequestPriority priority = RequestPriority::Interactive);
+};
\ No newline at end of file
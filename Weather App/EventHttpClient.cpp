@@ -0,0 +1,902 @@
+/**
+ * @file EventHttpClient.cpp
+ * @brief Implementation of the EventHttpClient class
+ */
+#include "EventHttpClient.h"
+#ifdef __linux__
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+#include <openssl/err.h>
+#endif
+
+EventHttpClient::EventHttpClient(size_t pipelineDepth, const TlsOptions& tlsOptions)
+    : epollFd(epoll_create1(EPOLL_CLOEXEC)), wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), running(true), nextId(1),
+    maxConnectionsPerHost(8), idleTimeout(30), pipelineDepth(std::max<size_t>(1, pipelineDepth)),
+    loopMaxConnections(8), loopIdleTimeout(std::chrono::seconds(30)), loopPipelineDepth(this->pipelineDepth) {
+    if (epollFd < 0 || wakeFd < 0) {
+        throw std::runtime_error(std::string("Failed to create event loop: ") + std::strerror(errno));
+    }
+
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+    try {
+        tls = std::make_unique<TlsContext>(tlsOptions);
+    }
+    catch (...) {
+        close(wakeFd);
+        close(epollFd);
+        throw;
+    }
+#else
+    (void)tlsOptions;
+#endif
+
+    // The wake-up eventfd is the only registration without a connection
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+
+    loopThread = std::thread(&EventHttpClient::run, this);
+    resolverThread = std::thread(&EventHttpClient::runResolver, this);
+}
+
+EventHttpClient::~EventHttpClient() {
+    {
+        // Under the lock, so the resolver can't miss the notification between its check and its wait
+        std::lock_guard<std::mutex> lock(resolverMutex);
+        running.store(false);
+    }
+    resolverReady.notify_all();
+    wake();
+    if (loopThread.joinable()) {
+        loopThread.join();
+    }
+    // Waits for a lookup in progress; its answer is dropped
+    if (resolverThread.joinable()) {
+        resolverThread.join();
+    }
+    close(wakeFd);
+    close(epollFd);
+}
+
+void EventHttpClient::wake() {
+    uint64_t one = 1;
+    ssize_t written = write(wakeFd, &one, sizeof(one));
+    (void)written;
+}
+
+void EventHttpClient::runResolver() {
+    std::unique_lock<std::mutex> lock(resolverMutex);
+    while (true) {
+        resolverReady.wait(lock, [this] { return !running.load() || !lookups.empty(); });
+        if (!running.load()) {
+            return;
+        }
+        auto lookup = std::move(lookups.front());
+        lookups.pop_front();
+        lock.unlock();
+
+        Resolution resolution;
+        resolution.key = lookup.first + ":" + lookup.second;
+        resolve(lookup.first, lookup.second, resolution.address, resolution.error);
+        {
+            std::lock_guard<std::mutex> commandLock(commandMutex);
+            resolutions.push_back(std::move(resolution));
+        }
+        wake();
+
+        lock.lock();
+    }
+}
+
+bool EventHttpClient::resolve(const std::string& name, const std::string& port, Address& address, std::string& error) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    int status = getaddrinfo(name.c_str(), port.c_str(), &hints, &result);
+    if (status != 0 || !result) {
+        error = std::string("Failed to resolve ") + name + ": " + gai_strerror(status);
+        return false;
+    }
+
+    std::memcpy(&address.storage, result->ai_addr, result->ai_addrlen);
+    address.length = static_cast<socklen_t>(result->ai_addrlen);
+    address.resolvedAt = Clock::now();
+    freeaddrinfo(result);
+    return true;
+}
+
+void EventHttpClient::get(Request request, ResponseHandler onResponse, ContentReceiver onContent, Completion done) {
+    auto exchange = std::make_shared<Exchange>();
+    std::string authority = request.host;
+    if (authority.compare(0, 8, "https://") == 0) {
+        exchange->secure = true;
+        authority.erase(0, 8);
+    }
+    else if (authority.compare(0, 7, "http://") == 0) {
+        authority.erase(0, 7);
+    }
+    exchange->hostKey = exchange->secure ? "https://" + authority : authority;
+
+    Response failure;
+#ifndef CPPHTTPLIB_OPENSSL_SUPPORT
+    if (exchange->secure) {
+        failure.error = "HTTPS needs a build with CPPHTTPLIB_OPENSSL_SUPPORT";
+        done(std::move(failure));
+        return;
+    }
+#endif
+
+    // host, host:port or [v6]:port; the loop resolves the name
+    std::string& name = exchange->serverName;
+    std::string& port = exchange->port;
+    name = authority;
+    port = exchange->secure ? "443" : "80";
+    auto colon = authority.rfind(':');
+    auto bracket = authority.rfind(']');
+    if (colon != std::string::npos && (bracket == std::string::npos || colon > bracket)) {
+        name = authority.substr(0, colon);
+        port = authority.substr(colon + 1);
+    }
+    if (name.size() > 1 && name.front() == '[' && name.back() == ']') {
+        name = name.substr(1, name.size() - 2);
+    }
+
+    std::string& wire = exchange->wire;
+    wire.reserve(256 + request.path.size());
+    wire += "GET " + request.path + " HTTP/1.1\r\n";
+    wire += "Host: " + authority + "\r\n";
+    wire += "Accept: */*\r\nUser-Agent: WeatherApp\r\nConnection: keep-alive\r\n";
+    for (const auto& header : request.headers) {
+        wire += header.first + ": " + header.second + "\r\n";
+    }
+    wire += "\r\n";
+
+    exchange->id = nextId++;
+    exchange->request = std::move(request);
+    exchange->onResponse = std::move(onResponse);
+    exchange->onContent = std::move(onContent);
+    exchange->done = std::move(done);
+
+    // A cancellation that arrives before the loop has seen the request is caught by dispatch()
+    uint64_t id = exchange->id;
+    exchange->cancelRegistration = exchange->request.token.onCancel([this, id](CancelReason) {
+        {
+            std::lock_guard<std::mutex> lock(commandMutex);
+            cancelled.push_back(id);
+        }
+        wake();
+        });
+
+    {
+        std::lock_guard<std::mutex> lock(commandMutex);
+        submitted.push_back(std::move(exchange));
+    }
+    wake();
+}
+
+void EventHttpClient::configure(size_t maxConnectionsPerHost, std::chrono::seconds idleTimeout) {
+    {
+        std::lock_guard<std::mutex> lock(commandMutex);
+        this->maxConnectionsPerHost = std::max<size_t>(1, maxConnectionsPerHost);
+        this->idleTimeout = idleTimeout;
+    }
+    wake();
+}
+
+HttpPoolStats EventHttpClient::getStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return stats;
+}
+
+void EventHttpClient::run() {
+    std::vector<epoll_event> events(256);
+
+    while (running.load()) {
+        int ready = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), nextTimeout(Clock::now()));
+        for (int i = 0; i < ready; ++i) {
+            if (events[i].data.ptr == nullptr) {
+                uint64_t count;
+                ssize_t drained = read(wakeFd, &count, sizeof(count));
+                (void)drained;
+                continue;
+            }
+
+            // Skip connections closed earlier in this batch; they are freed below
+            auto* connection = static_cast<Connection*>(events[i].data.ptr);
+            if (connection->fd >= 0) {
+                handleEvents(*connection, events[i].events);
+            }
+        }
+
+        drainCommands();
+        checkDeadlines(Clock::now());
+        closed.clear();
+        publishStats();
+    }
+
+    // Fail whatever is still outstanding
+    for (auto& pair : hosts) {
+        std::vector<Connection*> open;
+        for (auto& connection : pair.second.connections) {
+            open.push_back(connection.get());
+        }
+        for (Connection* connection : open) {
+            closeConnection(*connection, "Transport shut down", true, true);
+        }
+        auto waiting = std::move(pair.second.waiting);
+        for (auto& exchange : waiting) {
+            complete(exchange, Response{ 0, {}, "Transport shut down" });
+        }
+    }
+    std::vector<std::shared_ptr<Exchange>> unsent;
+    for (auto& pair : resolving) {
+        unsent.insert(unsent.end(), pair.second.begin(), pair.second.end());
+    }
+    resolving.clear();
+    {
+        std::lock_guard<std::mutex> lock(commandMutex);
+        unsent.insert(unsent.end(), submitted.begin(), submitted.end());
+        submitted.clear();
+    }
+    for (auto& exchange : unsent) {
+        complete(exchange, Response{ 0, {}, "Transport shut down" });
+    }
+    closed.clear();
+}
+
+void EventHttpClient::drainCommands() {
+    std::vector<std::shared_ptr<Exchange>> newExchanges;
+    std::vector<uint64_t> cancelledIds;
+    std::vector<Resolution> answers;
+    {
+        std::lock_guard<std::mutex> lock(commandMutex);
+        if (!running.load()) {
+            return;
+        }
+        newExchanges.swap(submitted);
+        cancelledIds.swap(cancelled);
+        answers.swap(resolutions);
+        loopMaxConnections = maxConnectionsPerHost;
+        loopIdleTimeout = idleTimeout;
+        loopPipelineDepth = pipelineDepth;
+    }
+
+    // Submissions first, so a cancellation sent right after its request finds it
+    for (auto& exchange : newExchanges) {
+        dispatch(std::move(exchange));
+    }
+    for (auto& answer : answers) {
+        auto parked = resolving.find(answer.key);
+        if (parked == resolving.end()) {
+            continue;
+        }
+        auto waiting = std::move(parked->second);
+        resolving.erase(parked);
+
+        if (answer.address.length == 0) {
+            for (auto& exchange : waiting) {
+                complete(exchange, Response{ 0, {}, answer.error });
+            }
+            continue;
+        }
+        addresses[answer.key] = answer.address;
+        for (auto& exchange : waiting) {
+            dispatch(std::move(exchange));
+        }
+    }
+    for (uint64_t id : cancelledIds) {
+        cancelExchange(id);
+    }
+}
+
+int EventHttpClient::nextTimeout(Clock::time_point now) {
+    auto next = now + std::chrono::seconds(1);
+    for (auto& pair : hosts) {
+        for (auto& connection : pair.second.connections) {
+            Clock::time_point deadline;
+            if (connection->pipeline.empty()) {
+                deadline = connection->lastUsed + loopIdleTimeout;
+            }
+            else if (connection->connecting || connection->handshaking) {
+                deadline = connection->connectStarted + connection->pipeline.front()->request.timeouts.connectTimeout;
+            }
+            else {
+                deadline = connection->lastActivity + connection->pipeline.front()->request.timeouts.readTimeout;
+            }
+            next = std::min(next, deadline);
+        }
+    }
+    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count();
+    return static_cast<int>(std::max(0LL, static_cast<long long>(wait)) + 1);
+}
+
+void EventHttpClient::checkDeadlines(Clock::time_point now) {
+    for (auto& pair : hosts) {
+        std::vector<Connection*> open;
+        for (auto& connection : pair.second.connections) {
+            open.push_back(connection.get());
+        }
+
+        for (Connection* connection : open) {
+            if (connection->pipeline.empty()) {
+                if (now - connection->lastUsed >= loopIdleTimeout) {
+                    closeConnection(*connection, "Idle", false);
+                    std::lock_guard<std::mutex> lock(statsMutex);
+                    stats.evictions++;
+                }
+            }
+            else if (connection->connecting || connection->handshaking) {
+                if (now - connection->connectStarted >= connection->pipeline.front()->request.timeouts.connectTimeout) {
+                    closeConnection(*connection, "Connection timed out", true, true);
+                }
+            }
+            else if (now - connection->lastActivity >= connection->pipeline.front()->request.timeouts.readTimeout) {
+                closeConnection(*connection, "Read timed out", true);
+            }
+        }
+    }
+}
+
+void EventHttpClient::publishStats() {
+    size_t idle = 0;
+    size_t active = 0;
+    for (auto& pair : hosts) {
+        for (auto& connection : pair.second.connections) {
+            if (connection->pipeline.empty()) {
+                idle++;
+            }
+            else {
+                active++;
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    stats.idleConnections = idle;
+    stats.activeConnections = active;
+}
+
+void EventHttpClient::dispatch(std::shared_ptr<Exchange> exchange) {
+    if (exchange->request.token.isCancelled()) {
+        complete(exchange, Response{ 0, {}, "Canceled" });
+        return;
+    }
+    exchanges[exchange->id] = exchange;
+
+    if (exchange->address.length == 0) {
+        std::string key = exchange->serverName + ":" + exchange->port;
+        auto cached = addresses.find(key);
+        if (cached == addresses.end() || Clock::now() - cached->second.resolvedAt >= std::chrono::minutes(5)) {
+            // The first request for the name asks the resolver, later ones wait for its answer
+            auto& parked = resolving[key];
+            parked.push_back(std::move(exchange));
+            if (parked.size() == 1) {
+                {
+                    std::lock_guard<std::mutex> lock(resolverMutex);
+                    lookups.emplace_back(parked.back()->serverName, parked.back()->port);
+                }
+                resolverReady.notify_one();
+            }
+            return;
+        }
+        exchange->address = cached->second;
+    }
+
+    HostState& host = hosts[exchange->hostKey];
+    std::string error;
+    Connection* connection = findConnection(host, *exchange, error);
+    if (!error.empty()) {
+        complete(exchange, Response{ 0, {}, error });
+    }
+    else if (connection) {
+        assign(*connection, std::move(exchange));
+    }
+    else {
+        host.waiting.push_back(std::move(exchange));
+    }
+}
+
+EventHttpClient::Connection* EventHttpClient::findConnection(HostState& host, const Exchange& exchange, std::string& error) {
+    // An idle keep-alive connection first, the most recently used is the most likely to be alive
+    Connection* best = nullptr;
+    for (auto& connection : host.connections) {
+        if (connection->pipeline.empty() && (!best || connection->lastUsed > best->lastUsed)) {
+            best = connection.get();
+        }
+    }
+    if (best) {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.hits++;
+        return best;
+    }
+
+    if (host.connections.size() < loopMaxConnections) {
+        return openConnection(host, exchange, error);
+    }
+
+    // Every connection is busy: pipeline behind the shortest queue. A connection
+    // that hasn't answered yet may turn out not to keep the socket open, so it only
+    // takes more requests once it has
+    for (auto& connection : host.connections) {
+        if (connection->reused && connection->pipeline.size() < loopPipelineDepth &&
+            (!best || connection->pipeline.size() < best->pipeline.size())) {
+            best = connection.get();
+        }
+    }
+    if (best) {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.hits++;
+    }
+    return best;
+}
+
+EventHttpClient::Connection* EventHttpClient::openConnection(HostState& host, const Exchange& exchange, std::string& error) {
+    const Address& address = exchange.address;
+    int fd = socket(address.storage.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        error = std::string("Failed to create socket: ") + std::strerror(errno);
+        return nullptr;
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifdef SO_NOSIGPIPE
+    // Where it exists; writes pass MSG_NOSIGNAL otherwise
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+    int result = connect(fd, reinterpret_cast<const sockaddr*>(&address.storage), address.length);
+    if (result < 0 && errno != EINPROGRESS) {
+        error = std::string("Failed to connect: ") + std::strerror(errno);
+        close(fd);
+        return nullptr;
+    }
+
+    auto connection = std::make_unique<Connection>();
+    connection->fd = fd;
+    connection->host = &host;
+    connection->connecting = result < 0;
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+    if (exchange.secure) {
+        connection->ssl = tls->open(fd, exchange.serverName, exchange.hostKey, error);
+        if (!connection->ssl) {
+            close(fd);
+            return nullptr;
+        }
+        connection->handshaking = true;
+    }
+#endif
+    connection->connectStarted = Clock::now();
+    connection->lastActivity = connection->connectStarted;
+    connection->lastUsed = connection->connectStarted;
+    connection->events = EPOLLIN | EPOLLOUT;
+
+    epoll_event event{};
+    event.events = connection->events;
+    event.data.ptr = connection.get();
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        error = std::string("Failed to watch socket: ") + std::strerror(errno);
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+        SSL_free(connection->ssl);
+#endif
+        close(fd);
+        return nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.misses++;
+    }
+    host.connections.push_back(std::move(connection));
+    return host.connections.back().get();
+}
+
+void EventHttpClient::assign(Connection& connection, std::shared_ptr<Exchange> exchange) {
+    if (connection.pipeline.empty()) {
+        connection.lastActivity = Clock::now();
+    }
+    exchange->connection = &connection;
+    connection.output += exchange->wire;
+    connection.pipeline.push_back(std::move(exchange));
+
+    if (!connection.connecting && !connection.handshaking) {
+        flush(connection);
+    }
+}
+
+void EventHttpClient::pumpWaiting(HostState& host) {
+    while (!host.waiting.empty()) {
+        std::string error;
+        Connection* connection = findConnection(host, *host.waiting.front(), error);
+        if (!connection && error.empty()) {
+            return;
+        }
+
+        auto exchange = std::move(host.waiting.front());
+        host.waiting.pop_front();
+        if (connection) {
+            assign(*connection, std::move(exchange));
+        }
+        else {
+            complete(exchange, Response{ 0, {}, error });
+        }
+    }
+}
+
+void EventHttpClient::cancelExchange(uint64_t id) {
+    auto it = exchanges.find(id);
+    if (it == exchanges.end()) {
+        return;
+    }
+    auto exchange = it->second;
+    Connection* connection = exchange->connection;
+
+    if (!connection) {
+        auto& waiting = hosts[exchange->hostKey].waiting;
+        waiting.erase(std::remove(waiting.begin(), waiting.end(), exchange), waiting.end());
+        auto parked = resolving.find(exchange->serverName + ":" + exchange->port);
+        if (parked != resolving.end()) {
+            auto& lookingUp = parked->second;
+            lookingUp.erase(std::remove(lookingUp.begin(), lookingUp.end(), exchange), lookingUp.end());
+        }
+        complete(exchange, Response{ 0, {}, "Canceled" });
+        return;
+    }
+
+    if (connection->pipeline.front() == exchange) {
+        // Its response may be half read - the connection can't be reused
+        connection->pipeline.pop_front();
+        complete(exchange, Response{ 0, {}, "Canceled" });
+        closeConnection(*connection, "Canceled", false);
+        return;
+    }
+
+    // Already sent behind other requests: keep a placeholder that swallows the response
+    auto placeholder = std::make_shared<Exchange>();
+    placeholder->request.timeouts = exchange->request.timeouts;
+    placeholder->connection = connection;
+    std::replace(connection->pipeline.begin(), connection->pipeline.end(), exchange, placeholder);
+    complete(exchange, Response{ 0, {}, "Canceled" });
+}
+
+void EventHttpClient::complete(const std::shared_ptr<Exchange>& exchange, Response response) {
+    if (exchange->id != 0) {
+        exchanges.erase(exchange->id);
+    }
+    exchange->connection = nullptr;
+    exchange->request.token.removeCallback(exchange->cancelRegistration);
+    exchange->cancelRegistration = 0;
+
+    auto done = std::move(exchange->done);
+    exchange->done = nullptr;
+    exchange->onResponse = nullptr;
+    exchange->onContent = nullptr;
+    if (done) {
+        try {
+            done(std::move(response));
+        }
+        catch (...) {
+            // A throwing completion must not take the loop thread down
+        }
+    }
+}
+
+void EventHttpClient::handleEvents(Connection& connection, uint32_t events) {
+    if (connection.connecting) {
+        if (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) {
+            finishConnect(connection);
+        }
+        return;
+    }
+    if (connection.handshaking) {
+        continueHandshake(connection);
+        return;
+    }
+
+    bool readable = (events & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0;
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+    readable = readable || (connection.tlsWantsWrite && (events & EPOLLOUT));
+#endif
+    if (readable) {
+        readFrom(connection);
+        if (connection.fd < 0) {
+            return;
+        }
+    }
+    if (events & EPOLLOUT) {
+        flush(connection);
+    }
+}
+
+void EventHttpClient::finishConnect(Connection& connection) {
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (getsockopt(connection.fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+        closeConnection(connection, std::string("Failed to connect: ") + std::strerror(error ? error : errno), true, true);
+        return;
+    }
+
+    connection.connecting = false;
+    connection.lastActivity = Clock::now();
+    if (connection.handshaking) {
+        continueHandshake(connection);
+        return;
+    }
+    flush(connection);
+}
+
+void EventHttpClient::continueHandshake(Connection& connection) {
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+    ERR_clear_error();
+    int result = SSL_do_handshake(connection.ssl);
+    if (result == 1) {
+        connection.handshaking = false;
+        connection.tlsWantsWrite = false;
+        connection.lastActivity = Clock::now();
+        {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            if (SSL_session_reused(connection.ssl)) {
+                stats.tlsResumptions++;
+            }
+            else {
+                stats.tlsHandshakes++;
+            }
+        }
+        flush(connection);
+        return;
+    }
+
+    int error = SSL_get_error(connection.ssl, result);
+    if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) {
+        connection.tlsWantsWrite = error == SSL_ERROR_WANT_WRITE;
+        updateEvents(connection);
+        return;
+    }
+
+    std::string reason = TlsContext::lastError();
+    long verified = SSL_get_verify_result(connection.ssl);
+    if (verified != X509_V_OK) {
+        reason = X509_verify_cert_error_string(verified);
+    }
+    closeConnection(connection, "TLS handshake failed: " + reason, true, true);
+#else
+    (void)connection;
+#endif
+}
+
+ssize_t EventHttpClient::sendSome(Connection& connection, const char* data, size_t length) {
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+    if (connection.ssl) {
+        ERR_clear_error();
+        int sent = SSL_write(connection.ssl, data, static_cast<int>(std::min<size_t>(length, INT_MAX)));
+        if (sent > 0) {
+            return sent;
+        }
+        int error = SSL_get_error(connection.ssl, sent);
+        if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) {
+            errno = EAGAIN;
+        }
+        else if (error != SSL_ERROR_SYSCALL || errno == 0 || errno == EAGAIN) {
+            errno = error == SSL_ERROR_SYSCALL ? EPIPE : EPROTO;
+        }
+        return -1;
+    }
+#endif
+    return send(connection.fd, data, length, MSG_NOSIGNAL);
+}
+
+ssize_t EventHttpClient::receiveSome(Connection& connection, char* buffer, size_t length) {
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+    if (connection.ssl) {
+        ERR_clear_error();
+        connection.tlsWantsWrite = false;
+        int received = SSL_read(connection.ssl, buffer, static_cast<int>(length));
+        if (received > 0) {
+            return received;
+        }
+        int error = SSL_get_error(connection.ssl, received);
+        if (error == SSL_ERROR_ZERO_RETURN) {
+            return 0;
+        }
+        if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) {
+            // A read may need to write, e.g. to answer a key update
+            connection.tlsWantsWrite = error == SSL_ERROR_WANT_WRITE;
+            updateEvents(connection);
+            errno = EAGAIN;
+        }
+        else if (error != SSL_ERROR_SYSCALL || errno == 0 || errno == EAGAIN) {
+            errno = error == SSL_ERROR_SYSCALL ? ECONNRESET : EPROTO;
+        }
+        return -1;
+    }
+#endif
+    return recv(connection.fd, buffer, length, 0);
+}
+
+void EventHttpClient::flush(Connection& connection) {
+    while (connection.outputOffset < connection.output.size()) {
+        ssize_t sent = sendSome(connection, connection.output.data() + connection.outputOffset,
+            connection.output.size() - connection.outputOffset);
+        if (sent > 0) {
+            connection.outputOffset += static_cast<size_t>(sent);
+        }
+        else if (errno == EINTR) {
+            continue;
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        }
+        else {
+            // A keep-alive connection the server already closed: nothing was answered, resend
+            closeConnection(connection, std::string("Failed to send request: ") + std::strerror(errno),
+                !connection.reused || connection.parser.hasStarted());
+            return;
+        }
+    }
+
+    if (connection.outputOffset == connection.output.size()) {
+        connection.output.clear();
+        connection.outputOffset = 0;
+    }
+    updateEvents(connection);
+}
+
+void EventHttpClient::readFrom(Connection& connection) {
+    char buffer[16 * 1024];
+    while (true) {
+        ssize_t received = receiveSome(connection, buffer, sizeof(buffer));
+        if (received > 0) {
+            connection.lastActivity = Clock::now();
+            if (!consume(connection, buffer, static_cast<size_t>(received))) {
+                return;
+            }
+            continue;
+        }
+
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+
+        // Closed by the server, or a socket error
+        std::string error = received == 0 ? "Connection closed" : std::string("Connection reset: ") + std::strerror(errno);
+        bool failFront = !connection.reused || connection.parser.hasStarted();
+        if (!connection.pipeline.empty() && connection.parser.finishOnClose() == HttpResponseParser::Status::Complete) {
+            // The body was delimited by the close
+            auto exchange = connection.pipeline.front();
+            connection.pipeline.pop_front();
+            complete(exchange, connection.parser.getHead());
+            failFront = false;
+        }
+        closeConnection(connection, error, failFront);
+        return;
+    }
+}
+
+bool EventHttpClient::consume(Connection& connection, const char* data, size_t length) {
+    size_t offset = 0;
+    while (offset < length) {
+        if (connection.pipeline.empty()) {
+            closeConnection(connection, "Unexpected data from server", false);
+            return false;
+        }
+
+        auto exchange = connection.pipeline.front();
+        size_t consumed = 0;
+        auto status = connection.parser.feed(data + offset, length - offset, consumed, exchange->onResponse, exchange->onContent);
+        offset += consumed;
+
+        if (status == HttpResponseParser::Status::Failed) {
+            closeConnection(connection, connection.parser.getError(), true);
+            return false;
+        }
+        if (status == HttpResponseParser::Status::NeedMore) {
+            break;
+        }
+
+        Response response = connection.parser.getHead();
+        bool keepAlive = connection.parser.keepAlive();
+        connection.pipeline.pop_front();
+        connection.parser.reset();
+        connection.reused = true;
+        connection.lastUsed = Clock::now();
+        complete(exchange, std::move(response));
+
+        if (!keepAlive) {
+            // Requests pipelined behind the last answer are resent on another connection
+            closeConnection(connection, "Connection closed by server", false);
+            return false;
+        }
+    }
+
+    if (connection.pipeline.size() < loopPipelineDepth) {
+        pumpWaiting(*connection.host);
+    }
+    return true;
+}
+
+void EventHttpClient::updateEvents(Connection& connection) {
+    uint32_t wanted = EPOLLIN;
+    if (connection.connecting || (!connection.handshaking && connection.outputOffset < connection.output.size())) {
+        wanted |= EPOLLOUT;
+    }
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+    if (connection.tlsWantsWrite) {
+        wanted |= EPOLLOUT;
+    }
+#endif
+    if (wanted != connection.events) {
+        epoll_event event{};
+        event.events = wanted;
+        event.data.ptr = &connection;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+        connection.events = wanted;
+    }
+}
+
+void EventHttpClient::closeConnection(Connection& connection, const std::string& error, bool failFront, bool failAll) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, connection.fd, nullptr);
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+    if (connection.ssl) {
+        // OpenSSL drops the session of a connection that ends without a shutdown;
+        // a quiet one keeps it resumable without writing to a socket that may be gone
+        if (!connection.handshaking) {
+            SSL_set_quiet_shutdown(connection.ssl, 1);
+            SSL_shutdown(connection.ssl);
+        }
+        SSL_free(connection.ssl);
+        connection.ssl = nullptr;
+    }
+#endif
+    close(connection.fd);
+    connection.fd = -1;
+
+    HostState& host = *connection.host;
+    auto pipeline = std::move(connection.pipeline);
+    connection.pipeline.clear();
+
+    // Keep the object alive until the loop is done with this batch of events
+    auto it = std::find_if(host.connections.begin(), host.connections.end(),
+        [&connection](const std::unique_ptr<Connection>& candidate) { return candidate.get() == &connection; });
+    if (it != host.connections.end()) {
+        closed.push_back(std::move(*it));
+        host.connections.erase(it);
+    }
+
+    std::vector<std::shared_ptr<Exchange>> requeued;
+    bool front = true;
+    for (auto& exchange : pipeline) {
+        bool fail = failAll || (front && failFront);
+        front = false;
+        exchange->connection = nullptr;
+        if (exchange->id == 0) {
+            continue;
+        }
+        if (fail || ++exchange->requeues > kMaxRequeues || !running.load()) {
+            complete(exchange, Response{ 0, {}, error });
+        }
+        else {
+            requeued.push_back(exchange);
+        }
+    }
+
+    // Requeued requests go first, in their original order
+    host.waiting.insert(host.waiting.begin(), requeued.begin(), requeued.end());
+    if (running.load()) {
+        pumpWaiting(host);
+    }
+}
+#endif
\ No newline at end of file
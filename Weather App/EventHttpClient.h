@@ -0,0 +1,199 @@
+/**
+ * @file EventHttpClient.h
+ * @brief Non-blocking HTTP/1.1 client engine driven by a single epoll loop (Linux only)
+ */
+#pragma once
+#ifdef __linux__
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <sys/socket.h>
+#include "HttpTransport.h"
+#include "HttpResponseParser.h"
+#include "TlsContext.h"
+
+/**
+ * @class EventHttpClient
+ * @brief HttpTransport that multiplexes every request over one I/O thread
+ *
+ * Sockets are non-blocking and watched by a single epoll loop, so outstanding
+ * requests cost a small struct instead of a thread. Each host gets a bounded set
+ * of keep-alive connections; when all of them are busy, requests are pipelined
+ * onto the least loaded one up to the pipeline depth, and queued beyond that.
+ * Pipelining is off by default (depth 1): some servers, cpp-httplib's among
+ * them, drop requests that arrive behind another one on the same connection.
+ * Callbacks run on the loop thread and must not block.
+ *
+ * Host names are looked up on a resolver thread of their own, so neither the
+ * caller nor the loop waits for DNS; requests for a host being looked up are
+ * parked until the answer arrives, and answers are cached for a few minutes.
+ *
+ * Requests that were sent on a keep-alive connection the server closed before
+ * answering are resent on a new connection, since every request is a GET.
+ *
+ * https:// hosts (with CPPHTTPLIB_OPENSSL_SUPPORT) handshake on the loop thread
+ * like any other I/O, keep their connections warm the same way, and resume the
+ * last TLS session of the host on every new connection.
+ */
+class EventHttpClient : public HttpTransport {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr int kMaxRequeues = 3;
+
+    struct Connection;
+    struct HostState;
+
+    struct Address {
+        sockaddr_storage storage;
+        socklen_t length = 0;
+        Clock::time_point resolvedAt;
+    };
+
+    struct Exchange {
+        uint64_t id = 0;                    // 0 for a cancelled request whose response is still expected
+        Request request;
+        std::string hostKey;                // Authority, prefixed with https:// for TLS hosts
+        std::string serverName;             // Host name without the port, checked against the certificate
+        std::string port;
+        bool secure = false;
+        Address address;                    // Empty until the server name is resolved
+        std::string wire;                   // Serialized request
+        ResponseHandler onResponse;
+        ContentReceiver onContent;
+        Completion done;
+        size_t cancelRegistration = 0;
+        Connection* connection = nullptr;   // Null while waiting for a connection
+        int requeues = 0;
+    };
+
+    struct Connection {
+        int fd = -1;
+        HostState* host = nullptr;
+        bool connecting = true;
+        bool handshaking = false;           // TLS handshake in progress
+        bool reused = false;                // Completed at least one response
+        uint32_t events = 0;
+        std::deque<std::shared_ptr<Exchange>> pipeline;   // Sent requests in order, the front is being answered
+        std::string output;
+        size_t outputOffset = 0;
+        HttpResponseParser parser;
+        Clock::time_point connectStarted;
+        Clock::time_point lastActivity;
+        Clock::time_point lastUsed;
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+        SSL* ssl = nullptr;
+        bool tlsWantsWrite = false;         // The last TLS read or handshake step waits for the socket to drain
+#endif
+    };
+
+    struct Resolution {
+        std::string key;                    // name:port
+        Address address;                    // Empty if the lookup failed
+        std::string error;
+    };
+
+    struct HostState {
+        std::deque<std::shared_ptr<Exchange>> waiting;
+        std::vector<std::unique_ptr<Connection>> connections;
+    };
+
+    int epollFd;
+    int wakeFd;
+    std::atomic<bool> running;
+    std::atomic<uint64_t> nextId;
+
+    // Requests and cancellations from other threads, applied by the loop
+    std::mutex commandMutex;
+    std::vector<std::shared_ptr<Exchange>> submitted;
+    std::vector<uint64_t> cancelled;
+    std::vector<Resolution> resolutions;
+    size_t maxConnectionsPerHost;
+    std::chrono::seconds idleTimeout;
+    size_t pipelineDepth;
+
+    // Host names (name and port) for the resolver thread to look up
+    std::mutex resolverMutex;
+    std::condition_variable resolverReady;
+    std::deque<std::pair<std::string, std::string>> lookups;
+
+    mutable std::mutex statsMutex;
+    HttpPoolStats stats;
+
+    // Owned by the loop thread
+    std::unordered_map<std::string, HostState> hosts;
+    std::unordered_map<uint64_t, std::shared_ptr<Exchange>> exchanges;
+    std::vector<std::unique_ptr<Connection>> closed;
+    std::unordered_map<std::string, Address> addresses;     // Resolved name:port
+    std::unordered_map<std::string, std::vector<std::shared_ptr<Exchange>>> resolving;   // Requests parked per name:port being looked up
+    size_t loopMaxConnections;
+    Clock::duration loopIdleTimeout;
+    size_t loopPipelineDepth;
+
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+    std::unique_ptr<TlsContext> tls;
+#endif
+
+    std::thread loopThread;
+    std::thread resolverThread;
+
+    void runResolver();
+    bool resolve(const std::string& name, const std::string& port, Address& address, std::string& error);
+    void wake();
+    void run();
+    void drainCommands();
+    int nextTimeout(Clock::time_point now);
+    void checkDeadlines(Clock::time_point now);
+    void publishStats();
+
+    void dispatch(std::shared_ptr<Exchange> exchange);
+    Connection* findConnection(HostState& host, const Exchange& exchange, std::string& error);
+    Connection* openConnection(HostState& host, const Exchange& exchange, std::string& error);
+    void assign(Connection& connection, std::shared_ptr<Exchange> exchange);
+    void pumpWaiting(HostState& host);
+    void cancelExchange(uint64_t id);
+    void complete(const std::shared_ptr<Exchange>& exchange, Response response);
+
+    void handleEvents(Connection& connection, uint32_t events);
+    void finishConnect(Connection& connection);
+    void continueHandshake(Connection& connection);
+    ssize_t sendSome(Connection& connection, const char* data, size_t length);
+    ssize_t receiveSome(Connection& connection, char* buffer, size_t length);
+    void flush(Connection& connection);
+    void readFrom(Connection& connection);
+    bool consume(Connection& connection, const char* data, size_t length);
+    void updateEvents(Connection& connection);
+
+    /**
+     * @brief Close a connection and settle the requests on it
+     * @param failFront Fail the request being answered instead of resending it
+     * @param failAll Fail every request on the connection, e.g. when it never connected
+     */
+    void closeConnection(Connection& connection, const std::string& error, bool failFront, bool failAll = false);
+
+public:
+    /**
+     * @brief Constructor
+     * @param pipelineDepth Requests a connection may carry at once; 1 disables pipelining
+     * @param tlsOptions Certificate checks and session resumption of https:// hosts
+     * @throws std::runtime_error if the event loop or the TLS context can't be created
+     */
+    explicit EventHttpClient(size_t pipelineDepth = 1, const TlsOptions& tlsOptions = {});
+    ~EventHttpClient() override;
+
+    EventHttpClient(const EventHttpClient&) = delete;
+    EventHttpClient& operator=(const EventHttpClient&) = delete;
+
+    void get(Request request, ResponseHandler onResponse, ContentReceiver onContent, Completion done) override;
+    void configure(size_t maxConnectionsPerHost, std::chrono::seconds idleTimeout) override;
+    HttpPoolStats getStats() const override;
+};
+#endif
\ No newline at end of file
@@ -8,8 +8,8 @@
 
 namespace fs = std::filesystem;
 
-FavoriteCities::FavoriteCities(const std::string& saveFilePath)
-    : saveFilePath(saveFilePath) {
+FavoriteCities::FavoriteCities(const std::string& saveFilePath, std::shared_ptr<CityRegistry> registry)
+    : saveFilePath(saveFilePath), registry(std::move(registry)) {
     loadFromFile();
 }
 
@@ -17,30 +17,46 @@ FavoriteCities::~FavoriteCities() {
     saveToFile();
 }
 
-void FavoriteCities::addFavorite(const std::string& cityName) {
+// Cities merged in the registry since the last look become one favorite
+void FavoriteCities::canonicalizeLocked() const {
+    unsigned long long merges = registry->mergeCount();
+    if (merges == seenMerges) {
+        return;
+    }
+    seenMerges = merges;
+    std::unordered_set<CityId> canonical;
+    for (CityId city : favorites) {
+        canonical.insert(registry->canonical(city));
+    }
+    favorites = std::move(canonical);
+}
+
+void FavoriteCities::addFavorite(CityId city) {
     std::lock_guard<std::mutex> lock(favoritesMutex);
-    favorites.insert(cityName);
-    saveToFile();
+    canonicalizeLocked();
+    favorites.insert(registry->canonical(city));
+    saveLocked();
 }
 
-void FavoriteCities::removeFavorite(const std::string& cityName) {
+void FavoriteCities::removeFavorite(CityId city) {
     std::lock_guard<std::mutex> lock(favoritesMutex);
-    favorites.erase(cityName);
-    saveToFile();
+    canonicalizeLocked();
+    favorites.erase(registry->canonical(city));
+    saveLocked();
 }
 
-bool FavoriteCities::isFavorite(const std::string& cityName) const {
+bool FavoriteCities::isFavorite(CityId city) const {
     std::lock_guard<std::mutex> lock(favoritesMutex);
-    return favorites.find(cityName) != favorites.end();
+    canonicalizeLocked();
+    return favorites.find(registry->canonical(city)) != favorites.end();
 }
 
-std::vector<std::string> FavoriteCities::getAllFavorites() const {
+std::vector<CityId> FavoriteCities::getAllFavorites() const {
     std::lock_guard<std::mutex> lock(favoritesMutex);
-    std::vector<std::string> result;
-    result.reserve(favorites.size());
-    for (const auto& city : favorites) {
-        result.push_back(city);
-    }
+    canonicalizeLocked();
+    std::vector<CityId> result(favorites.begin(), favorites.end());
+    // In the order the cities became known, not hash order
+    std::sort(result.begin(), result.end());
     return result;
 }
 
@@ -56,8 +72,9 @@ void FavoriteCities::loadFromFile() {
     if (file.is_open()) {
         std::string line;
         while (std::getline(file, line)) {
-            if (!line.empty()) {
-                favorites.insert(line);
+            CityId city = registry->intern(line);
+            if (city != CityRegistry::kNoCity) {
+                favorites.insert(city);
             }
         }
         file.close();
@@ -66,16 +83,24 @@ void FavoriteCities::loadFromFile() {
 
 void FavoriteCities::saveToFile() const {
     std::lock_guard<std::mutex> lock(favoritesMutex);
+    saveLocked();
+}
+
+void FavoriteCities::saveLocked() const {
+    canonicalizeLocked();
 
     fs::path path(saveFilePath);
     if (path.has_parent_path()) {
         fs::create_directories(path.parent_path());
     }
 
+    std::vector<CityId> cities(favorites.begin(), favorites.end());
+    std::sort(cities.begin(), cities.end());
+
     std::ofstream file(saveFilePath);
     if (file.is_open()) {
-        for (const auto& city : favorites) {
-            file << city << std::endl;
+        for (CityId city : cities) {
+            file << registry->name(city) << std::endl;
         }
         file.close();
     }
@@ -6,28 +6,38 @@
 #include <string>
 #include <vector>
 #include <unordered_set>
+#include <memory>
 #include <mutex>
 #include <fstream>
 #include <filesystem>
+#include "CityRegistry.h"
 
  /**
   * @class FavoriteCities
   * @brief Class for managing favorite cities with thread-safe access and file persistence
+  *
+  * Favorites are held as canonical city IDs, so two spellings of one city are
+  * one favorite. The file keeps the registry's display names.
   */
 class FavoriteCities {
 private:
-    std::unordered_set<std::string> favorites;
+    mutable std::unordered_set<CityId> favorites;   // Canonicalized lazily, also by const readers
     mutable std::mutex favoritesMutex;
     std::string saveFilePath;
+    std::shared_ptr<CityRegistry> registry;
+    mutable unsigned long long seenMerges = 0;
+
+    void canonicalizeLocked() const;
+    void saveLocked() const;
 
 public:
-    FavoriteCities(const std::string& saveFilePath);
+    FavoriteCities(const std::string& saveFilePath, std::shared_ptr<CityRegistry> registry);
     ~FavoriteCities();
 
-    void addFavorite(const std::string& cityName);
-    void removeFavorite(const std::string& cityName);
-    bool isFavorite(const std::string& cityName) const;
-    std::vector<std::string> getAllFavorites() const;
+    void addFavorite(CityId city);
+    void removeFavorite(CityId city);
+    bool isFavorite(CityId city) const;
+    std::vector<CityId> getAllFavorites() const;
 
     void loadFromFile();
     void saveToFile() const;
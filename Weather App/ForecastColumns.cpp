@@ -0,0 +1,209 @@
+/**
+ * @file ForecastColumns.cpp
+ * @brief Implementation of the ForecastColumns class
+ */
+#include "ForecastColumns.h"
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FORECAST_COLUMNS_SSE2 1
+#endif
+
+namespace {
+
+    constexpr size_t kLanes = 4;                // Floats per SSE register
+    constexpr long long kSecondsPerDay = 86400;
+
+    long long floorDiv(long long value, long long divisor) {
+        long long quotient = value / divisor;
+        return (value % divisor != 0 && (value < 0) != (divisor < 0)) ? quotient - 1 : quotient;
+    }
+
+}
+
+WeatherCondition parseWeatherCondition(std::string_view weatherMain) {
+    if (weatherMain == "Clear") return WeatherCondition::Clear;
+    if (weatherMain == "Clouds") return WeatherCondition::Clouds;
+    if (weatherMain == "Drizzle") return WeatherCondition::Drizzle;
+    if (weatherMain == "Rain") return WeatherCondition::Rain;
+    if (weatherMain == "Thunderstorm") return WeatherCondition::Thunderstorm;
+    if (weatherMain == "Snow") return WeatherCondition::Snow;
+    if (weatherMain.empty()) return WeatherCondition::Unknown;
+    // The provider's remaining groups are all atmosphere: Mist, Smoke, Haze, Dust, Fog, Sand, Ash, Squall, Tornado
+    return WeatherCondition::Atmosphere;
+}
+
+ForecastColumns::ForecastColumns(size_t cities, long long startTime, size_t steps, long long stepSeconds)
+    : cities(cities),
+    stride((cities + kLanes - 1) / kLanes * kLanes),
+    steps(steps),
+    startTime(startTime),
+    stepSeconds(stepSeconds) {
+    const float missing = std::numeric_limits<float>::quiet_NaN();
+    temperature.assign(steps * stride, missing);
+    humidity.assign(steps * stride, missing);
+    windSpeed.assign(steps * stride, missing);
+    pressure.assign(steps * stride, missing);
+    conditions.assign(steps * stride, WeatherCondition::Unknown);
+
+    // Steps only move forward in time, so each day is one run of them
+    dayFirstStep.push_back(0);
+    for (size_t step = 1; step < steps; ++step) {
+        if (floorDiv(stepTime(step), kSecondsPerDay) != floorDiv(stepTime(step - 1), kSecondsPerDay)) {
+            dayFirstStep.push_back(step);
+        }
+    }
+    if (steps > 0) {
+        dayFirstStep.push_back(steps);
+    }
+}
+
+ForecastColumns ForecastColumns::capture(const WeatherData& data) {
+    const long long stepSeconds = 10800;
+
+    std::vector<CityId> ids = data.getAllCityIds();
+    std::vector<std::shared_ptr<const std::vector<ForecastInfo>>> forecasts;
+    forecasts.reserve(ids.size());
+    long long first = std::numeric_limits<long long>::max();
+    long long last = std::numeric_limits<long long>::min();
+    for (CityId city : ids) {
+        std::shared_ptr<const CitySnapshot> snapshot = data.getSnapshot(city);
+        forecasts.push_back(snapshot ? snapshot->forecast : nullptr);
+        if (forecasts.back()) {
+            for (const auto& item : *forecasts.back()) {
+                first = std::min(first, item.dateTime);
+                last = std::max(last, item.dateTime);
+            }
+        }
+    }
+    // Every ID listed above is below the registry's size by now
+    size_t cityCount = data.getRegistry()->size();
+    if (first > last) {
+        return ForecastColumns(cityCount, 0, 0, stepSeconds);
+    }
+
+    first = floorDiv(first, stepSeconds) * stepSeconds;
+    ForecastColumns columns(cityCount, first, static_cast<size_t>((last - first) / stepSeconds) + 1, stepSeconds);
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (forecasts[i]) {
+            columns.assign(ids[i], *forecasts[i]);
+        }
+    }
+    return columns;
+}
+
+void ForecastColumns::assign(CityId city, const std::vector<ForecastInfo>& forecast) {
+    if (city >= cities) {
+        return;
+    }
+    const float missing = std::numeric_limits<float>::quiet_NaN();
+    for (size_t step = 0; step < steps; ++step) {
+        size_t at = step * stride + city;
+        temperature[at] = missing;
+        humidity[at] = missing;
+        windSpeed[at] = missing;
+        pressure[at] = missing;
+        conditions[at] = WeatherCondition::Unknown;
+    }
+
+    for (const auto& item : forecast) {
+        long long offset = item.dateTime - startTime;
+        if (offset < 0 || offset % stepSeconds != 0 || static_cast<size_t>(offset / stepSeconds) >= steps) {
+            continue;
+        }
+        size_t at = static_cast<size_t>(offset / stepSeconds) * stride + city;
+        temperature[at] = static_cast<float>(item.temperature);
+        humidity[at] = static_cast<float>(item.humidity);
+        windSpeed[at] = static_cast<float>(item.windSpeed);
+        pressure[at] = static_cast<float>(item.pressure);
+        conditions[at] = parseWeatherCondition(item.weatherMain);
+    }
+}
+
+const std::vector<float>& ForecastColumns::column(ForecastField field) const {
+    switch (field) {
+    case ForecastField::Humidity: return humidity;
+    case ForecastField::WindSpeed: return windSpeed;
+    case ForecastField::Pressure: return pressure;
+    case ForecastField::Temperature: break;
+    }
+    return temperature;
+}
+
+DailyStats ForecastColumns::daily(ForecastField field) const {
+    DailyStats stats;
+    stats.stride = stride;
+    size_t days = dayCount();
+    for (size_t day = 0; day < days; ++day) {
+        stats.dayStart.push_back(floorDiv(stepTime(dayFirstStep[day]), kSecondsPerDay) * kSecondsPerDay);
+    }
+    stats.min.resize(days * stride);
+    stats.max.resize(days * stride);
+    stats.sum.resize(days * stride);
+    stats.mean.resize(days * stride);
+
+    const float* values = column(field).data();
+    for (size_t day = 0; day < days; ++day) {
+        size_t first = dayFirstStep[day];
+        size_t last = dayFirstStep[day + 1];
+        float* mins = stats.min.data() + day * stride;
+        float* maxes = stats.max.data() + day * stride;
+        float* sums = stats.sum.data() + day * stride;
+        float* means = stats.mean.data() + day * stride;
+
+        // Four cities at a time, their accumulators kept in registers over the day's steps
+#ifdef FORECAST_COLUMNS_SSE2
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 infinity = _mm_set1_ps(std::numeric_limits<float>::infinity());
+        const __m128 negativeInfinity = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+        const __m128 missing = _mm_set1_ps(std::numeric_limits<float>::quiet_NaN());
+        for (size_t city = 0; city < stride; city += kLanes) {
+            __m128 low = infinity;
+            __m128 high = negativeInfinity;
+            __m128 total = zero;
+            __m128 count = zero;
+            for (size_t step = first; step < last; ++step) {
+                __m128 value = _mm_loadu_ps(values + step * stride + city);
+                __m128 present = _mm_cmpord_ps(value, value);
+                // min and max return their second operand when the first is NaN
+                low = _mm_min_ps(value, low);
+                high = _mm_max_ps(value, high);
+                total = _mm_add_ps(total, _mm_and_ps(present, value));
+                count = _mm_add_ps(count, _mm_and_ps(present, one));
+            }
+            __m128 empty = _mm_cmpeq_ps(count, zero);
+            _mm_storeu_ps(mins + city, _mm_or_ps(_mm_and_ps(empty, missing), _mm_andnot_ps(empty, low)));
+            _mm_storeu_ps(maxes + city, _mm_or_ps(_mm_and_ps(empty, missing), _mm_andnot_ps(empty, high)));
+            _mm_storeu_ps(sums + city, total);
+            // 0 / 0 is NaN, as wanted for an empty day
+            _mm_storeu_ps(means + city, _mm_div_ps(total, count));
+        }
+#else
+        for (size_t city = 0; city < stride; ++city) {
+            float low = std::numeric_limits<float>::infinity();
+            float high = -std::numeric_limits<float>::infinity();
+            float total = 0.0f;
+            float count = 0.0f;
+            for (size_t step = first; step < last; ++step) {
+                float value = values[step * stride + city];
+                if (value == value) {
+                    low = std::min(low, value);
+                    high = std::max(high, value);
+                    total += value;
+                    count += 1.0f;
+                }
+            }
+            bool empty = count == 0.0f;
+            mins[city] = empty ? std::numeric_limits<float>::quiet_NaN() : low;
+            maxes[city] = empty ? std::numeric_limits<float>::quiet_NaN() : high;
+            sums[city] = total;
+            means[city] = empty ? std::numeric_limits<float>::quiet_NaN() : total / count;
+        }
+#endif
+    }
+    return stats;
+}
@@ -0,0 +1,120 @@
+/**
+ * @file ForecastColumns.h
+ * @brief Column-wise forecast store with vectorized per-day aggregation across cities
+ */
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "CityRegistry.h"
+#include "WeatherData.h"
+
+/**
+ * @brief Weather condition group, as the provider's "main" field names it
+ */
+enum class WeatherCondition : std::uint8_t {
+    Unknown,
+    Clear,
+    Clouds,
+    Drizzle,
+    Rain,
+    Thunderstorm,
+    Snow,
+    Atmosphere      // Mist, fog, haze, dust and the like
+};
+
+WeatherCondition parseWeatherCondition(std::string_view weatherMain);
+
+/**
+ * @brief Numeric forecast fields kept as columns
+ */
+enum class ForecastField {
+    Temperature,
+    Humidity,
+    WindSpeed,
+    Pressure
+};
+
+/**
+ * @struct DailyStats
+ * @brief One field aggregated per city and UTC day
+ *
+ * Rows are days and columns cities, stride floats apart. A city without any
+ * forecast step in a day has NaN min, max and mean there and a sum of zero.
+ */
+struct DailyStats {
+    size_t stride = 0;                  // Floats per day row, at least the number of cities
+    std::vector<long long> dayStart;    // Unix time of each day's UTC midnight
+    std::vector<float> min;
+    std::vector<float> max;
+    std::vector<float> sum;
+    std::vector<float> mean;
+
+    size_t index(size_t day, CityId city) const { return day * stride + city; }
+};
+
+/**
+ * @class ForecastColumns
+ * @brief Forecasts of many cities on one time grid, one array per field
+ *
+ * ForecastInfo holds nine doubles and three strings per step, so scanning one
+ * field over all cities drags every string through the cache. Here each field
+ * is a float array laid out step by step, with all cities of a step next to
+ * each other, and conditions are one byte each. Aggregating a field over a
+ * day then reads contiguous floats and combines four cities per instruction.
+ *
+ * Steps the forecast of a city doesn't cover hold NaN, which the kernels skip.
+ * Filled once and then only read; build a new one to take in newer forecasts.
+ */
+class ForecastColumns {
+private:
+    size_t cities;
+    size_t stride;          // cities rounded up to a whole number of vector lanes
+    size_t steps;
+    long long startTime;
+    long long stepSeconds;
+
+    std::vector<float> temperature;
+    std::vector<float> humidity;
+    std::vector<float> windSpeed;
+    std::vector<float> pressure;
+    std::vector<WeatherCondition> conditions;
+
+    std::vector<size_t> dayFirstStep;   // Steps of day d are dayFirstStep[d] until dayFirstStep[d + 1]
+
+    const std::vector<float>& column(ForecastField field) const;
+
+public:
+    /**
+     * @param cities Number of city IDs to make room for; IDs from zero up to it
+     * @param startTime Unix time of the first step
+     * @param steps Steps per city
+     * @param stepSeconds Time between steps; the provider forecasts in 3 hour steps
+     */
+    ForecastColumns(size_t cities, long long startTime, size_t steps = 40, long long stepSeconds = 10800);
+
+    /**
+     * @brief Columns holding the forecasts of every city in a WeatherData
+     *
+     * The grid starts at the earliest forecast step and runs to the latest.
+     */
+    static ForecastColumns capture(const WeatherData& data);
+
+    /**
+     * @brief Store a city's forecast; entries off the time grid are dropped
+     */
+    void assign(CityId city, const std::vector<ForecastInfo>& forecast);
+
+    size_t cityCount() const { return cities; }
+    size_t stepCount() const { return steps; }
+    size_t dayCount() const { return dayFirstStep.size() - 1; }
+    long long stepTime(size_t step) const { return startTime + static_cast<long long>(step) * stepSeconds; }
+
+    float value(ForecastField field, size_t step, CityId city) const { return column(field)[step * stride + city]; }
+    WeatherCondition condition(size_t step, CityId city) const { return conditions[step * stride + city]; }
+
+    /**
+     * @brief Min, max, sum and mean of a field for every city and day
+     */
+    DailyStats daily(ForecastField field) const;
+};
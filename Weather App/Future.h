@@ -0,0 +1,325 @@
+/**
+ * @file Future.h
+ * @brief Future with continuations on a ThreadPool, and whenAll() to join several of them
+ */
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "RequestPriority.h"
+#include "ThreadPool.h"
+#include "UniqueTask.h"
+
+template<class T>
+class Promise;
+
+/**
+ * @class Future
+ * @brief Single-assignment result like std::future that can also be chained
+ *
+ * get() blocks like std::future::get(). then() instead runs a continuation on
+ * a ThreadPool once the result is there, without any thread waiting for it,
+ * and returns a future for the continuation's result. The continuation gets
+ * the finished future, so it decides itself whether to get() the value or
+ * handle the error. Both get() and then() consume the future.
+ */
+template<class T>
+class Future {
+private:
+    friend class Promise<T>;
+
+    using Stored = std::conditional_t<std::is_void_v<T>, bool, T>;
+
+    struct State {
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::optional<Stored> value;
+        std::exception_ptr error;
+        bool done = false;
+        UniqueTask continuation;
+
+        void complete() {
+            UniqueTask next;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                done = true;
+                next = std::move(continuation);
+            }
+            ready.notify_all();
+            if (next) {
+                next();
+            }
+        }
+    };
+
+    std::shared_ptr<State> state;
+
+    explicit Future(std::shared_ptr<State> state) : state(std::move(state)) {}
+
+    void checkValid() const {
+        if (!state) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+    }
+
+public:
+    Future() = default;
+
+    bool valid() const { return state != nullptr; }
+
+    bool isReady() const {
+        checkValid();
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->done;
+    }
+
+    void wait() const {
+        checkValid();
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->ready.wait(lock, [this] { return state->done; });
+    }
+
+    /**
+     * @brief Wait for the result and take it
+     * @throws Whatever the producer failed with
+     */
+    T get() {
+        wait();
+        std::shared_ptr<State> finished = std::move(state);
+        if (finished->error) {
+            std::rethrow_exception(finished->error);
+        }
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(*finished->value);
+        }
+    }
+
+    /**
+     * @brief Run callback on the thread that completes the future, or right away if it is done
+     *
+     * For short bookkeeping only, since that thread may be an I/O or timer thread; one callback
+     * per future. then() is the way to run real work.
+     */
+    void onReady(UniqueTask callback) {
+        checkValid();
+        std::shared_ptr<State> current = state;
+        {
+            std::lock_guard<std::mutex> lock(current->mutex);
+            if (!current->done) {
+                current->continuation = std::move(callback);
+                return;
+            }
+        }
+        callback();
+    }
+
+    /**
+     * @brief Run f(Future<T>) on the pool once this future is ready
+     * @param pool Pool the continuation is posted to
+     * @param f Continuation; receives the finished future
+     * @param priority Lane of the pool the continuation runs in
+     * @return Future for what f returns, or for the exception it throws
+     */
+    template<class F>
+    auto then(ThreadPool& pool, F&& f, RequestPriority priority = RequestPriority::Background)
+        -> Future<std::invoke_result_t<std::decay_t<F>&, Future<T>>>;
+};
+
+/**
+ * @class Promise
+ * @brief Producer side of a Future; move-only, like std::promise
+ *
+ * A promise destroyed without a result breaks its future with
+ * std::future_errc::broken_promise, so continuations always run.
+ */
+template<class T>
+class Promise {
+private:
+    using State = typename Future<T>::State;
+
+    std::shared_ptr<State> state;
+    bool retrieved = false;
+
+    State& unsatisfied() {
+        if (!state) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->done || state->value || state->error) {
+            throw std::future_error(std::future_errc::promise_already_satisfied);
+        }
+        return *state;
+    }
+
+    void abandon() {
+        if (!state) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->done || state->value || state->error) {
+                return;
+            }
+            state->error = std::make_exception_ptr(std::future_error(std::future_errc::broken_promise));
+        }
+        state->complete();
+    }
+
+public:
+    Promise() : state(std::make_shared<State>()) {}
+    Promise(Promise&&) noexcept = default;
+
+    Promise& operator=(Promise&& other) noexcept {
+        if (this != &other) {
+            abandon();
+            state = std::move(other.state);
+            retrieved = other.retrieved;
+        }
+        return *this;
+    }
+
+    Promise(const Promise&) = delete;
+    Promise& operator=(const Promise&) = delete;
+
+    ~Promise() { abandon(); }
+
+    Future<T> getFuture() {
+        if (!state) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+        if (retrieved) {
+            throw std::future_error(std::future_errc::future_already_retrieved);
+        }
+        retrieved = true;
+        return Future<T>(state);
+    }
+
+    template<class U = T, class = std::enable_if_t<!std::is_void_v<U>>>
+    void setValue(U value) {
+        State& current = unsatisfied();
+        {
+            std::lock_guard<std::mutex> lock(current.mutex);
+            current.value.emplace(std::move(value));
+        }
+        current.complete();
+    }
+
+    template<class U = T, class = std::enable_if_t<std::is_void_v<U>>>
+    void setValue() {
+        State& current = unsatisfied();
+        {
+            std::lock_guard<std::mutex> lock(current.mutex);
+            current.value.emplace(true);
+        }
+        current.complete();
+    }
+
+    void setException(std::exception_ptr error) {
+        State& current = unsatisfied();
+        {
+            std::lock_guard<std::mutex> lock(current.mutex);
+            current.error = error;
+        }
+        current.complete();
+    }
+};
+
+template<class T>
+template<class F>
+auto Future<T>::then(ThreadPool& pool, F&& f, RequestPriority priority)
+-> Future<std::invoke_result_t<std::decay_t<F>&, Future<T>>> {
+    using Result = std::invoke_result_t<std::decay_t<F>&, Future<T>>;
+
+    checkValid();
+    Promise<Result> promise;
+    Future<Result> result = promise.getFuture();
+    std::shared_ptr<State> source = std::move(state);
+    Future<T>(source).onReady([source, pool = &pool, priority, f = std::forward<F>(f), promise = std::move(promise)]() mutable {
+        try {
+            pool->post([source = std::move(source), f = std::move(f), promise = std::move(promise)]() mutable {
+                try {
+                    if constexpr (std::is_void_v<Result>) {
+                        f(Future<T>(std::move(source)));
+                        promise.setValue();
+                    }
+                    else {
+                        promise.setValue(f(Future<T>(std::move(source))));
+                    }
+                }
+                catch (...) {
+                    promise.setException(std::current_exception());
+                }
+                }, priority);
+        }
+        catch (...) {
+            // The pool is stopping; the dropped promise breaks the result
+        }
+        });
+    return result;
+}
+
+/**
+ * @brief Future that is ready once every given future is, holding them all finished
+ *
+ * Errors stay inside the individual futures, so one failed request doesn't
+ * hide the others' results.
+ */
+template<class T>
+Future<std::vector<Future<T>>> whenAll(std::vector<Future<T>> futures) {
+    struct Joined {
+        std::atomic<size_t> remaining;
+        std::vector<Future<T>> futures;
+        Promise<std::vector<Future<T>>> promise;
+    };
+
+    auto joined = std::make_shared<Joined>();
+    auto result = joined->promise.getFuture();
+    size_t count = futures.size();
+    if (count == 0) {
+        joined->promise.setValue({});
+        return result;
+    }
+
+    joined->remaining = count;
+    joined->futures = std::move(futures);
+    // The last callback may run inline and move the futures out, so index rather than iterate
+    for (size_t i = 0; i < count; ++i) {
+        joined->futures[i].onReady([joined]() {
+            if (--joined->remaining == 0) {
+                joined->promise.setValue(std::move(joined->futures));
+            }
+            });
+    }
+    return result;
+}
+
+template<class... Ts>
+Future<std::tuple<Future<Ts>...>> whenAll(Future<Ts>... futures) {
+    static_assert(sizeof...(Ts) > 0, "whenAll needs at least one future");
+
+    struct Joined {
+        std::atomic<size_t> remaining{ sizeof...(Ts) };
+        std::tuple<Future<Ts>...> futures;
+        Promise<std::tuple<Future<Ts>...>> promise;
+    };
+
+    auto joined = std::make_shared<Joined>();
+    auto result = joined->promise.getFuture();
+    joined->futures = std::make_tuple(std::move(futures)...);
+    std::apply([&joined](auto&... each) {
+        (each.onReady([joined]() {
+            if (--joined->remaining == 0) {
+                joined->promise.setValue(std::move(joined->futures));
+            }
+            }), ...);
+        }, joined->futures);
+    return result;
+}
@@ -0,0 +1,259 @@
+/**
+ * @file HttpCache.cpp
+ * @brief Implementation of the HttpCache class
+ */
+#include "HttpCache.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+HttpCache::HttpCache(size_t maxEntries, std::chrono::seconds defaultMaxAge)
+    : maxEntries(std::max<size_t>(1, maxEntries)), defaultMaxAge(defaultMaxAge) {
+}
+
+void HttpCache::configure(size_t maxEntries, std::chrono::seconds defaultMaxAge, const std::string& spillDirectory) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    this->maxEntries = std::max<size_t>(1, maxEntries);
+    this->defaultMaxAge = defaultMaxAge;
+    this->spillDirectory = spillDirectory;
+
+    stats.spilledEntries = 0;
+    if (!spillDirectory.empty()) {
+        std::error_code error;
+        fs::create_directories(spillDirectory, error);
+        for (const auto& file : fs::directory_iterator(spillDirectory, error)) {
+            if (file.path().extension() == ".cache") {
+                stats.spilledEntries++;
+            }
+        }
+    }
+    evictOverflow();
+}
+
+bool HttpCache::keepsBodies() const {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return !spillDirectory.empty();
+}
+
+HttpCache::Clock::time_point HttpCache::expiryFor(const httplib::Headers& headers) const {
+    auto now = Clock::now();
+    auto cacheControl = headers.find("Cache-Control");
+    if (cacheControl == headers.end()) {
+        return now + defaultMaxAge;
+    }
+
+    std::string directives = cacheControl->second;
+    std::transform(directives.begin(), directives.end(), directives.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    if (directives.find("no-cache") != std::string::npos || directives.find("no-store") != std::string::npos) {
+        return now;
+    }
+
+    auto maxAgePos = directives.find("max-age=");
+    if (maxAgePos == std::string::npos) {
+        return now + defaultMaxAge;
+    }
+
+    long long maxAge = std::atoll(directives.c_str() + maxAgePos + 8);
+    auto age = headers.find("Age");
+    if (age != headers.end()) {
+        maxAge -= std::atoll(age->second.c_str());
+    }
+    return now + std::chrono::seconds(std::max(0LL, maxAge));
+}
+
+void HttpCache::touch(Entry& entry) {
+    lru.splice(lru.begin(), lru, entry.lruPosition);
+}
+
+void HttpCache::insert(const std::string& key, Entry entry) {
+    auto existing = entries.find(key);
+    if (existing != entries.end()) {
+        lru.erase(existing->second.lruPosition);
+        entries.erase(existing);
+    }
+
+    lru.push_front(key);
+    entry.lruPosition = lru.begin();
+    entries.emplace(key, std::move(entry));
+    evictOverflow();
+}
+
+void HttpCache::evictOverflow() {
+    while (entries.size() > maxEntries) {
+        auto it = entries.find(lru.back());
+        if (!spillDirectory.empty() && it->second.bodyBytes == it->second.body.size()) {
+            spill(it->first, it->second);
+        }
+        entries.erase(it);
+        lru.pop_back();
+    }
+}
+
+std::string HttpCache::spillPath(const std::string& key) const {
+    std::stringstream name;
+    name << std::hex << std::hash<std::string>{}(key) << ".cache";
+    return (fs::path(spillDirectory) / name.str()).string();
+}
+
+void HttpCache::spill(const std::string& key, const Entry& entry) {
+    std::ofstream file(spillPath(key), std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return;
+    }
+
+    auto expires = std::chrono::duration_cast<std::chrono::seconds>(entry.expiresAt.time_since_epoch()).count();
+    file << key << '\n' << entry.etag << '\n' << entry.lastModified << '\n'
+        << expires << '\n' << entry.body.size() << '\n';
+    file.write(entry.body.data(), static_cast<std::streamsize>(entry.body.size()));
+    if (file.good()) {
+        stats.spilledEntries++;
+    }
+}
+
+bool HttpCache::loadSpilled(const std::string& key, Entry& entry) {
+    std::string path = spillPath(key);
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::string storedKey, expires, size;
+    std::getline(file, storedKey);
+    std::getline(file, entry.etag);
+    std::getline(file, entry.lastModified);
+    std::getline(file, expires);
+    std::getline(file, size);
+    if (storedKey != key) {
+        return false;
+    }
+
+    entry.expiresAt = Clock::time_point(std::chrono::seconds(std::atoll(expires.c_str())));
+    entry.bodyBytes = static_cast<size_t>(std::atoll(size.c_str()));
+    entry.body.resize(entry.bodyBytes);
+    file.read(&entry.body[0], static_cast<std::streamsize>(entry.bodyBytes));
+    if (static_cast<size_t>(file.gcount()) != entry.bodyBytes) {
+        return false;
+    }
+
+    // The entry lives in memory again until it is evicted the next time
+    file.close();
+    std::error_code error;
+    if (fs::remove(path, error) && stats.spilledEntries > 0) {
+        stats.spilledEntries--;
+    }
+    return true;
+}
+
+HttpCache::Lookup HttpCache::lookup(const std::string& key) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    Lookup result;
+
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        Entry restored;
+        if (spillDirectory.empty() || !loadSpilled(key, restored)) {
+            return result;
+        }
+        insert(key, std::move(restored));
+        it = entries.find(key);
+    }
+
+    Entry& entry = it->second;
+    touch(entry);
+
+    result.found = true;
+    result.fresh = Clock::now() < entry.expiresAt;
+    result.decoded = entry.decoded;
+    if (!entry.decoded.has_value()) {
+        result.body = entry.body;
+    }
+
+    if (result.fresh) {
+        stats.hits++;
+        stats.bytesSaved += entry.bodyBytes;
+    }
+    else {
+        if (!entry.etag.empty()) {
+            result.validators.emplace("If-None-Match", entry.etag);
+        }
+        if (!entry.lastModified.empty()) {
+            result.validators.emplace("If-Modified-Since", entry.lastModified);
+        }
+    }
+    return result;
+}
+
+void HttpCache::store(const std::string& key, const httplib::Headers& headers, std::any decoded, size_t bodyBytes, std::string body) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    stats.misses++;
+
+    auto cacheControl = headers.find("Cache-Control");
+    if (cacheControl != headers.end() && cacheControl->second.find("no-store") != std::string::npos) {
+        return;
+    }
+
+    Entry entry;
+    auto etag = headers.find("ETag");
+    if (etag != headers.end()) {
+        entry.etag = etag->second;
+    }
+    auto lastModified = headers.find("Last-Modified");
+    if (lastModified != headers.end()) {
+        entry.lastModified = lastModified->second;
+    }
+    entry.expiresAt = expiryFor(headers);
+
+    // Nothing to gain from an entry that is already stale and cannot be revalidated
+    if (entry.expiresAt <= Clock::now() && entry.etag.empty() && entry.lastModified.empty()) {
+        return;
+    }
+
+    entry.decoded = std::move(decoded);
+    entry.bodyBytes = bodyBytes;
+    if (!spillDirectory.empty()) {
+        entry.body = std::move(body);
+    }
+    insert(key, std::move(entry));
+}
+
+std::any HttpCache::revalidated(const std::string& key, const httplib::Headers& headers) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        return std::any();
+    }
+
+    Entry& entry = it->second;
+    stats.revalidations++;
+    stats.bytesSaved += entry.bodyBytes;
+
+    entry.expiresAt = expiryFor(headers);
+    auto etag = headers.find("ETag");
+    if (etag != headers.end()) {
+        entry.etag = etag->second;
+    }
+    touch(entry);
+    return entry.decoded;
+}
+
+void HttpCache::attachDecoded(const std::string& key, std::any decoded) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        it->second.decoded = std::move(decoded);
+    }
+}
+
+HttpCacheStats HttpCache::getStats() const {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    HttpCacheStats snapshot = stats;
+    snapshot.entries = entries.size();
+    return snapshot;
+}
\ No newline at end of file
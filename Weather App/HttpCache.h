@@ -0,0 +1,125 @@
+/**
+ * @file HttpCache.h
+ * @brief HTTP response cache with max-age freshness and ETag/Last-Modified revalidation
+ */
+#pragma once
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+#include <any>
+#include "httplib.h"
+
+/**
+ * @struct HttpCacheStats
+ * @brief Snapshot of the response cache counters
+ */
+struct HttpCacheStats {
+    unsigned long long hits = 0;            // Served fresh from the cache, no request sent
+    unsigned long long revalidations = 0;   // Conditional request answered with 304 Not Modified
+    unsigned long long misses = 0;          // Full response downloaded and parsed
+    unsigned long long bytesSaved = 0;      // Body bytes not transferred thanks to hits and 304s
+    size_t entries = 0;
+    size_t spilledEntries = 0;
+
+    double hitRatio() const {
+        unsigned long long total = hits + revalidations + misses;
+        return total == 0 ? 0.0 : static_cast<double>(hits + revalidations) / total;
+    }
+};
+
+/**
+ * @class HttpCache
+ * @brief Thread-safe cache of decoded responses keyed by request path
+ *
+ * Entries keep the parsed result next to the response validators, so a fresh hit
+ * or a 304 skips both the transfer and the parse. Freshness comes from
+ * Cache-Control max-age, or a default lifetime when the server sends none.
+ * With a spill directory set, least recently used entries are written to disk
+ * (validators and raw body) instead of being dropped.
+ */
+class HttpCache {
+public:
+    /**
+     * @struct Lookup
+     * @brief Result of a cache lookup
+     */
+    struct Lookup {
+        bool found = false;
+        bool fresh = false;
+        std::any decoded;               // Parsed result, empty for entries read back from disk
+        std::string body;               // Raw body of an entry read back from disk
+        httplib::Headers validators;    // Headers for a conditional request when not fresh
+    };
+
+private:
+    using Clock = std::chrono::system_clock;
+
+    struct Entry {
+        std::string etag;
+        std::string lastModified;
+        Clock::time_point expiresAt;
+        std::any decoded;
+        std::string body;
+        size_t bodyBytes = 0;
+        std::list<std::string>::iterator lruPosition;
+    };
+
+    std::unordered_map<std::string, Entry> entries;
+    std::list<std::string> lru;
+    mutable std::mutex cacheMutex;
+    size_t maxEntries;
+    std::chrono::seconds defaultMaxAge;
+    std::string spillDirectory;
+    HttpCacheStats stats;
+
+    Clock::time_point expiryFor(const httplib::Headers& headers) const;
+    void touch(Entry& entry);
+    void insert(const std::string& key, Entry entry);
+    void evictOverflow();
+    std::string spillPath(const std::string& key) const;
+    void spill(const std::string& key, const Entry& entry);
+    bool loadSpilled(const std::string& key, Entry& entry);
+
+public:
+    HttpCache(size_t maxEntries = 256, std::chrono::seconds defaultMaxAge = std::chrono::seconds(60));
+
+    /**
+     * @brief Configure the cache
+     * @param maxEntries Entries kept in memory before the least recently used one is evicted
+     * @param defaultMaxAge Lifetime of responses without Cache-Control max-age
+     * @param spillDirectory Directory for evicted entries; empty disables the disk spill
+     */
+    void configure(size_t maxEntries, std::chrono::seconds defaultMaxAge, const std::string& spillDirectory);
+
+    /**
+     * @brief True when stored entries need their raw body (for the disk spill)
+     */
+    bool keepsBodies() const;
+
+    Lookup lookup(const std::string& key);
+
+    /**
+     * @brief Store a full 200 response
+     * @param key Cache key of the request
+     * @param headers Response headers
+     * @param decoded Parsed result
+     * @param bodyBytes Size of the transferred body
+     * @param body Raw body, only needed when keepsBodies() is true
+     */
+    void store(const std::string& key, const httplib::Headers& headers, std::any decoded, size_t bodyBytes, std::string body);
+
+    /**
+     * @brief Record a 304 Not Modified and renew the entry's freshness
+     * @return The cached parsed result, empty if it has to be parsed from the stored body
+     */
+    std::any revalidated(const std::string& key, const httplib::Headers& headers);
+
+    /**
+     * @brief Attach a parsed result to an entry that was read back from disk
+     */
+    void attachDecoded(const std::string& key, std::any decoded);
+
+    HttpCacheStats getStats() const;
+};
@@ -0,0 +1,106 @@
+/**
+ * @file HttpClientPool.cpp
+ * @brief Implementation of the HttpClientPool class
+ */
+#include "HttpClientPool.h"
+#include <algorithm>
+
+HttpClientPool::Lease::Lease(HttpClientPool* pool, const std::string& host, std::unique_ptr<httplib::Client> client)
+    : pool(pool), host(host), client(std::move(client)), reusable(true) {
+}
+
+HttpClientPool::Lease::Lease(Lease&& other) noexcept
+    : pool(other.pool), host(std::move(other.host)), client(std::move(other.client)), reusable(other.reusable) {
+    other.pool = nullptr;
+}
+
+HttpClientPool::Lease::~Lease() {
+    if (pool && client) {
+        pool->release(host, std::move(client), reusable);
+    }
+}
+
+HttpClientPool::HttpClientPool(size_t maxConnectionsPerHost, std::chrono::seconds idleTimeout)
+    : maxConnectionsPerHost(std::max<size_t>(1, maxConnectionsPerHost)), idleTimeout(idleTimeout) {
+}
+
+HttpClientPool::Lease HttpClientPool::acquire(const std::string& host) {
+    std::unique_lock<std::mutex> lock(poolMutex);
+    HostPool& hostPool = hosts[host];
+
+    evictIdleLocked(Clock::now());
+    released.wait(lock, [this, &hostPool] {
+        return !hostPool.idle.empty() || hostPool.active < maxConnectionsPerHost;
+    });
+
+    std::unique_ptr<httplib::Client> client;
+    if (!hostPool.idle.empty()) {
+        // Most recently used client first, it is the most likely to still be connected
+        client = std::move(hostPool.idle.back().client);
+        hostPool.idle.pop_back();
+        stats.hits++;
+    }
+    else {
+        client = std::make_unique<httplib::Client>(host);
+        client->set_keep_alive(true);
+        stats.misses++;
+    }
+    hostPool.active++;
+
+    return Lease(this, host, std::move(client));
+}
+
+void HttpClientPool::release(const std::string& host, std::unique_ptr<httplib::Client> client, bool reusable) {
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        HostPool& hostPool = hosts[host];
+        hostPool.active--;
+
+        size_t openConnections = hostPool.active + hostPool.idle.size();
+        if (reusable && openConnections < maxConnectionsPerHost) {
+            hostPool.idle.push_back({ std::move(client), Clock::now() });
+        }
+    }
+    released.notify_one();
+}
+
+void HttpClientPool::evictIdleLocked(Clock::time_point now) {
+    for (auto& pair : hosts) {
+        auto& idle = pair.second.idle;
+        auto expired = std::remove_if(idle.begin(), idle.end(), [this, now](const IdleClient& entry) {
+            return now - entry.lastUsed > idleTimeout;
+        });
+        stats.evictions += static_cast<unsigned long long>(std::distance(expired, idle.end()));
+        idle.erase(expired, idle.end());
+    }
+}
+
+void HttpClientPool::evictIdle() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    evictIdleLocked(Clock::now());
+}
+
+void HttpClientPool::setMaxConnectionsPerHost(size_t maxConnections) {
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        maxConnectionsPerHost = std::max<size_t>(1, maxConnections);
+    }
+    released.notify_all();
+}
+
+void HttpClientPool::setIdleTimeout(std::chrono::seconds timeout) {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    idleTimeout = timeout;
+}
+
+HttpPoolStats HttpClientPool::getStats() const {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    HttpPoolStats snapshot = stats;
+    snapshot.idleConnections = 0;
+    snapshot.activeConnections = 0;
+    for (const auto& pair : hosts) {
+        snapshot.idleConnections += pair.second.idle.size();
+        snapshot.activeConnections += pair.second.active;
+    }
+    return snapshot;
+}
\ No newline at end of file
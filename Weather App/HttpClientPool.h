@@ -0,0 +1,110 @@
+/**
+ * @file HttpClientPool.h
+ * @brief Pool of keep-alive HTTP clients reused across API requests
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <chrono>
+#include "httplib.h"
+
+/**
+ * @struct HttpPoolStats
+ * @brief Snapshot of the connection pool counters
+ */
+struct HttpPoolStats {
+    unsigned long long hits = 0;        // Requests served by an idle, already connected client
+    unsigned long long misses = 0;      // Requests that had to open a new client
+    unsigned long long evictions = 0;   // Idle clients closed after the idle timeout
+    unsigned long long tlsHandshakes = 0;   // Full TLS handshakes
+    unsigned long long tlsResumptions = 0;  // TLS handshakes that resumed a cached session
+    size_t idleConnections = 0;
+    size_t activeConnections = 0;
+};
+
+/**
+ * @class HttpClientPool
+ * @brief Thread-safe pool of keep-alive httplib clients, bounded per host
+ *
+ * A client is handed out exclusively through a Lease and goes back to the idle
+ * list when the lease is destroyed, so the next request to the same host reuses
+ * the open socket instead of paying for DNS and a new TCP handshake.
+ */
+class HttpClientPool {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct IdleClient {
+        std::unique_ptr<httplib::Client> client;
+        Clock::time_point lastUsed;
+    };
+
+    struct HostPool {
+        std::vector<IdleClient> idle;
+        size_t active = 0;
+    };
+
+    std::unordered_map<std::string, HostPool> hosts;
+    mutable std::mutex poolMutex;
+    std::condition_variable released;
+    size_t maxConnectionsPerHost;
+    std::chrono::seconds idleTimeout;
+    HttpPoolStats stats;
+
+    void release(const std::string& host, std::unique_ptr<httplib::Client> client, bool reusable);
+    void evictIdleLocked(Clock::time_point now);
+
+public:
+    /**
+     * @class Lease
+     * @brief Exclusive handle on a pooled client, returned to the pool on destruction
+     */
+    class Lease {
+    private:
+        HttpClientPool* pool;
+        std::string host;
+        std::unique_ptr<httplib::Client> client;
+        bool reusable;
+
+    public:
+        Lease(HttpClientPool* pool, const std::string& host, std::unique_ptr<httplib::Client> client);
+        Lease(Lease&& other) noexcept;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        Lease& operator=(Lease&&) = delete;
+        ~Lease();
+
+        httplib::Client* operator->() const { return client.get(); }
+        httplib::Client& operator*() const { return *client; }
+
+        /**
+         * @brief Mark the connection as broken so it is closed instead of reused
+         */
+        void discard() { reusable = false; }
+    };
+
+    /**
+     * @brief Constructor
+     * @param maxConnectionsPerHost Upper bound on open clients (idle + leased) per host
+     * @param idleTimeout Idle clients older than this are closed
+     */
+    HttpClientPool(size_t maxConnectionsPerHost = 8,
+        std::chrono::seconds idleTimeout = std::chrono::seconds(30));
+    ~HttpClientPool() = default;
+
+    /**
+     * @brief Take a client for the host, blocking while the host is at its connection limit
+     * @param host Host name, optionally with scheme and port
+     * @return Lease owning the client until it goes out of scope
+     */
+    Lease acquire(const std::string& host);
+
+    void setMaxConnectionsPerHost(size_t maxConnections);
+    void setIdleTimeout(std::chrono::seconds timeout);
+    void evictIdle();
+    HttpPoolStats getStats() const;
+};
@@ -0,0 +1,259 @@
+/**
+ * @file HttpResponseParser.cpp
+ * @brief Implementation of the HttpResponseParser class
+ */
+#include "HttpResponseParser.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+static bool containsToken(const std::string& value, const char* token) {
+    std::string lower = value;
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return lower.find(token) != std::string::npos;
+}
+
+HttpResponseParser::HttpResponseParser() {
+    reset();
+}
+
+void HttpResponseParser::reset(bool headRequest) {
+    state = State::StatusLine;
+    head = HttpTransport::Response();
+    http10 = false;
+    closeAfter = false;
+    noBody = headRequest;
+    remaining = 0;
+    headerCount = 0;
+    line.clear();
+    error.clear();
+}
+
+HttpResponseParser::Status HttpResponseParser::fail(const std::string& message) {
+    if (error.empty()) {
+        error = message;
+    }
+    return Status::Failed;
+}
+
+// Collects one CRLF (or bare LF) terminated line across chunks
+bool HttpResponseParser::readLine(const char* data, size_t length, size_t& offset, bool& complete) {
+    complete = false;
+    const char* start = data + offset;
+    const char* newline = static_cast<const char*>(std::memchr(start, '\n', length - offset));
+    size_t take = newline ? static_cast<size_t>(newline - start) : length - offset;
+    if (line.size() + take > kMaxLineLength) {
+        return false;
+    }
+
+    line.append(start, take);
+    offset += take;
+    if (newline) {
+        offset++;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        complete = true;
+    }
+    return true;
+}
+
+bool HttpResponseParser::parseStatusLine() {
+    // HTTP/1.1 200 OK
+    if (line.size() < 12 || line.compare(0, 7, "HTTP/1.") != 0 || line[8] != ' ') {
+        return false;
+    }
+    http10 = line[7] == '0';
+    head.status = std::atoi(line.c_str() + 9);
+    return head.status >= 100 && head.status <= 999;
+}
+
+bool HttpResponseParser::parseHeader() {
+    auto colon = line.find(':');
+    if (colon == std::string::npos || colon == 0 || ++headerCount > kMaxHeaders) {
+        return false;
+    }
+
+    std::string name = line.substr(0, colon);
+    size_t valueStart = line.find_first_not_of(" \t", colon + 1);
+    size_t valueEnd = line.find_last_not_of(" \t");
+    std::string value = valueStart == std::string::npos ? "" : line.substr(valueStart, valueEnd - valueStart + 1);
+    head.headers.emplace(std::move(name), std::move(value));
+    return true;
+}
+
+HttpResponseParser::Status HttpResponseParser::beginBody(const HttpTransport::ResponseHandler& onResponse) {
+    // Interim responses (100 Continue) are followed by the real one
+    if (head.status < 200) {
+        bool wasHead = noBody;
+        reset(wasHead);
+        return Status::NeedMore;
+    }
+
+    auto connection = head.headers.find("Connection");
+    if (connection != head.headers.end()) {
+        closeAfter = containsToken(connection->second, "close");
+        if (http10 && containsToken(connection->second, "keep-alive")) {
+            http10 = false;
+        }
+    }
+    closeAfter = closeAfter || http10;
+
+    if (onResponse && !onResponse(head)) {
+        return fail("Canceled");
+    }
+
+    auto transferEncoding = head.headers.find("Transfer-Encoding");
+    auto contentLength = head.headers.find("Content-Length");
+    if (noBody || head.status == 204 || head.status == 304) {
+        state = State::Done;
+    }
+    else if (transferEncoding != head.headers.end() && containsToken(transferEncoding->second, "chunked")) {
+        state = State::ChunkSize;
+    }
+    else if (contentLength != head.headers.end()) {
+        char* end = nullptr;
+        unsigned long long length = std::strtoull(contentLength->second.c_str(), &end, 10);
+        if (end == contentLength->second.c_str() || *end != '\0') {
+            return fail("Invalid Content-Length");
+        }
+        remaining = static_cast<size_t>(length);
+        state = remaining == 0 ? State::Done : State::Body;
+    }
+    else {
+        state = State::UntilClose;
+    }
+    return state == State::Done ? Status::Complete : Status::NeedMore;
+}
+
+HttpResponseParser::Status HttpResponseParser::feed(const char* data, size_t length, size_t& consumed,
+    const HttpTransport::ResponseHandler& onResponse, const HttpTransport::ContentReceiver& onContent) {
+    size_t offset = 0;
+    bool complete = false;
+
+    while (offset < length && state != State::Done) {
+        switch (state) {
+        case State::StatusLine:
+            if (!readLine(data, length, offset, complete)) {
+                return fail("Status line too long");
+            }
+            if (complete) {
+                if (!parseStatusLine()) {
+                    return fail("Malformed status line");
+                }
+                line.clear();
+                state = State::Headers;
+            }
+            break;
+
+        case State::Headers:
+            if (!readLine(data, length, offset, complete)) {
+                return fail("Header line too long");
+            }
+            if (complete) {
+                if (line.empty()) {
+                    Status status = beginBody(onResponse);
+                    if (status == Status::Failed) {
+                        return status;
+                    }
+                }
+                else if (!parseHeader()) {
+                    return fail("Malformed header");
+                }
+                line.clear();
+            }
+            break;
+
+        case State::Body: {
+            size_t take = std::min(remaining, length - offset);
+            if (onContent && !onContent(data + offset, take)) {
+                return fail("Canceled");
+            }
+            offset += take;
+            remaining -= take;
+            if (remaining == 0) {
+                state = State::Done;
+            }
+            break;
+        }
+
+        case State::ChunkSize:
+            if (!readLine(data, length, offset, complete)) {
+                return fail("Chunk size line too long");
+            }
+            if (complete) {
+                // Chunk extensions after ';' are ignored
+                char* end = nullptr;
+                remaining = static_cast<size_t>(std::strtoull(line.c_str(), &end, 16));
+                if (end == line.c_str()) {
+                    return fail("Malformed chunk size");
+                }
+                line.clear();
+                state = remaining == 0 ? State::Trailers : State::ChunkData;
+            }
+            break;
+
+        case State::ChunkData: {
+            size_t take = std::min(remaining, length - offset);
+            if (onContent && !onContent(data + offset, take)) {
+                return fail("Canceled");
+            }
+            offset += take;
+            remaining -= take;
+            if (remaining == 0) {
+                state = State::ChunkEnd;
+            }
+            break;
+        }
+
+        case State::ChunkEnd:
+            if (!readLine(data, length, offset, complete)) {
+                return fail("Malformed chunk");
+            }
+            if (complete) {
+                if (!line.empty()) {
+                    return fail("Malformed chunk");
+                }
+                state = State::ChunkSize;
+            }
+            break;
+
+        case State::Trailers:
+            if (!readLine(data, length, offset, complete)) {
+                return fail("Trailer line too long");
+            }
+            if (complete) {
+                state = line.empty() ? State::Done : State::Trailers;
+                line.clear();
+            }
+            break;
+
+        case State::UntilClose:
+            if (onContent && !onContent(data + offset, length - offset)) {
+                return fail("Canceled");
+            }
+            offset = length;
+            break;
+
+        case State::Done:
+            break;
+        }
+    }
+
+    consumed = offset;
+    return state == State::Done ? Status::Complete : Status::NeedMore;
+}
+
+HttpResponseParser::Status HttpResponseParser::finishOnClose() {
+    if (state == State::UntilClose) {
+        state = State::Done;
+        closeAfter = true;
+        return Status::Complete;
+    }
+    if (state == State::Done) {
+        return Status::Complete;
+    }
+    return fail("Connection closed before the response was complete");
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+/**
+ * @file HttpResponseParser.h
+ * @brief Incremental HTTP/1.1 response parser for the event loop transport
+ */
+#pragma once
+#include <string>
+#include <cstddef>
+#include "HttpTransport.h"
+
+/**
+ * @class HttpResponseParser
+ * @brief Parses one response at a time from bytes fed in arbitrary chunks
+ *
+ * Supports Content-Length, chunked and read-until-close bodies. feed() stops
+ * at the end of a response, so the bytes of the next pipelined response stay
+ * with the caller for the next message.
+ */
+class HttpResponseParser {
+public:
+    enum class Status { NeedMore, Complete, Failed };
+
+private:
+    enum class State { StatusLine, Headers, Body, ChunkSize, ChunkData, ChunkEnd, Trailers, UntilClose, Done };
+
+    static constexpr size_t kMaxLineLength = 16 * 1024;
+    static constexpr size_t kMaxHeaders = 128;
+
+    State state;
+    HttpTransport::Response head;
+    bool http10;
+    bool closeAfter;
+    bool noBody;
+    size_t remaining;
+    size_t headerCount;
+    std::string line;
+    std::string error;
+
+    bool readLine(const char* data, size_t length, size_t& offset, bool& complete);
+    bool parseStatusLine();
+    bool parseHeader();
+    Status beginBody(const HttpTransport::ResponseHandler& onResponse);
+    Status fail(const std::string& message);
+
+public:
+    HttpResponseParser();
+
+    /**
+     * @brief Prepare for the next response
+     * @param headRequest True when the response answers a request without a body
+     */
+    void reset(bool headRequest = false);
+
+    /**
+     * @brief Consume bytes of the current response
+     * @param consumed Set to the number of bytes used; the rest belongs to the next response
+     * @return Complete once the whole response was read
+     */
+    Status feed(const char* data, size_t length, size_t& consumed,
+        const HttpTransport::ResponseHandler& onResponse, const HttpTransport::ContentReceiver& onContent);
+
+    /**
+     * @brief The connection closed; completes a body delimited by the close
+     */
+    Status finishOnClose();
+
+    /**
+     * @brief True once the status line arrived
+     */
+    bool hasStarted() const { return state != State::StatusLine || !line.empty(); }
+
+    /**
+     * @brief True if the connection can carry another response after this one
+     */
+    bool keepAlive() const { return !closeAfter && state != State::UntilClose; }
+
+    const HttpTransport::Response& getHead() const { return head; }
+    const std::string& getError() const { return error; }
+};
\ No newline at end of file
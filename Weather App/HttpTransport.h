@@ -0,0 +1,71 @@
+/**
+ * @file HttpTransport.h
+ * @brief Interface of the engines that send WeatherAPI's HTTP requests
+ */
+#pragma once
+#include <string>
+#include <functional>
+#include <chrono>
+#include "HttpClientPool.h"
+#include "RetryPolicy.h"
+#include "CancellationToken.h"
+#include "httplib.h"
+
+/**
+ * @struct TlsOptions
+ * @brief Certificate checks of https:// requests
+ */
+struct TlsOptions {
+    bool verifyPeer = true;     // Check the certificate chain and the host name
+    std::string caFile;         // PEM bundle of trusted CAs; the system store when empty
+    bool resumeSessions = true; // Offer the last session of a host when connecting to it again
+};
+
+/**
+ * @class HttpTransport
+ * @brief Sends GET requests and reports the response through callbacks
+ *
+ * The callbacks follow httplib's streaming Get(): the response handler sees the
+ * status and headers, the content receiver gets the body as it arrives, and the
+ * completion is called exactly once at the end. Implementations may complete on
+ * the calling thread (blocking engines) or on their own I/O thread.
+ */
+class HttpTransport {
+public:
+    /**
+     * @struct Request
+     * @brief One GET request
+     */
+    struct Request {
+        std::string host;           // Host name, optionally with port
+        std::string path;           // Path and query string
+        httplib::Headers headers;
+        TimeoutPolicy timeouts;     // Connect and read timeouts; the total deadline is the caller's
+        CancellationToken token;    // Aborts the request, even mid-transfer
+    };
+
+    /**
+     * @struct Response
+     * @brief Outcome of a request
+     */
+    struct Response {
+        int status = 0;             // 0 when no complete response was received
+        httplib::Headers headers;
+        std::string error;          // Transport error when status is 0
+    };
+
+    // Return false to abort the transfer
+    using ResponseHandler = std::function<bool(const Response&)>;
+    using ContentReceiver = std::function<bool(const char*, size_t)>;
+    using Completion = std::function<void(Response)>;
+
+    virtual ~HttpTransport() = default;
+
+    virtual void get(Request request, ResponseHandler onResponse, ContentReceiver onContent, Completion done) = 0;
+
+    /**
+     * @brief Configure the keep-alive connections kept per host
+     */
+    virtual void configure(size_t maxConnectionsPerHost, std::chrono::seconds idleTimeout) = 0;
+    virtual HttpPoolStats getStats() const = 0;
+};
\ No newline at end of file
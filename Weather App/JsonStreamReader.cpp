@@ -0,0 +1,341 @@
+/**
+ * @file JsonStreamReader.cpp
+ * @brief Implementation of the JsonStreamReader class
+ */
+#include "JsonStreamReader.h"
+
+static bool isJsonWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool isNumberChar(char c) {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+JsonStreamReader::JsonStreamReader(JsonStreamHandler& handler)
+    : handler(handler), expect(Expect::Value), lexeme(Lexeme::None), stringIsKey(false),
+    escape(false), unicodeDigits(0), unicodeValue(0), highSurrogate(0), offset(0) {
+}
+
+bool JsonStreamReader::feed(const char* data, size_t length) {
+    if (hasFailed()) {
+        return false;
+    }
+    size_t i = 0;
+    while (i < length) {
+        // Copy plain string characters in one run instead of one state step each
+        if (lexeme == Lexeme::String && !escape && highSurrogate == 0) {
+            size_t start = i;
+            while (i < length && data[i] != '"' && data[i] != '\\' && static_cast<unsigned char>(data[i]) >= 0x20) {
+                ++i;
+            }
+            token.append(data + start, i - start);
+            offset += i - start;
+            if (i == length) {
+                break;
+            }
+        }
+
+        if (!consume(data[i])) {
+            return false;
+        }
+        ++i;
+        ++offset;
+    }
+    return true;
+}
+
+bool JsonStreamReader::finish() {
+    if (hasFailed()) {
+        return false;
+    }
+
+    // A top-level number or literal has no terminating character
+    if (lexeme == Lexeme::Number && !finishNumber()) {
+        return false;
+    }
+    if (lexeme == Lexeme::Literal && !finishLiteral()) {
+        return false;
+    }
+    if (lexeme != Lexeme::None || expect != Expect::Done) {
+        return fail("Unexpected end of JSON input");
+    }
+    return true;
+}
+
+bool JsonStreamReader::consume(char c) {
+    switch (lexeme) {
+    case Lexeme::String:
+        if (escape) {
+            return readEscape(c);
+        }
+        if (c == '\\') {
+            escape = true;
+            return true;
+        }
+        if (highSurrogate != 0) {
+            return fail("Unpaired surrogate in string");
+        }
+        if (c == '"') {
+            return finishString();
+        }
+        if (static_cast<unsigned char>(c) < 0x20) {
+            return fail("Control character in string");
+        }
+        token.push_back(c);
+        return true;
+
+    case Lexeme::Number:
+        if (isNumberChar(c)) {
+            token.push_back(c);
+            return true;
+        }
+        if (!finishNumber()) {
+            return false;
+        }
+        break;
+
+    case Lexeme::Literal:
+        if (c >= 'a' && c <= 'z') {
+            token.push_back(c);
+            return true;
+        }
+        if (!finishLiteral()) {
+            return false;
+        }
+        break;
+
+    case Lexeme::None:
+        break;
+    }
+
+    // Between tokens: the character is structural
+    if (isJsonWhitespace(c)) {
+        return true;
+    }
+
+    switch (expect) {
+    case Expect::ValueOrEnd:
+        if (c == ']') {
+            return closeContainer(c);
+        }
+        return beginValue(c);
+
+    case Expect::Value:
+        return beginValue(c);
+
+    case Expect::KeyOrEnd:
+        if (c == '}') {
+            return closeContainer(c);
+        }
+        [[fallthrough]];
+
+    case Expect::Key:
+        if (c != '"') {
+            return fail("Expected object key");
+        }
+        lexeme = Lexeme::String;
+        stringIsKey = true;
+        token.clear();
+        return true;
+
+    case Expect::Colon:
+        if (c != ':') {
+            return fail("Expected ':'");
+        }
+        expect = Expect::Value;
+        return true;
+
+    case Expect::CommaOrEnd:
+        if (c == ',') {
+            expect = containers.back() == '{' ? Expect::Key : Expect::Value;
+            return true;
+        }
+        return closeContainer(c);
+
+    case Expect::Done:
+        return fail("Unexpected data after JSON value");
+    }
+    return fail("Invalid reader state");
+}
+
+bool JsonStreamReader::beginValue(char c) {
+    switch (c) {
+    case '{':
+        containers.push_back('{');
+        expect = Expect::KeyOrEnd;
+        handler.startObject();
+        return true;
+    case '[':
+        containers.push_back('[');
+        expect = Expect::ValueOrEnd;
+        handler.startArray();
+        return true;
+    case '"':
+        lexeme = Lexeme::String;
+        stringIsKey = false;
+        token.clear();
+        return true;
+    case 't':
+    case 'f':
+    case 'n':
+        lexeme = Lexeme::Literal;
+        token.assign(1, c);
+        return true;
+    default:
+        if (c == '-' || (c >= '0' && c <= '9')) {
+            lexeme = Lexeme::Number;
+            token.assign(1, c);
+            return true;
+        }
+        return fail(std::string("Unexpected character '") + c + "'");
+    }
+}
+
+bool JsonStreamReader::closeContainer(char c) {
+    char open = c == '}' ? '{' : '[';
+    if ((c != '}' && c != ']') || containers.empty() || containers.back() != open) {
+        return fail(std::string("Unexpected '") + c + "'");
+    }
+
+    containers.pop_back();
+    if (c == '}') {
+        handler.endObject();
+    }
+    else {
+        handler.endArray();
+    }
+    afterValue();
+    return true;
+}
+
+bool JsonStreamReader::finishString() {
+    lexeme = Lexeme::None;
+    if (highSurrogate != 0) {
+        return fail("Unpaired surrogate in string");
+    }
+
+    if (stringIsKey) {
+        handler.key(token);
+        expect = Expect::Colon;
+    }
+    else {
+        handler.string(token);
+        afterValue();
+    }
+    return true;
+}
+
+bool JsonStreamReader::finishNumber() {
+    lexeme = Lexeme::None;
+    char last = token.back();
+    if (last == '-' || last == '+' || last == '.' || last == 'e' || last == 'E') {
+        return fail("Malformed number '" + token + "'");
+    }
+    handler.number(token);
+    afterValue();
+    return true;
+}
+
+bool JsonStreamReader::finishLiteral() {
+    lexeme = Lexeme::None;
+    if (token == "true") {
+        handler.boolean(true);
+    }
+    else if (token == "false") {
+        handler.boolean(false);
+    }
+    else if (token == "null") {
+        handler.null();
+    }
+    else {
+        return fail("Invalid literal '" + token + "'");
+    }
+    afterValue();
+    return true;
+}
+
+bool JsonStreamReader::readEscape(char c) {
+    if (unicodeDigits > 0) {
+        uint32_t digit;
+        if (c >= '0' && c <= '9') digit = c - '0';
+        else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+        else return fail("Invalid \\u escape");
+
+        unicodeValue = (unicodeValue << 4) | digit;
+        if (--unicodeDigits == 0) {
+            escape = false;
+            if (unicodeValue >= 0xD800 && unicodeValue <= 0xDBFF) {
+                highSurrogate = unicodeValue;
+            }
+            else if (unicodeValue >= 0xDC00 && unicodeValue <= 0xDFFF) {
+                if (highSurrogate == 0) {
+                    return fail("Unpaired surrogate in string");
+                }
+                appendCodePoint(0x10000 + ((highSurrogate - 0xD800) << 10) + (unicodeValue - 0xDC00));
+                highSurrogate = 0;
+            }
+            else {
+                appendCodePoint(unicodeValue);
+            }
+        }
+        return true;
+    }
+
+    if (highSurrogate != 0 && c != 'u') {
+        return fail("Unpaired surrogate in string");
+    }
+
+    escape = false;
+    switch (c) {
+    case '"': token.push_back('"'); break;
+    case '\\': token.push_back('\\'); break;
+    case '/': token.push_back('/'); break;
+    case 'b': token.push_back('\b'); break;
+    case 'f': token.push_back('\f'); break;
+    case 'n': token.push_back('\n'); break;
+    case 'r': token.push_back('\r'); break;
+    case 't': token.push_back('\t'); break;
+    case 'u':
+        escape = true;
+        unicodeDigits = 4;
+        unicodeValue = 0;
+        break;
+    default:
+        return fail(std::string("Invalid escape '\\") + c + "'");
+    }
+    return true;
+}
+
+void JsonStreamReader::appendCodePoint(uint32_t codePoint) {
+    if (codePoint < 0x80) {
+        token.push_back(static_cast<char>(codePoint));
+    }
+    else if (codePoint < 0x800) {
+        token.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+        token.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    }
+    else if (codePoint < 0x10000) {
+        token.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+        token.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+        token.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    }
+    else {
+        token.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+        token.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+        token.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+        token.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    }
+}
+
+void JsonStreamReader::afterValue() {
+    expect = containers.empty() ? Expect::Done : Expect::CommaOrEnd;
+}
+
+bool JsonStreamReader::fail(const std::string& message) {
+    if (error.empty()) {
+        error = message + " at offset " + std::to_string(offset);
+    }
+    return false;
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+/**
+ * @file JsonStreamReader.h
+ * @brief Incremental, push-based JSON reader for parsing responses while they download
+ */
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class JsonStreamHandler
+ * @brief SAX-style receiver of the events produced by JsonStreamReader
+ *
+ * String views passed to the callbacks are only valid for the duration of the call.
+ * Numbers are passed as their source text so the handler decides how to convert them.
+ */
+class JsonStreamHandler {
+public:
+    virtual ~JsonStreamHandler() = default;
+
+    virtual void startObject() = 0;
+    virtual void endObject() = 0;
+    virtual void startArray() = 0;
+    virtual void endArray() = 0;
+    virtual void key(std::string_view name) = 0;
+    virtual void string(std::string_view value) = 0;
+    virtual void number(std::string_view text) = 0;
+    virtual void boolean(bool value) = 0;
+    virtual void null() = 0;
+};
+
+/**
+ * @class JsonStreamReader
+ * @brief Tokenizes a JSON document fed in arbitrary chunks
+ *
+ * Only the token currently being read is buffered, so memory use is bounded by
+ * the longest string or number in the document rather than by its total size.
+ */
+class JsonStreamReader {
+private:
+    enum class Expect { Value, ValueOrEnd, Key, KeyOrEnd, Colon, CommaOrEnd, Done };
+    enum class Lexeme { None, String, Number, Literal };
+
+    JsonStreamHandler& handler;
+    std::vector<char> containers;
+    Expect expect;
+    Lexeme lexeme;
+    std::string token;
+    bool stringIsKey;
+    bool escape;
+    int unicodeDigits;
+    uint32_t unicodeValue;
+    uint32_t highSurrogate;
+    size_t offset;
+    std::string error;
+
+    bool consume(char c);
+    bool beginValue(char c);
+    bool closeContainer(char c);
+    bool finishString();
+    bool finishNumber();
+    bool finishLiteral();
+    bool readEscape(char c);
+    void appendCodePoint(uint32_t codePoint);
+    void afterValue();
+    bool fail(const std::string& message);
+
+public:
+    explicit JsonStreamReader(JsonStreamHandler& handler);
+
+    /**
+     * @brief Feed the next chunk of the document
+     * @return False once the input is not valid JSON
+     */
+    bool feed(const char* data, size_t length);
+
+    /**
+     * @brief Signal the end of input
+     * @return True if exactly one complete JSON value was read
+     */
+    bool finish();
+
+    bool hasFailed() const { return !error.empty(); }
+    const std::string& getError() const { return error; }
+};
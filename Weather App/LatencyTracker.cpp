@@ -0,0 +1,39 @@
+/**
+ * @file LatencyTracker.cpp
+ * @brief Implementation of the LatencyTracker class
+ */
+#include "LatencyTracker.h"
+#include <algorithm>
+
+LatencyTracker::LatencyTracker(size_t windowSize, size_t minSamples)
+    : windowSize(std::max<size_t>(1, windowSize)), minSamples(std::max<size_t>(1, minSamples)) {
+}
+
+void LatencyTracker::record(const std::string& endpoint, std::chrono::microseconds latency) {
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    Window& window = windows[endpoint];
+    if (window.samples.size() < windowSize) {
+        window.samples.push_back(latency);
+    }
+    else {
+        // Overwrite the oldest sample
+        window.samples[window.next] = latency;
+        window.next = (window.next + 1) % windowSize;
+    }
+}
+
+std::chrono::microseconds LatencyTracker::percentile(const std::string& endpoint, double fraction) const {
+    std::vector<std::chrono::microseconds> sorted;
+    {
+        std::lock_guard<std::mutex> lock(trackerMutex);
+        auto it = windows.find(endpoint);
+        if (it == windows.end() || it->second.samples.size() < minSamples) {
+            return std::chrono::microseconds(0);
+        }
+        sorted = it->second.samples;
+    }
+
+    size_t rank = static_cast<size_t>(std::clamp(fraction, 0.0, 1.0) * (sorted.size() - 1));
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    return sorted[rank];
+}
\ No newline at end of file
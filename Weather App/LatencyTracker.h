@@ -0,0 +1,43 @@
+/**
+ * @file LatencyTracker.h
+ * @brief Rolling latency percentiles per API endpoint
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+
+/**
+ * @class LatencyTracker
+ * @brief Keeps the most recent successful request latencies of every endpoint
+ */
+class LatencyTracker {
+private:
+    struct Window {
+        std::vector<std::chrono::microseconds> samples;
+        size_t next = 0;
+    };
+
+    std::unordered_map<std::string, Window> windows;
+    mutable std::mutex trackerMutex;
+    size_t windowSize;
+    size_t minSamples;
+
+public:
+    /**
+     * @param windowSize Latencies remembered per endpoint
+     * @param minSamples Samples needed before a percentile is reported
+     */
+    LatencyTracker(size_t windowSize = 128, size_t minSamples = 20);
+
+    void record(const std::string& endpoint, std::chrono::microseconds latency);
+
+    /**
+     * @brief Latency percentile of an endpoint
+     * @param fraction Percentile as a fraction, e.g. 0.95
+     * @return The percentile, or zero while there are fewer than minSamples samples
+     */
+    std::chrono::microseconds percentile(const std::string& endpoint, double fraction) const;
+};
\ No newline at end of file
@@ -0,0 +1,208 @@
+/**
+ * @file RateLimiter.cpp
+ * @brief Implementation of the RateLimiter class
+ */
+#include "RateLimiter.h"
+#include <algorithm>
+
+RateLimiter::RateLimiter(TimerQueue& timers, double requestsPerMinute, double burst)
+    : timers(timers), tokensPerSecond(0.0), capacity(0.0), interactiveReserve(0.0), closed(false), nextTicket(1) {
+    configure(requestsPerMinute, burst);
+}
+
+void RateLimiter::configure(double requestsPerMinute, double burst) {
+    std::lock_guard<std::mutex> lock(limiterMutex);
+    tokensPerSecond = std::max(requestsPerMinute, 1.0) / 60.0;
+    capacity = std::max(burst, 1.0);
+
+    // Background requests leave up to two tokens for interactive ones
+    interactiveReserve = std::min(2.0, capacity - 1.0);
+    for (auto& entry : buckets) {
+        entry.second.tokens = std::min(entry.second.tokens, capacity);
+    }
+}
+
+RateLimiter::Bucket& RateLimiter::bucketFor(const std::string& key, Clock::time_point now) {
+    auto it = buckets.find(key);
+    if (it == buckets.end()) {
+        Bucket bucket;
+        bucket.tokens = capacity;
+        bucket.refilledAt = now;
+        it = buckets.emplace(key, std::move(bucket)).first;
+    }
+    return it->second;
+}
+
+void RateLimiter::refill(Bucket& bucket, Clock::time_point now) {
+    double elapsed = std::chrono::duration<double>(now - bucket.refilledAt).count();
+    bucket.tokens = std::min(capacity, bucket.tokens + elapsed * tokensPerSecond);
+    bucket.refilledAt = now;
+}
+
+double RateLimiter::threshold(RequestPriority priority) const {
+    return priority == RequestPriority::Interactive ? 1.0 : 1.0 + interactiveReserve;
+}
+
+bool RateLimiter::hasWaitersAtOrAbove(const Bucket& bucket, RequestPriority priority) const {
+    for (size_t lane = 0; lane <= static_cast<size_t>(priority); ++lane) {
+        if (!bucket.lanes[lane].empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RateLimiter::scheduleWake(const std::string& key, Bucket& bucket, Clock::time_point now) {
+    // Wake when the most urgent waiting lane can be served
+    double needed = threshold(RequestPriority::Background);
+    for (size_t lane = 0; lane < kRequestPriorityCount; ++lane) {
+        if (!bucket.lanes[lane].empty()) {
+            needed = threshold(static_cast<RequestPriority>(lane));
+            break;
+        }
+    }
+
+    auto delay = std::chrono::duration<double>(std::max(0.0, needed - bucket.tokens) / tokensPerSecond);
+    auto due = now + std::chrono::duration_cast<Clock::duration>(delay);
+
+    // A pending wake-up that comes sooner already covers this one
+    if (due >= bucket.wakeAt) {
+        return;
+    }
+    bucket.wakeAt = due;
+    timers.schedule(due, [this, key] { drain(key); });
+}
+
+RateLimiter::Ticket RateLimiter::acquire(const std::string& bucketKey, RequestPriority priority, GrantCallback onGrant) {
+    bool granted = false;
+    {
+        std::lock_guard<std::mutex> lock(limiterMutex);
+        if (!closed) {
+            auto now = Clock::now();
+            Bucket& bucket = bucketFor(bucketKey, now);
+            refill(bucket, now);
+
+            // Only take a token directly when nobody of the same or higher priority is queued
+            if (hasWaitersAtOrAbove(bucket, priority) || bucket.tokens < threshold(priority)) {
+                Ticket ticket{ bucketKey, nextTicket++ };
+                bucket.lanes[static_cast<size_t>(priority)].push_back({ std::move(onGrant), now, ticket.id });
+                stats.queueDepth[static_cast<size_t>(priority)]++;
+                scheduleWake(bucketKey, bucket, now);
+                return ticket;
+            }
+
+            bucket.tokens -= 1.0;
+            stats.granted++;
+            granted = true;
+        }
+    }
+    onGrant(granted);
+    return Ticket();
+}
+
+bool RateLimiter::promote(const Ticket& ticket, RequestPriority priority) {
+    std::lock_guard<std::mutex> lock(limiterMutex);
+    auto it = buckets.find(ticket.bucketKey);
+    if (closed || !ticket || it == buckets.end()) {
+        return false;
+    }
+
+    Bucket& bucket = it->second;
+    for (size_t lane = 0; lane < kRequestPriorityCount; ++lane) {
+        auto& waiters = bucket.lanes[lane];
+        auto waiter = std::find_if(waiters.begin(), waiters.end(),
+            [&ticket](const Waiter& queued) { return queued.id == ticket.id; });
+        if (waiter == waiters.end()) {
+            continue;
+        }
+        if (lane <= static_cast<size_t>(priority)) {
+            return true;
+        }
+
+        // Keeps its queue time, so the throttle wait still counts from the first acquire
+        bucket.lanes[static_cast<size_t>(priority)].push_back(std::move(*waiter));
+        waiters.erase(waiter);
+        stats.queueDepth[lane]--;
+        stats.queueDepth[static_cast<size_t>(priority)]++;
+
+        // The higher lane may be served sooner, with fewer tokens
+        auto now = Clock::now();
+        refill(bucket, now);
+        scheduleWake(ticket.bucketKey, bucket, now);
+        return true;
+    }
+    return false;
+}
+
+void RateLimiter::drain(const std::string& key) {
+    std::vector<GrantCallback> grants;
+    {
+        std::lock_guard<std::mutex> lock(limiterMutex);
+        auto it = buckets.find(key);
+        if (closed || it == buckets.end()) {
+            return;
+        }
+
+        Bucket& bucket = it->second;
+        auto now = Clock::now();
+        if (now >= bucket.wakeAt) {
+            bucket.wakeAt = Clock::time_point::max();
+        }
+        refill(bucket, now);
+
+        for (size_t lane = 0; lane < kRequestPriorityCount; ++lane) {
+            auto& waiters = bucket.lanes[lane];
+            while (!waiters.empty() && bucket.tokens >= threshold(static_cast<RequestPriority>(lane))) {
+                double waitMs = std::chrono::duration<double, std::milli>(now - waiters.front().queuedAt).count();
+                stats.throttled++;
+                stats.granted++;
+                stats.totalThrottleWaitMs += waitMs;
+                stats.maxThrottleWaitMs = std::max(stats.maxThrottleWaitMs, waitMs);
+                stats.queueDepth[lane]--;
+
+                bucket.tokens -= 1.0;
+                grants.push_back(std::move(waiters.front().onGrant));
+                waiters.pop_front();
+            }
+
+            // Lower lanes wait until this one is empty
+            if (!waiters.empty()) {
+                break;
+            }
+        }
+
+        if (hasWaitersAtOrAbove(bucket, static_cast<RequestPriority>(kRequestPriorityCount - 1))) {
+            scheduleWake(key, bucket, now);
+        }
+    }
+
+    for (auto& grant : grants) {
+        grant(true);
+    }
+}
+
+void RateLimiter::shutdown() {
+    std::vector<GrantCallback> refused;
+    {
+        std::lock_guard<std::mutex> lock(limiterMutex);
+        closed = true;
+        for (auto& entry : buckets) {
+            for (auto& waiters : entry.second.lanes) {
+                for (auto& waiter : waiters) {
+                    refused.push_back(std::move(waiter.onGrant));
+                }
+                waiters.clear();
+            }
+        }
+        stats.queueDepth.fill(0);
+    }
+
+    for (auto& refuse : refused) {
+        refuse(false);
+    }
+}
+
+RateLimiterStats RateLimiter::getStats() const {
+    std::lock_guard<std::mutex> lock(limiterMutex);
+    return stats;
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+/**
+ * @file RateLimiter.h
+ * @brief Token bucket rate limiter with priority lanes for API requests
+ */
+#pragma once
+#include <string>
+#include <deque>
+#include <array>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include "RequestPriority.h"
+#include "TimerQueue.h"
+
+/**
+ * @struct RateLimiterStats
+ * @brief Snapshot of the rate limiter counters
+ */
+struct RateLimiterStats {
+    unsigned long long granted = 0;         // Requests let through
+    unsigned long long throttled = 0;       // Requests that had to wait for a token
+    std::array<size_t, kRequestPriorityCount> queueDepth{};    // Waiting requests per priority
+    double totalThrottleWaitMs = 0.0;
+    double maxThrottleWaitMs = 0.0;
+
+    double averageThrottleWaitMs() const {
+        return throttled == 0 ? 0.0 : totalThrottleWaitMs / throttled;
+    }
+};
+
+/**
+ * @class RateLimiter
+ * @brief Keeps API calls under the provider quota without blocking threads
+ *
+ * Every bucket key (API key and endpoint) has its own token bucket. A request
+ * that finds no token is queued in its priority lane and granted from the timer
+ * thread once the bucket refills; higher lanes are always granted before lower
+ * ones. Prefetch and background requests also leave a small reserve of tokens
+ * untouched, so a refresh of every city cannot starve the city on screen.
+ * A queued request can be moved to a higher lane with promote().
+ */
+class RateLimiter {
+public:
+    /**
+     * @brief Called once per request: true when granted, false when the limiter shut down
+     */
+    using GrantCallback = std::function<void(bool)>;
+
+    /**
+     * @struct Ticket
+     * @brief Handle to a queued request, for promote()
+     */
+    struct Ticket {
+        std::string bucketKey;
+        unsigned long long id = 0;      // 0 when the request was not queued
+
+        explicit operator bool() const { return id != 0; }
+    };
+
+private:
+    using Clock = TimerQueue::Clock;
+
+    struct Waiter {
+        GrantCallback onGrant;
+        Clock::time_point queuedAt;
+        unsigned long long id;
+    };
+
+    struct Bucket {
+        double tokens;
+        Clock::time_point refilledAt;
+        std::array<std::deque<Waiter>, kRequestPriorityCount> lanes;
+        Clock::time_point wakeAt = Clock::time_point::max();   // Next drain already scheduled
+    };
+
+    std::unordered_map<std::string, Bucket> buckets;
+    mutable std::mutex limiterMutex;
+    TimerQueue& timers;
+    double tokensPerSecond;
+    double capacity;
+    double interactiveReserve;
+    bool closed;
+    unsigned long long nextTicket;
+    RateLimiterStats stats;
+
+    Bucket& bucketFor(const std::string& key, Clock::time_point now);
+    void refill(Bucket& bucket, Clock::time_point now);
+    double threshold(RequestPriority priority) const;
+    bool hasWaitersAtOrAbove(const Bucket& bucket, RequestPriority priority) const;
+    void scheduleWake(const std::string& key, Bucket& bucket, Clock::time_point now);
+    void drain(const std::string& key);
+
+public:
+    /**
+     * @brief Constructor
+     * @param timers Timer thread that grants queued requests
+     * @param requestsPerMinute Sustained rate of every bucket
+     * @param burst Tokens a bucket holds when idle
+     */
+    RateLimiter(TimerQueue& timers, double requestsPerMinute = 60.0, double burst = 10.0);
+
+    void configure(double requestsPerMinute, double burst);
+
+    /**
+     * @brief Ask for a token; onGrant runs inline when one is available, later otherwise
+     * @param bucketKey Bucket to draw from
+     * @param priority Lane the request waits in
+     * @param onGrant Receives true when granted, false if the limiter shuts down first
+     * @return Ticket of the queued request, empty if onGrant already ran
+     */
+    Ticket acquire(const std::string& bucketKey, RequestPriority priority, GrantCallback onGrant);
+
+    /**
+     * @brief Move a queued request up to the given priority, behind the requests already in that lane
+     * @return false if the request is no longer queued
+     */
+    bool promote(const Ticket& ticket, RequestPriority priority);
+
+    /**
+     * @brief Refuse new requests and fail every queued one
+     */
+    void shutdown();
+
+    RateLimiterStats getStats() const;
+};
\ No newline at end of file
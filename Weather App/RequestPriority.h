@@ -0,0 +1,17 @@
+/**
+ * @file RequestPriority.h
+ * @brief Priority classes of API requests
+ */
+#pragma once
+#include <cstddef>
+
+/**
+ * @brief How urgently the user is waiting for a request
+ */
+enum class RequestPriority {
+    Interactive,    // The user is looking at the result (selected city, search)
+    Prefetch,       // Likely to be looked at soon (cities next to the selection)
+    Background      // Periodic refresh of every saved city
+};
+
+constexpr size_t kRequestPriorityCount = 3;
\ No newline at end of file
@@ -0,0 +1,71 @@
+/**
+ * @file RetryPolicy.h
+ * @brief Retry, hedging and timeout settings for API requests and the error type they act on
+ */
+#pragma once
+#include <string>
+#include <chrono>
+#include <stdexcept>
+
+/**
+ * @class ApiError
+ * @brief Failed API request with the HTTP status that caused it
+ */
+class ApiError : public std::runtime_error {
+private:
+    int status;
+    std::chrono::seconds retryAfter;
+
+public:
+    /**
+     * @param message Error description
+     * @param status HTTP status, 0 when no response arrived
+     * @param retryAfter Delay requested by the server's Retry-After header
+     */
+    ApiError(const std::string& message, int status, std::chrono::seconds retryAfter = std::chrono::seconds(0))
+        : std::runtime_error(message), status(status), retryAfter(retryAfter) {
+    }
+
+    int getStatus() const { return status; }
+    std::chrono::seconds getRetryAfter() const { return retryAfter; }
+
+    /**
+     * @brief True for failures a later attempt may not hit: connect errors, 429 and 5xx
+     */
+    bool isTransient() const { return status == 0 || status == 429 || status >= 500; }
+};
+
+/**
+ * @struct RetryPolicy
+ * @brief How WeatherAPI repeats and hedges requests
+ */
+struct RetryPolicy {
+    int maxAttempts = 3;                                // Attempts per request, hedges included
+    std::chrono::milliseconds baseDelay{ 250 };         // Backoff ceiling before the second attempt
+    std::chrono::milliseconds maxDelay{ 8000 };         // Backoff ceiling, also caps Retry-After
+    bool hedgeRequests = false;                         // Send a second request once the first passes p95
+    std::chrono::milliseconds minHedgeDelay{ 100 };     // Never hedge sooner than this
+};
+
+/**
+ * @struct TimeoutPolicy
+ * @brief Deadline budget of every API request
+ */
+struct TimeoutPolicy {
+    std::chrono::milliseconds connectTimeout{ 5000 };   // Per attempt, TCP connect
+    std::chrono::milliseconds readTimeout{ 10000 };     // Per attempt, longest wait for the next bytes
+    std::chrono::milliseconds totalTimeout{ 30000 };    // Whole request with its retries, counted from its first attempt
+};
+
+/**
+ * @struct RequestStats
+ * @brief Snapshot of the retry, hedging, timeout and cancellation counters
+ */
+struct RequestStats {
+    unsigned long long retries = 0;     // Attempts repeated after a transient failure
+    unsigned long long hedges = 0;      // Second requests sent because the first passed p95
+    unsigned long long hedgeWins = 0;   // Hedged requests that answered first
+    unsigned long long exhausted = 0;   // Requests that still failed after their last attempt
+    unsigned long long timedOut = 0;    // Requests that ran past their total timeout
+    unsigned long long cancelled = 0;   // Requests cancelled by the caller or by shutdown
+};
\ No newline at end of file
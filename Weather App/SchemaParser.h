@@ -0,0 +1,248 @@
+/**
+ * @file SchemaParser.h
+ * @brief JSON stream handler specialized at compile time to a fixed record layout
+ */
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <iterator>
+#include <charconv>
+#include <cstddef>
+#include "JsonStreamReader.h"
+
+/**
+ * @struct FieldDescriptor
+ * @brief Maps one JSON member of a record onto a struct member
+ *
+ * The section is the key of the nested object holding the value ("main", "wind"),
+ * or empty for members of the record object itself. A section that is an array of
+ * objects ("weather") reads its first element. Exactly one target member is set.
+ */
+template<class Record>
+struct FieldDescriptor {
+    std::string_view section;
+    std::string_view key;
+    double Record::* asDouble = nullptr;
+    long long Record::* asInteger = nullptr;
+    std::string Record::* asString = nullptr;
+};
+
+/**
+ * @brief Where the records sit inside the parsed document
+ */
+enum class RecordLayout {
+    Document,   // The whole document is one record
+    ListItems   // Records are the elements of the top-level "list" array
+};
+
+/**
+ * @class SchemaHandler
+ * @brief Decodes records described by Schema::fields straight from reader events
+ *
+ * Every key is resolved once, against a table built at compile time, into either a
+ * target member or a section; values outside the schema are skipped without being
+ * stored. Numbers are converted with std::from_chars.
+ */
+template<class Record, class Schema>
+class SchemaHandler : public JsonStreamHandler {
+private:
+    static constexpr auto& fields = Schema::fields;
+    static constexpr size_t kFieldCount = std::size(Schema::fields);
+    static constexpr int kNone = -1;
+
+    // For every field, the index of the first field of the same section
+    static constexpr std::array<int, kFieldCount> computeSectionIds() {
+        std::array<int, kFieldCount> ids{};
+        for (size_t i = 0; i < kFieldCount; ++i) {
+            ids[i] = static_cast<int>(i);
+            for (size_t j = 0; j < i; ++j) {
+                if (fields[j].section == fields[i].section) {
+                    ids[i] = ids[j];
+                    break;
+                }
+            }
+        }
+        return ids;
+    }
+
+    static constexpr std::array<int, kFieldCount> sectionIds = computeSectionIds();
+
+    // Section id of the record's own members
+    static constexpr int findRootSection() {
+        for (size_t i = 0; i < kFieldCount; ++i) {
+            if (fields[i].section.empty()) {
+                return sectionIds[i];
+            }
+        }
+        return kNone;
+    }
+
+    static constexpr int kRootSection = findRootSection();
+
+    enum class Kind { Document, List, Item, Section, SectionArray, Skipped };
+
+    struct Scope {
+        Kind kind;
+        int section;
+        int elementCount;
+    };
+
+    std::vector<Record>& records;
+    RecordLayout layout;
+    std::vector<Scope> scopes;
+    Record current;
+    int pendingField;
+    int pendingSection;
+    bool pendingList;
+
+    static int findSection(std::string_view name) {
+        for (size_t i = 0; i < kFieldCount; ++i) {
+            if (!fields[i].section.empty() && fields[i].section == name) {
+                return sectionIds[i];
+            }
+        }
+        return kNone;
+    }
+
+    static int findField(int section, std::string_view name) {
+        for (size_t i = 0; i < kFieldCount; ++i) {
+            if (sectionIds[i] == section && fields[i].key == name) {
+                return static_cast<int>(i);
+            }
+        }
+        return kNone;
+    }
+
+    void beginRecord() {
+        current = Record{};
+        scopes.push_back({ Kind::Item, kRootSection, 0 });
+    }
+
+    void clearPending() {
+        pendingField = kNone;
+        pendingSection = kNone;
+        pendingList = false;
+    }
+
+    void afterValue() {
+        clearPending();
+        if (!scopes.empty() && scopes.back().kind == Kind::SectionArray) {
+            scopes.back().elementCount++;
+        }
+    }
+
+    static bool toDouble(std::string_view text, double& value) {
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        return result.ec == std::errc() && result.ptr == text.data() + text.size();
+    }
+
+public:
+    SchemaHandler(std::vector<Record>& records, RecordLayout layout)
+        : records(records), layout(layout), current{}, pendingField(kNone), pendingSection(kNone), pendingList(false) {
+    }
+
+    void startObject() override {
+        Kind parent = scopes.empty() ? Kind::Document : scopes.back().kind;
+        if (scopes.empty()) {
+            if (layout == RecordLayout::Document) {
+                beginRecord();
+            }
+            else {
+                scopes.push_back({ Kind::Document, kNone, 0 });
+            }
+        }
+        else if (parent == Kind::List) {
+            beginRecord();
+        }
+        else if (parent == Kind::Item && pendingSection != kNone) {
+            scopes.push_back({ Kind::Section, pendingSection, 0 });
+        }
+        else if (parent == Kind::SectionArray && scopes.back().elementCount == 0) {
+            scopes.push_back({ Kind::Section, scopes.back().section, 0 });
+        }
+        else {
+            scopes.push_back({ Kind::Skipped, kNone, 0 });
+        }
+        clearPending();
+    }
+
+    void endObject() override {
+        Kind kind = scopes.back().kind;
+        scopes.pop_back();
+        if (kind == Kind::Item) {
+            records.push_back(std::move(current));
+        }
+        afterValue();
+    }
+
+    void startArray() override {
+        Kind parent = scopes.empty() ? Kind::Document : scopes.back().kind;
+        if (parent == Kind::Document && pendingList) {
+            scopes.push_back({ Kind::List, kNone, 0 });
+        }
+        else if (parent == Kind::Item && pendingSection != kNone) {
+            scopes.push_back({ Kind::SectionArray, pendingSection, 0 });
+        }
+        else {
+            scopes.push_back({ Kind::Skipped, kNone, 0 });
+        }
+        clearPending();
+    }
+
+    void endArray() override {
+        scopes.pop_back();
+        afterValue();
+    }
+
+    void key(std::string_view name) override {
+        clearPending();
+        if (scopes.empty()) {
+            return;
+        }
+
+        const Scope& scope = scopes.back();
+        if (scope.kind == Kind::Item) {
+            pendingField = findField(scope.section, name);
+            if (pendingField == kNone) {
+                pendingSection = findSection(name);
+            }
+        }
+        else if (scope.kind == Kind::Section) {
+            pendingField = findField(scope.section, name);
+        }
+        else if (scope.kind == Kind::Document) {
+            pendingList = name == "list";
+        }
+    }
+
+    void string(std::string_view value) override {
+        if (pendingField != kNone && fields[pendingField].asString) {
+            (current.*fields[pendingField].asString).assign(value.data(), value.size());
+        }
+        afterValue();
+    }
+
+    void number(std::string_view text) override {
+        if (pendingField != kNone) {
+            const auto& field = fields[pendingField];
+            if (field.asDouble) {
+                toDouble(text, current.*field.asDouble);
+            }
+            else if (field.asInteger) {
+                long long& target = current.*field.asInteger;
+                auto result = std::from_chars(text.data(), text.data() + text.size(), target);
+                double value;
+                if (result.ptr != text.data() + text.size() && toDouble(text, value)) {
+                    // Integer member sent in floating point notation
+                    target = static_cast<long long>(value);
+                }
+            }
+        }
+        afterValue();
+    }
+
+    void boolean(bool) override { afterValue(); }
+    void null() override { afterValue(); }
+};
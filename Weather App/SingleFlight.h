@@ -0,0 +1,251 @@
+/**
+ * @file SingleFlight.h
+ * @brief Coalescing of identical concurrent requests into one execution
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include "CancellationToken.h"
+#include "RequestPriority.h"
+
+/**
+ * @class SingleFlight
+ * @brief Lets concurrent callers asking for the same key share one result
+ *
+ * The first caller for a key becomes the leader and launches the work; callers
+ * that arrive while it is still running only register a callback and are completed
+ * together with the leader when it calls resolve() or reject().
+ *
+ * A flight runs at the most urgent priority of its callers: when a caller
+ * joins with a higher priority than the flight has, the leader's promoter is
+ * called to move the running request up.
+ *
+ * Every caller brings its own token. A caller whose token is cancelled is failed
+ * with RequestCancelled and leaves the flight; the shared request runs on a token
+ * of the flight, which is cancelled only when the last caller leaves. A new caller
+ * for the key then starts a new flight.
+ */
+template<class T>
+class SingleFlight {
+public:
+    /**
+     * @brief Receives the shared result: the value, or null and the error
+     */
+    using Callback = std::function<void(const T*, std::exception_ptr)>;
+
+    /**
+     * @brief Raises the priority of the leader's request
+     */
+    using Promoter = std::function<void(RequestPriority)>;
+
+    /**
+     * @struct Launch
+     * @brief What the leader starts the shared request with
+     */
+    struct Launch {
+        bool live = false;      // False if every caller left before the leader launched
+        RequestPriority priority = RequestPriority::Background;    // Most urgent of the callers so far
+        CancellationToken token;    // Cancelled when the last caller leaves
+    };
+
+private:
+    struct Caller {
+        Callback callback;
+        CancellationToken token;
+        size_t id;
+        size_t registration;
+    };
+
+    struct Flight {
+        unsigned long long id;
+        std::vector<Caller> callers;
+        size_t nextCaller;
+        RequestPriority priority;
+        Promoter promote;       // Empty until the leader launches
+        CancellationToken token;
+    };
+
+    std::unordered_map<std::string, Flight> inFlight;
+    mutable std::mutex flightMutex;
+    unsigned long long nextFlight;
+    std::atomic<unsigned long long> coalesced;
+
+    Flight* find(const std::string& key, unsigned long long flight);
+    static Caller* findCaller(Flight* flight, size_t caller);
+    std::vector<Caller> take(const std::string& key, unsigned long long flight);
+    void leave(const std::string& key, unsigned long long flight, size_t caller, CancelReason reason);
+
+public:
+    SingleFlight() : nextFlight(1), coalesced(0) {}
+
+    SingleFlight(const SingleFlight&) = delete;
+    SingleFlight& operator=(const SingleFlight&) = delete;
+
+    /**
+     * @brief Register interest in a key
+     * @param key Normalized request key
+     * @param priority How urgently this caller waits; a more urgent one promotes the flight
+     * @param token Fails this caller alone when cancelled
+     * @param callback Called once with the shared result, or with RequestCancelled
+     * @return Id of the new flight if the caller is the leader and must launch it, 0 otherwise
+     */
+    unsigned long long join(const std::string& key, RequestPriority priority, const CancellationToken& token,
+        Callback callback);
+
+    /**
+     * @brief Let later callers promote the leader's request; the leader calls it before starting
+     * @return How to start the request, or nothing to start if every caller already left
+     */
+    Launch launch(const std::string& key, unsigned long long flight, Promoter promote);
+
+    void resolve(const std::string& key, unsigned long long flight, const T& value);
+    void reject(const std::string& key, unsigned long long flight, std::exception_ptr error);
+
+    /**
+     * @brief Number of calls that were attached to an already running request
+     */
+    unsigned long long getCoalescedCount() const { return coalesced.load(); }
+};
+
+template<class T>
+typename SingleFlight<T>::Flight* SingleFlight<T>::find(const std::string& key, unsigned long long flight) {
+    // A flight everyone left is replaced under the same key, so the id must match too
+    auto it = inFlight.find(key);
+    return it != inFlight.end() && it->second.id == flight ? &it->second : nullptr;
+}
+
+template<class T>
+typename SingleFlight<T>::Caller* SingleFlight<T>::findCaller(Flight* flight, size_t caller) {
+    if (!flight) {
+        return nullptr;
+    }
+    auto it = std::find_if(flight->callers.begin(), flight->callers.end(),
+        [caller](const Caller& other) { return other.id == caller; });
+    return it != flight->callers.end() ? &*it : nullptr;
+}
+
+template<class T>
+unsigned long long SingleFlight<T>::join(const std::string& key, RequestPriority priority, const CancellationToken& token,
+    Callback callback) {
+    Promoter promote;
+    bool leader;
+    unsigned long long flight;
+    size_t caller;
+    {
+        std::lock_guard<std::mutex> lock(flightMutex);
+        auto it = inFlight.find(key);
+        leader = it == inFlight.end();
+        if (leader) {
+            it = inFlight.emplace(key, Flight{ nextFlight++, {}, 0, priority, nullptr, CancellationToken::create() }).first;
+        }
+        else {
+            coalesced++;
+            if (priority < it->second.priority) {
+                it->second.priority = priority;
+                promote = it->second.promote;
+            }
+        }
+        flight = it->second.id;
+        caller = it->second.nextCaller++;
+        it->second.callers.push_back({ std::move(callback), token, caller, 0 });
+    }
+
+    // Outside the lock, since promoting takes the request's own locks
+    if (promote) {
+        promote(priority);
+    }
+
+    // Also outside, since a token that is already cancelled runs the callback right here
+    size_t registration = token.onCancel([this, key, flight, caller](CancelReason reason) {
+        leave(key, flight, caller, reason);
+        });
+    if (registration != 0) {
+        std::unique_lock<std::mutex> lock(flightMutex);
+        Caller* entry = findCaller(find(key, flight), caller);
+        if (entry) {
+            entry->registration = registration;
+        }
+        else {
+            // Completed meanwhile; the callback must not outlive this object
+            lock.unlock();
+            token.removeCallback(registration);
+        }
+    }
+    return leader ? flight : 0;
+}
+
+template<class T>
+typename SingleFlight<T>::Launch SingleFlight<T>::launch(const std::string& key, unsigned long long flight, Promoter promote) {
+    std::lock_guard<std::mutex> lock(flightMutex);
+    Flight* current = find(key, flight);
+    if (!current) {
+        return Launch();
+    }
+    current->promote = std::move(promote);
+    return Launch{ true, current->priority, current->token };
+}
+
+template<class T>
+void SingleFlight<T>::leave(const std::string& key, unsigned long long flight, size_t caller, CancelReason reason) {
+    Callback callback;
+    CancellationToken abandoned;
+    {
+        std::lock_guard<std::mutex> lock(flightMutex);
+        Flight* current = find(key, flight);
+        Caller* entry = findCaller(current, caller);
+        if (!entry) {
+            return;
+        }
+        callback = std::move(entry->callback);
+        current->callers.erase(current->callers.begin() + (entry - current->callers.data()));
+
+        // Nobody waits for the result anymore
+        if (current->callers.empty()) {
+            abandoned = current->token;
+            inFlight.erase(key);
+        }
+    }
+
+    callback(nullptr, std::make_exception_ptr(RequestCancelled(reason)));
+    abandoned.cancel(reason);
+}
+
+template<class T>
+std::vector<typename SingleFlight<T>::Caller> SingleFlight<T>::take(const std::string& key, unsigned long long flight) {
+    std::vector<Caller> callers;
+    {
+        std::lock_guard<std::mutex> lock(flightMutex);
+        Flight* current = find(key, flight);
+        if (current) {
+            callers = std::move(current->callers);
+            inFlight.erase(key);
+        }
+    }
+
+    // Waits for a leave() already running, which then finds the flight gone
+    for (auto& caller : callers) {
+        caller.token.removeCallback(caller.registration);
+    }
+    return callers;
+}
+
+template<class T>
+void SingleFlight<T>::resolve(const std::string& key, unsigned long long flight, const T& value) {
+    // Complete outside the lock so continuations can start a new flight for the key
+    for (auto& caller : take(key, flight)) {
+        caller.callback(&value, nullptr);
+    }
+}
+
+template<class T>
+void SingleFlight<T>::reject(const std::string& key, unsigned long long flight, std::exception_ptr error) {
+    for (auto& caller : take(key, flight)) {
+        caller.callback(nullptr, error);
+    }
+}
\ No newline at end of file
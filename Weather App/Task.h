@@ -0,0 +1,113 @@
+/**
+ * @file Task.h
+ * @brief Lazily started C++20 coroutine task that can be awaited by another coroutine
+ */
+#pragma once
+#include <coroutine>
+#include <exception>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+/**
+ * @class Task
+ * @brief Coroutine returning T; its body starts when the task is first awaited
+ *
+ * The awaiting coroutine is resumed by symmetric transfer when the task finishes,
+ * so a chain of nested tasks never grows the stack. Exceptions thrown in the body
+ * are rethrown from co_await. A task that is never awaited never runs.
+ */
+template<class T = void>
+class Task {
+public:
+    struct promise_type;
+    using Handle = std::coroutine_handle<promise_type>;
+
+private:
+    struct PromiseBase {
+        std::coroutine_handle<> continuation;
+
+        struct FinalAwaiter {
+            bool await_ready() const noexcept { return false; }
+
+            template<class Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> finished) noexcept {
+                auto continuation = finished.promise().continuation;
+                return continuation ? continuation : std::noop_coroutine();
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        FinalAwaiter final_suspend() const noexcept { return {}; }
+    };
+
+    template<class Result>
+    struct ValuePromise : PromiseBase {
+        std::variant<std::monostate, Result, std::exception_ptr> result;
+
+        template<class U>
+        void return_value(U&& value) { result.template emplace<1>(std::forward<U>(value)); }
+        void unhandled_exception() { result.template emplace<2>(std::current_exception()); }
+
+        Result take() {
+            if (result.index() == 2) {
+                std::rethrow_exception(std::get<2>(result));
+            }
+            return std::move(std::get<1>(result));
+        }
+    };
+
+    struct VoidPromise : PromiseBase {
+        std::exception_ptr error;
+
+        void return_void() {}
+        void unhandled_exception() { error = std::current_exception(); }
+
+        void take() {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    };
+
+    using PromiseImpl = std::conditional_t<std::is_void_v<T>, VoidPromise, ValuePromise<T>>;
+
+    Handle handle;
+
+public:
+    struct promise_type : PromiseImpl {
+        Task get_return_object() { return Task(Handle::from_promise(*this)); }
+    };
+
+    explicit Task(Handle handle) : handle(handle) {}
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return !handle || handle.done(); }
+
+    // Start the body; it runs on the awaiting thread until its first suspension
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+
+    T await_resume() { return handle.promise().take(); }
+};
\ No newline at end of file
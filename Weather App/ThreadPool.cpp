@@ -2,35 +2,257 @@
  * @file ThreadPool.cpp
  * @brief Implementation of the ThreadPool class
  */
-#include "WeatherApp.h"
+#include "ThreadPool.h"
+#include <algorithm>
 
-ThreadPool::ThreadPool(size_t numThreads) : stop(false) {
+// The pool, deque and lane of the worker running on this thread, if any
+static thread_local const ThreadPool* currentPool = nullptr;
+static thread_local size_t currentQueue = 0;
+static thread_local RequestPriority currentLane = RequestPriority::Interactive;
+
+ThreadPool::ThreadPool(size_t numThreads) : nextQueue(0), pending(0), sleeping(0), stop(false) {
+    for (auto& count : pendingByLane) {
+        count.store(0);
+    }
+    numThreads = std::max<size_t>(1, numThreads);
     for (size_t i = 0; i < numThreads; ++i) {
-        workers.emplace_back([this] {
-            while (true) {
-                std::function<void()> task;
-                {
-                    std::unique_lock<std::mutex> lock(queueMutex);
-                    condition.wait(lock, [this] { return stop.load() || !tasks.empty(); });
-                    if (stop.load() && tasks.empty()) {
-                        return;
-                    }
-                    task = std::move(tasks.front());
-                    tasks.pop();
-                }
-                task();
-            }
-            });
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (size_t i = 0; i < numThreads; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
     }
 }
 
 ThreadPool::~ThreadPool() {
     {
-        std::unique_lock<std::mutex> lock(queueMutex);
+        std::lock_guard<std::mutex> lock(sleepMutex);
         stop.store(true);
     }
-    condition.notify_all();
+    wakeUp.notify_all();
     for (std::thread& worker : workers) {
         worker.join();
     }
-}
\ No newline at end of file
+}
+
+void ThreadPool::TaskRing::pushBack(Task&& task) {
+    if (count == ring.size()) {
+        // Unroll into a ring twice the size, oldest first
+        std::vector<Task> grown(ring.size() * 2);
+        for (size_t i = 0; i < count; ++i) {
+            grown[i] = std::move(ring[(head + i) & (ring.size() - 1)]);
+        }
+        ring = std::move(grown);
+        head = 0;
+    }
+    ring[(head + count) & (ring.size() - 1)] = std::move(task);
+    count++;
+}
+
+ThreadPool::Task ThreadPool::TaskRing::popFront() {
+    Task task = std::move(ring[head]);
+    head = (head + 1) & (ring.size() - 1);
+    count--;
+    return task;
+}
+
+ThreadPool::Task ThreadPool::TaskRing::popBack() {
+    count--;
+    return std::move(ring[(head + count) & (ring.size() - 1)]);
+}
+
+RequestPriority ThreadPool::currentPriority() {
+    return currentLane;
+}
+
+size_t ThreadPool::localQueue() const {
+    return currentPool == this ? currentQueue : queues.size();
+}
+
+void ThreadPool::post(Task task, RequestPriority priority) {
+    size_t lane = static_cast<size_t>(priority);
+
+    // Counted before the stop check, so workers can't exit between the check and the push.
+    // Workers may still submit while the destructor drains: their own deque outlives the task.
+    size_t index = localQueue();
+    pending.fetch_add(1);
+    if (stop.load() && index == queues.size()) {
+        pending.fetch_sub(1);
+        throw std::runtime_error("Enqueue on stopped ThreadPool");
+    }
+
+    if (index == queues.size()) {
+        index = nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    }
+    pendingByLane[lane].fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->lanes[lane].pushBack(std::move(task));
+    }
+    wake(1);
+}
+
+void ThreadPool::postBulk(std::vector<Task> tasks, RequestPriority priority) {
+    if (tasks.empty()) {
+        return;
+    }
+    size_t lane = static_cast<size_t>(priority);
+    size_t local = localQueue();
+    pending.fetch_add(tasks.size());
+    bool stopping = stop.load();
+    if (stopping && local == queues.size()) {
+        pending.fetch_sub(tasks.size());
+        throw std::runtime_error("Enqueue on stopped ThreadPool");
+    }
+    pendingByLane[lane].fetch_add(tasks.size());
+    if (stopping) {
+        // Other workers may already have exited, so the draining worker keeps the batch
+        std::lock_guard<std::mutex> lock(queues[local]->mutex);
+        for (Task& task : tasks) {
+            queues[local]->lanes[lane].pushBack(std::move(task));
+        }
+        return;
+    }
+
+    // Contiguous slices, one per deque, starting where the round-robin left off
+    size_t count = queues.size();
+    size_t slice = (tasks.size() + count - 1) / count;
+    size_t first = nextQueue.fetch_add(1, std::memory_order_relaxed);
+    auto task = tasks.begin();
+    for (size_t i = 0; task != tasks.end(); ++i) {
+        auto end = tasks.end() - task > static_cast<std::ptrdiff_t>(slice) ? task + slice : tasks.end();
+        WorkQueue& queue = *queues[(first + i) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        for (; task != end; ++task) {
+            queue.lanes[lane].pushBack(std::move(*task));
+        }
+    }
+    wake(tasks.size());
+}
+
+ThreadPool::Task ThreadPool::ticketEntry(std::shared_ptr<TicketState> state) {
+    return [state = std::move(state)]() {
+        if (!state->claimed.exchange(true)) {
+            Task task = std::move(state->task);
+            task();
+        }
+    };
+}
+
+ThreadPool::Ticket ThreadPool::postPromotable(Task task, RequestPriority priority) {
+    Ticket ticket;
+    ticket.state = std::make_shared<TicketState>(std::move(task), priority);
+    post(ticketEntry(ticket.state), priority);
+    return ticket;
+}
+
+bool ThreadPool::promote(const Ticket& ticket, RequestPriority priority) {
+    if (!ticket.state) {
+        return false;
+    }
+    RequestPriority queued = ticket.state->priority.load();
+    do {
+        if (ticket.state->claimed.load() || priority >= queued) {
+            return false;
+        }
+    } while (!ticket.state->priority.compare_exchange_weak(queued, priority));
+
+    post(ticketEntry(ticket.state), priority);
+    return true;
+}
+
+void ThreadPool::wake(size_t count) {
+    if (sleeping.load() == 0) {
+        return;
+    }
+    // A worker checks for work and starts waiting under sleepMutex, so taking it here can't miss one
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    if (count == 1) {
+        wakeUp.notify_one();
+    }
+    else {
+        wakeUp.notify_all();
+    }
+}
+
+bool ThreadPool::takeFrom(size_t index, size_t lane, Task& task) {
+    {
+        WorkQueue& own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.lanes[lane].count > 0) {
+            task = own.lanes[lane].popFront();
+            pendingByLane[lane].fetch_sub(1);
+            pending.fetch_sub(1);
+            return true;
+        }
+    }
+
+    // Steal from the other deques, starting with the next one
+    for (size_t i = 1; i < queues.size(); ++i) {
+        WorkQueue& victim = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.lanes[lane].count > 0) {
+            task = victim.lanes[lane].popBack();
+            pendingByLane[lane].fetch_sub(1);
+            pending.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::take(size_t index, size_t round, Task& task, RequestPriority& priority) {
+    // Highest lane first, except that every kFairnessInterval-th round starts at a lower lane, each in turn
+    size_t first = 0;
+    if (round % kFairnessInterval == kFairnessInterval - 1) {
+        first = 1 + (round / kFairnessInterval) % (kRequestPriorityCount - 1);
+    }
+    for (size_t i = 0; i < kRequestPriorityCount; ++i) {
+        size_t lane = i == 0 ? first : (i <= first ? i - 1 : i);
+        if (pendingByLane[lane].load() > 0 && takeFrom(index, lane, task)) {
+            priority = static_cast<RequestPriority>(lane);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentQueue = index;
+
+    Task task;
+    size_t round = 0;
+    while (true) {
+        if (take(index, round, task, currentLane)) {
+            round++;
+            try {
+                task();
+            }
+            catch (...) {
+                // A fire-and-forget task has nobody to report to
+            }
+            task = nullptr;
+            continue;
+        }
+
+        // Give submitters a few chances to add more before paying for a sleep and a wake-up
+        bool more = false;
+        for (int i = 0; i < kYieldsBeforeSleep && !more; ++i) {
+            std::this_thread::yield();
+            more = pending.load() > 0;
+        }
+        if (more) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        if (stop.load() && pending.load() == 0) {
+            return;
+        }
+        sleeping.fetch_add(1);
+        wakeUp.wait(lock, [this] { return stop.load() || pending.load() > 0; });
+        sleeping.fetch_sub(1);
+    }
+}
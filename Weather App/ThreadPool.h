@@ -1,30 +1,126 @@
 /**
  * @file ThreadPool.h
- * @brief Thread pool implementation for parallel task execution
+ * @brief Work-stealing thread pool for parallel task execution
  */
 #pragma once
 #include <vector>
-#include <queue>
+#include <array>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <functional>
 #include <atomic>
 #include <future>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include "BlockPool.h"
+#include "RequestPriority.h"
+#include "UniqueTask.h"
 
  /**
   * @class ThreadPool
   * @brief Thread pool for executing tasks in parallel
+  *
+  * Every worker owns a deque behind its own lock. Tasks submitted from outside
+  * the pool are spread over the deques round-robin, tasks submitted by a worker
+  * go to its own deque, and a worker that runs dry steals from the others, so
+  * no single lock is shared by every submission and every worker. Workers only
+  * sleep when there is nothing to take anywhere, and submitters only signal
+  * when some worker is asleep.
+  *
+  * Each deque has one lane per RequestPriority, and a worker looks for
+  * interactive work everywhere before it takes prefetch or background work
+  * from its own deque. So that a steady stream of clicks can't park a refresh
+  * forever, every kFairnessInterval-th take starts at a lower lane instead.
+  * A task posted with postPromotable() can be moved to a higher lane while it
+  * is still queued.
+  *
+  * Tasks are UniqueTasks, so a typical lambda is stored inline, and each lane
+  * is a ring that only allocates when it grows. enqueue() returns a future
+  * whose shared state comes from BlockPool and binds its arguments into the
+  * task without std::bind, so submitting a small callable allocates nothing
+  * once the pool is warm. post() is fire-and-forget and skips the shared
+  * state. A task that throws from post() is dropped without taking its worker
+  * down. The destructor runs every task already submitted, including the ones
+  * those tasks submit in turn.
   */
 class ThreadPool {
+public:
+    using Task = UniqueTask;
+
 private:
+    static constexpr int kYieldsBeforeSleep = 16;
+    static constexpr size_t kInitialQueueCapacity = 64;
+    static constexpr size_t kFairnessInterval = 16;
+
+    // Ring buffer of tasks; the owner takes from the front, thieves from the back
+    struct TaskRing {
+        std::vector<Task> ring;     // Capacity is a power of two
+        size_t head = 0;
+        size_t count = 0;
+
+        TaskRing() : ring(kInitialQueueCapacity) {}
+
+        void pushBack(Task&& task);
+        Task popFront();
+        Task popBack();
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::array<TaskRing, kRequestPriorityCount> lanes;
+    };
+
+    // A promotable task; whichever of its queue entries is taken first runs it
+    struct TicketState {
+        std::atomic<bool> claimed{ false };
+        std::atomic<RequestPriority> priority;
+        Task task;
+
+        TicketState(Task task, RequestPriority priority) : priority(priority), task(std::move(task)) {}
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
     std::vector<std::thread> workers;
-    std::queue<std::function<void()>> tasks;
-    std::mutex queueMutex;
-    std::condition_variable condition;
+    std::atomic<size_t> nextQueue;      // Round-robin target of outside submissions
+    std::atomic<size_t> pending;        // Tasks in the deques, not yet taken
+    std::array<std::atomic<size_t>, kRequestPriorityCount> pendingByLane;
+
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    std::atomic<size_t> sleeping;
     std::atomic<bool> stop;
 
+    size_t localQueue() const;
+    bool takeFrom(size_t index, size_t lane, Task& task);
+    bool take(size_t index, size_t round, Task& task, RequestPriority& priority);
+    void wake(size_t count);
+    void workerLoop(size_t index);
+    static Task ticketEntry(std::shared_ptr<TicketState> state);
+
+    template<class R, class Callable>
+    static void fulfil(std::promise<R>& promise, Callable& callable);
+
 public:
+    /**
+     * @class Ticket
+     * @brief Handle to a task posted with postPromotable()
+     */
+    class Ticket {
+    private:
+        friend class ThreadPool;
+        std::shared_ptr<TicketState> state;
+
+    public:
+        explicit operator bool() const { return state != nullptr; }
+
+        // True once a worker has taken the task
+        bool started() const { return state && state->claimed.load(); }
+        RequestPriority priority() const { return state->priority.load(); }
+    };
+
     /**
      * @brief Constructor
      * @param numThreads Number of worker threads
@@ -36,33 +132,123 @@ public:
      */
     ~ThreadPool();
 
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t getThreadCount() const { return workers.size(); }
+
+    /**
+     * @brief Lane of the task running on the calling worker thread, Interactive outside the pool
+     *
+     * Lets a task pass its priority, promoted or not, on to the requests it makes.
+     */
+    static RequestPriority currentPriority();
+
+    /**
+     * @brief Enqueue a task without a way to wait for it
+     * @throws std::runtime_error if the pool is stopping
+     */
+    void post(Task task, RequestPriority priority = RequestPriority::Background);
+
+    /**
+     * @brief Enqueue many tasks with one lock per worker deque and one round of wake-ups
+     * @throws std::runtime_error if the pool is stopping
+     */
+    void postBulk(std::vector<Task> tasks, RequestPriority priority = RequestPriority::Background);
+
     /**
-     * @brief Enqueue a task for execution
+     * @brief Enqueue a task that promote() can move to a higher lane later
+     * @throws std::runtime_error if the pool is stopping
+     */
+    Ticket postPromotable(Task task, RequestPriority priority = RequestPriority::Background);
+
+    /**
+     * @brief Move a queued task up to the given priority
+     *
+     * The task is queued again in the higher lane and runs from whichever
+     * entry a worker reaches first; the other entry is skipped.
+     * @return false if the task already started or is queued at that priority or higher
+     */
+    bool promote(const Ticket& ticket, RequestPriority priority);
+
+    /**
+     * @brief Enqueue a task for execution in the background lane
      * @param f The task to execute
      * @return Future for the task result
      */
     template<class F, class... Args>
     auto enqueue(F&& f, Args&&... args)
         -> std::future<typename std::invoke_result<F, Args...>::type>;
+
+    /**
+     * @brief Enqueue a task for execution in the given lane
+     */
+    template<class F, class... Args>
+    auto enqueue(RequestPriority priority, F&& f, Args&&... args)
+        -> std::future<typename std::invoke_result<F, Args...>::type>;
+
+    /**
+     * @brief Enqueue every callable in [first, last) in one bulk submission
+     * @return Futures for the results, in order
+     */
+    template<class Iterator>
+    auto enqueueBulk(Iterator first, Iterator last, RequestPriority priority = RequestPriority::Background)
+        -> std::vector<std::future<typename std::invoke_result<decltype(*first)>::type>>;
 };
 
+template<class R, class Callable>
+void ThreadPool::fulfil(std::promise<R>& promise, Callable& callable) {
+    try {
+        if constexpr (std::is_void_v<R>) {
+            callable();
+            promise.set_value();
+        }
+        else {
+            promise.set_value(callable());
+        }
+    }
+    catch (...) {
+        promise.set_exception(std::current_exception());
+    }
+}
+
 template<class F, class... Args>
 auto ThreadPool::enqueue(F&& f, Args&&... args)
 -> std::future<typename std::invoke_result<F, Args...>::type> {
-    using return_type = typename std::invoke_result<F, Args...>::type;
+    return enqueue(RequestPriority::Background, std::forward<F>(f), std::forward<Args>(args)...);
+}
 
-    auto task = std::make_shared<std::packaged_task<return_type()>>(
-        std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-    );
+template<class F, class... Args>
+auto ThreadPool::enqueue(RequestPriority priority, F&& f, Args&&... args)
+-> std::future<typename std::invoke_result<F, Args...>::type> {
+    using return_type = typename std::invoke_result<F, Args...>::type;
 
-    std::future<return_type> result = task->get_future();
-    {
-        std::unique_lock<std::mutex> lock(queueMutex);
-        if (stop.load()) {
-            throw std::runtime_error("Enqueue on stopped ThreadPool");
-        }
-        tasks.emplace([task]() { (*task)(); });
+    std::promise<return_type> promise(std::allocator_arg, BlockPoolAllocator<return_type>());
+    std::future<return_type> result = promise.get_future();
+    if constexpr (sizeof...(Args) == 0) {
+        post([promise = std::move(promise), f = std::forward<F>(f)]() mutable { fulfil(promise, f); }, priority);
+    }
+    else {
+        post([promise = std::move(promise), f = std::forward<F>(f), args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+            auto call = [&f, &args]() -> return_type { return std::apply(std::move(f), std::move(args)); };
+            fulfil(promise, call);
+            }, priority);
     }
-    condition.notify_one();
     return result;
-}
\ No newline at end of file
+}
+
+template<class Iterator>
+auto ThreadPool::enqueueBulk(Iterator first, Iterator last, RequestPriority priority)
+-> std::vector<std::future<typename std::invoke_result<decltype(*first)>::type>> {
+    using return_type = typename std::invoke_result<decltype(*first)>::type;
+
+    std::vector<std::future<return_type>> results;
+    std::vector<Task> tasks;
+    for (; first != last; ++first) {
+        std::promise<return_type> promise(std::allocator_arg, BlockPoolAllocator<return_type>());
+        results.push_back(promise.get_future());
+        tasks.emplace_back([promise = std::move(promise), f = *first]() mutable { fulfil(promise, f); });
+    }
+    postBulk(std::move(tasks), priority);
+    return results;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file TimerQueue.cpp
+ * @brief Implementation of the TimerQueue class
+ */
+#include "TimerQueue.h"
+
+TimerQueue::TimerQueue() : nextSequence(1), stop(false) {
+    worker = std::thread([this] { run(); });
+}
+
+TimerQueue::~TimerQueue() {
+    shutdown();
+}
+
+void TimerQueue::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(timerMutex);
+        stop = true;
+    }
+    timerChanged.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+TimerQueue::TimerId TimerQueue::schedule(Clock::time_point due, std::function<void()> callback) {
+    TimerId id;
+    {
+        std::lock_guard<std::mutex> lock(timerMutex);
+        id = nextSequence++;
+        timers.push({ due, id });
+        callbacks.emplace(id, std::move(callback));
+    }
+    timerChanged.notify_one();
+    return id;
+}
+
+TimerQueue::TimerId TimerQueue::schedule(Clock::duration delay, std::function<void()> callback) {
+    return schedule(Clock::now() + delay, std::move(callback));
+}
+
+bool TimerQueue::cancel(TimerId id) {
+    std::function<void()> callback;
+    {
+        std::lock_guard<std::mutex> lock(timerMutex);
+        auto it = callbacks.find(id);
+        if (it == callbacks.end()) {
+            return false;
+        }
+        callback = std::move(it->second);
+        callbacks.erase(it);
+    }
+    // Its captures are released here, outside the lock
+    return true;
+}
+
+void TimerQueue::expireAll() {
+    {
+        std::lock_guard<std::mutex> lock(timerMutex);
+        std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> expired;
+        while (!timers.empty()) {
+            Timer timer = timers.top();
+            timers.pop();
+            timer.due = Clock::time_point::min();
+            expired.push(std::move(timer));
+        }
+        timers.swap(expired);
+    }
+    timerChanged.notify_one();
+}
+
+void TimerQueue::run() {
+    std::unique_lock<std::mutex> lock(timerMutex);
+    while (!stop) {
+        if (timers.empty()) {
+            timerChanged.wait(lock);
+            continue;
+        }
+
+        auto pending = callbacks.find(timers.top().sequence);
+        if (pending == callbacks.end()) {
+            timers.pop();
+            continue;
+        }
+
+        auto due = timers.top().due;
+        if (Clock::now() < due) {
+            // Woken early when an earlier timer is scheduled or on shutdown
+            timerChanged.wait_until(lock, due);
+            continue;
+        }
+
+        auto callback = std::move(pending->second);
+        callbacks.erase(pending);
+        timers.pop();
+        lock.unlock();
+        callback();
+        lock.lock();
+    }
+}
\ No newline at end of file
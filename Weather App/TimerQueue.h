@@ -0,0 +1,83 @@
+/**
+ * @file TimerQueue.h
+ * @brief Single thread that runs callbacks at scheduled points in time
+ */
+#pragma once
+#include <queue>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+
+/**
+ * @class TimerQueue
+ * @brief Runs delayed callbacks without parking a worker thread per delay
+ *
+ * Callbacks run on the timer thread and should only hand work off (complete a
+ * promise, enqueue on a pool); a slow callback delays every timer behind it.
+ * Callbacks still pending when the queue is destroyed are dropped. A timer
+ * cancelled before it fires releases its callback right away.
+ */
+class TimerQueue {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Handle for cancel(); never 0
+     */
+    using TimerId = unsigned long long;
+
+private:
+    // The heap only orders the timers; a cancelled one is skipped when it comes up
+    struct Timer {
+        Clock::time_point due;
+        TimerId sequence;
+
+        // Earliest deadline on top of the heap, FIFO among equal deadlines
+        bool operator>(const Timer& other) const {
+            return due != other.due ? due > other.due : sequence > other.sequence;
+        }
+    };
+
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+    std::unordered_map<TimerId, std::function<void()>> callbacks;
+    std::mutex timerMutex;
+    std::condition_variable timerChanged;
+    TimerId nextSequence;
+    bool stop;
+    std::thread worker;
+
+    void run();
+
+public:
+    TimerQueue();
+    ~TimerQueue();
+
+    TimerQueue(const TimerQueue&) = delete;
+    TimerQueue& operator=(const TimerQueue&) = delete;
+
+    TimerId schedule(Clock::time_point due, std::function<void()> callback);
+    TimerId schedule(Clock::duration delay, std::function<void()> callback);
+
+    /**
+     * @brief Drop a timer that hasn't fired yet
+     * @return false if it already fired, is firing, or was cancelled
+     */
+    bool cancel(TimerId id);
+
+    /**
+     * @brief Stop the timer thread and drop pending callbacks; the destructor does the same
+     *
+     * For owners whose callbacks reference members destroyed before the queue.
+     * Must not be called from a callback.
+     */
+    void shutdown();
+
+    /**
+     * @brief Make every pending callback due now, e.g. to fail waiting work quickly on shutdown
+     */
+    void expireAll();
+};
\ No newline at end of file
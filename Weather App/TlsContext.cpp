@@ -0,0 +1,204 @@
+/**
+ * @file TlsContext.cpp
+ * @brief Implementation of the TlsContext class
+ */
+#include "TlsContext.h"
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+#include <stdexcept>
+#include <cstdint>
+#ifdef _WIN32
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#endif
+#include <openssl/err.h>
+#include <openssl/x509v3.h>
+
+#ifdef MSG_NOSIGNAL
+static constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+// No SIGPIPE on Windows; elsewhere the socket is expected to have SO_NOSIGPIPE
+static constexpr int kSendFlags = 0;
+#endif
+
+static int socketOf(BIO* bio) {
+    return static_cast<int>(reinterpret_cast<intptr_t>(BIO_get_data(bio)));
+}
+
+TlsContext::TlsContext(const TlsOptions& options) : context(SSL_CTX_new(TLS_client_method())), socketMethod(nullptr) {
+    if (!context) {
+        throw std::runtime_error("Failed to create TLS context: " + lastError());
+    }
+
+    socketMethod = BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK | BIO_TYPE_DESCRIPTOR, "socket without SIGPIPE");
+    if (!socketMethod || !BIO_meth_set_write(socketMethod, &TlsContext::socketWrite) ||
+        !BIO_meth_set_read(socketMethod, &TlsContext::socketRead) ||
+        !BIO_meth_set_ctrl(socketMethod, &TlsContext::socketControl)) {
+        std::string error = lastError();
+        BIO_meth_free(socketMethod);
+        SSL_CTX_free(context);
+        throw std::runtime_error("Failed to create TLS socket method: " + error);
+    }
+
+    SSL_CTX_set_min_proto_version(context, TLS1_2_VERSION);
+    SSL_CTX_set_options(context, SSL_OP_NO_COMPRESSION);
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+    // Servers often close keep-alive connections without close_notify
+    SSL_CTX_set_options(context, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+    // The output buffer of a connection grows while a write waits to be retried
+    SSL_CTX_set_mode(context, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER | SSL_MODE_RELEASE_BUFFERS);
+
+    if (options.verifyPeer) {
+        int loaded = options.caFile.empty()
+            ? SSL_CTX_set_default_verify_paths(context)
+            : SSL_CTX_load_verify_locations(context, options.caFile.c_str(), nullptr);
+        if (loaded != 1) {
+            std::string error = lastError();
+            BIO_meth_free(socketMethod);
+            SSL_CTX_free(context);
+            throw std::runtime_error("Failed to load trusted certificates: " + error);
+        }
+        SSL_CTX_set_verify(context, SSL_VERIFY_PEER, nullptr);
+    }
+    else {
+        SSL_CTX_set_verify(context, SSL_VERIFY_NONE, nullptr);
+    }
+
+    if (options.resumeSessions) {
+        // Sessions are kept per host by onNewSession rather than in OpenSSL's cache, which is keyed by session ID
+        SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(context, &TlsContext::onNewSession);
+        SSL_CTX_set_app_data(context, this);
+    }
+    else {
+        SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_OFF);
+        SSL_CTX_set_options(context, SSL_OP_NO_TICKET);
+    }
+}
+
+TlsContext::~TlsContext() {
+    for (auto& pair : sessions) {
+        for (SSL_SESSION* session : pair.second) {
+            SSL_SESSION_free(session);
+        }
+    }
+    BIO_meth_free(socketMethod);
+    SSL_CTX_free(context);
+}
+
+int TlsContext::socketWrite(BIO* bio, const char* data, int length) {
+    BIO_clear_retry_flags(bio);
+    int sent = static_cast<int>(send(socketOf(bio), data, length, kSendFlags));
+    if (sent <= 0 && BIO_sock_should_retry(sent)) {
+        BIO_set_retry_write(bio);
+    }
+    return sent;
+}
+
+int TlsContext::socketRead(BIO* bio, char* buffer, int length) {
+    BIO_clear_retry_flags(bio);
+    int received = static_cast<int>(recv(socketOf(bio), buffer, length, 0));
+    if (received == 0) {
+        // Lets SSL_OP_IGNORE_UNEXPECTED_EOF tell a closed connection from an error
+        BIO_set_flags(bio, BIO_FLAGS_IN_EOF);
+    }
+    else if (received < 0 && BIO_sock_should_retry(received)) {
+        BIO_set_retry_read(bio);
+    }
+    return received;
+}
+
+long TlsContext::socketControl(BIO* bio, int command, long, void* pointer) {
+    switch (command) {
+    case BIO_C_GET_FD:
+        if (pointer) {
+            *static_cast<int*>(pointer) = socketOf(bio);
+        }
+        return socketOf(bio);
+    case BIO_CTRL_EOF:
+        return BIO_test_flags(bio, BIO_FLAGS_IN_EOF) != 0;
+    case BIO_CTRL_FLUSH:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+int TlsContext::onNewSession(SSL* ssl, SSL_SESSION* session) {
+    auto* self = static_cast<TlsContext*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+    auto* key = static_cast<const std::string*>(SSL_get_app_data(ssl));
+    if (!self || !key) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(self->sessionMutex);
+    auto& cached = self->sessions[*key];
+    if (cached.size() >= kMaxSessionsPerHost) {
+        SSL_SESSION_free(cached.front());
+        cached.pop_front();
+    }
+    // Returning 1 keeps the reference OpenSSL passed in
+    cached.push_back(session);
+    return 1;
+}
+
+SSL* TlsContext::open(int fd, const std::string& serverName, const std::string& sessionKey, std::string& error) {
+    ERR_clear_error();
+    SSL* ssl = SSL_new(context);
+    BIO* bio = ssl ? BIO_new(socketMethod) : nullptr;
+    if (!bio) {
+        error = "Failed to create TLS session: " + lastError();
+        SSL_free(ssl);
+        return nullptr;
+    }
+    // The socket stays owned by the caller; SSL_free frees the BIO only
+    BIO_set_data(bio, reinterpret_cast<void*>(static_cast<intptr_t>(fd)));
+    BIO_set_init(bio, 1);
+    SSL_set_bio(ssl, bio, bio);
+    SSL_set_connect_state(ssl);
+
+    unsigned char address[sizeof(in6_addr)];
+    bool isAddress = inet_pton(AF_INET, serverName.c_str(), address) == 1 || inet_pton(AF_INET6, serverName.c_str(), address) == 1;
+    // SNI carries host names only
+    if (!isAddress) {
+        SSL_set_tlsext_host_name(ssl, serverName.c_str());
+    }
+    if (SSL_get_verify_mode(ssl) & SSL_VERIFY_PEER) {
+        int checked = isAddress
+            ? X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(ssl), serverName.c_str())
+            : SSL_set1_host(ssl, serverName.c_str());
+        if (checked != 1) {
+            error = "Invalid TLS server name: " + serverName;
+            SSL_free(ssl);
+            return nullptr;
+        }
+    }
+
+    if (SSL_CTX_get_app_data(context)) {
+        std::lock_guard<std::mutex> lock(sessionMutex);
+        // Map keys don't move, so the session callback can find its host through the app data
+        auto it = sessions.try_emplace(sessionKey).first;
+        SSL_set_app_data(ssl, const_cast<std::string*>(&it->first));
+        if (!it->second.empty()) {
+            // SSL_set_session takes its own reference
+            SSL_SESSION* session = it->second.back();
+            it->second.pop_back();
+            SSL_set_session(ssl, session);
+            SSL_SESSION_free(session);
+        }
+    }
+    return ssl;
+}
+
+std::string TlsContext::lastError() {
+    unsigned long code = ERR_get_error();
+    if (code == 0) {
+        return "unknown error";
+    }
+    char buffer[256];
+    ERR_error_string_n(code, buffer, sizeof(buffer));
+    return buffer;
+}
+#endif
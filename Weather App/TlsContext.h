@@ -0,0 +1,67 @@
+/**
+ * @file TlsContext.h
+ * @brief Client TLS settings and session cache shared by the connections of the event loop transport
+ */
+#pragma once
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+#include <string>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <openssl/ssl.h>
+#include "HttpTransport.h"
+
+/**
+ * @class TlsContext
+ * @brief Creates client TLS sessions that resume an earlier session of their host
+ *
+ * The session tickets a server sends are kept per host and each one is offered
+ * by one later connection to that host, so only connections opened before any
+ * ticket arrived pay for a full handshake; the rest skip the certificate
+ * exchange and key agreement. Tickets are used once, as TLS 1.3 recommends and
+ * as servers with replay protection require; every resumed connection brings
+ * a new one.
+ *
+ * Sessions write to their socket with send() and MSG_NOSIGNAL, so a server
+ * that drops the connection fails the write instead of raising SIGPIPE;
+ * OpenSSL's own socket BIO writes with write(), which can't ask for that.
+ */
+class TlsContext {
+private:
+    static constexpr size_t kMaxSessionsPerHost = 64;
+
+    SSL_CTX* context;
+    BIO_METHOD* socketMethod;   // Socket BIO that writes without SIGPIPE
+    std::unordered_map<std::string, std::deque<SSL_SESSION*>> sessions;    // Unused tickets per host:port, newest last
+    std::mutex sessionMutex;
+
+    static int onNewSession(SSL* ssl, SSL_SESSION* session);
+    static int socketWrite(BIO* bio, const char* data, int length);
+    static int socketRead(BIO* bio, char* buffer, int length);
+    static long socketControl(BIO* bio, int command, long argument, void* pointer);
+
+public:
+    /**
+     * @throws std::runtime_error if the context or the CA bundle can't be loaded
+     */
+    explicit TlsContext(const TlsOptions& options);
+    ~TlsContext();
+
+    TlsContext(const TlsContext&) = delete;
+    TlsContext& operator=(const TlsContext&) = delete;
+
+    /**
+     * @brief Create a client session on a connected socket
+     * @param fd Connected socket
+     * @param serverName Host name (or IP address) the certificate must match
+     * @param sessionKey host:port whose cached sessions to resume
+     * @return The session in connect state, or null with the error set
+     */
+    SSL* open(int fd, const std::string& serverName, const std::string& sessionKey, std::string& error);
+
+    /**
+     * @brief Text of the last OpenSSL error on this thread
+     */
+    static std::string lastError();
+};
+#endif
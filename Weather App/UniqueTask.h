@@ -0,0 +1,125 @@
+/**
+ * @file UniqueTask.h
+ * @brief Move-only void() callable that stores small callables inline
+ */
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @class UniqueTask
+ * @brief Type-erased, move-only replacement for std::function<void()>
+ *
+ * Callables up to kInlineSize bytes that are nothrow movable live inside the
+ * task itself, so wrapping a typical lambda (a pointer and a city name, even
+ * with the promise enqueue() adds) allocates nothing. Larger callables go to
+ * the heap. Being move-only, a task can hold a std::promise or a unique_ptr,
+ * which std::function can't.
+ */
+class UniqueTask {
+public:
+    static constexpr size_t kInlineSize = 80;
+
+private:
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*relocate)(void* from, void* to) noexcept;    // Move-constructs into to and destroys from
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    template<class F>
+    static constexpr bool fitsInline = sizeof(F) <= kInlineSize
+        && alignof(F) <= alignof(std::max_align_t)
+        && std::is_nothrow_move_constructible_v<F>;
+
+    template<class F>
+    struct InlineOps {
+        static void invoke(void* storage) { (*static_cast<F*>(storage))(); }
+        static void relocate(void* from, void* to) noexcept {
+            ::new (to) F(std::move(*static_cast<F*>(from)));
+            static_cast<F*>(from)->~F();
+        }
+        static void destroy(void* storage) noexcept { static_cast<F*>(storage)->~F(); }
+        static constexpr Ops ops{ &invoke, &relocate, &destroy };
+    };
+
+    // The storage holds only a pointer to the callable
+    template<class F>
+    struct HeapOps {
+        static void invoke(void* storage) { (**static_cast<F**>(storage))(); }
+        static void relocate(void* from, void* to) noexcept { *static_cast<F**>(to) = *static_cast<F**>(from); }
+        static void destroy(void* storage) noexcept { delete *static_cast<F**>(storage); }
+        static constexpr Ops ops{ &invoke, &relocate, &destroy };
+    };
+
+    alignas(std::max_align_t) unsigned char storage[kInlineSize];
+    const Ops* ops = nullptr;
+
+public:
+    UniqueTask() noexcept = default;
+    UniqueTask(std::nullptr_t) noexcept {}
+
+    template<class F, class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, UniqueTask>
+        && std::is_invocable_v<std::decay_t<F>&>>>
+    UniqueTask(F&& f) {
+        using Callable = std::decay_t<F>;
+        if constexpr (fitsInline<Callable>) {
+            ::new (static_cast<void*>(storage)) Callable(std::forward<F>(f));
+            ops = &InlineOps<Callable>::ops;
+        }
+        else {
+            ::new (static_cast<void*>(storage)) Callable*(new Callable(std::forward<F>(f)));
+            ops = &HeapOps<Callable>::ops;
+        }
+    }
+
+    UniqueTask(UniqueTask&& other) noexcept : ops(other.ops) {
+        if (ops) {
+            ops->relocate(other.storage, storage);
+            other.ops = nullptr;
+        }
+    }
+
+    UniqueTask& operator=(UniqueTask&& other) noexcept {
+        if (this != &other) {
+            reset();
+            if (other.ops) {
+                other.ops->relocate(other.storage, storage);
+                ops = std::exchange(other.ops, nullptr);
+            }
+        }
+        return *this;
+    }
+
+    UniqueTask& operator=(std::nullptr_t) noexcept {
+        reset();
+        return *this;
+    }
+
+    UniqueTask(const UniqueTask&) = delete;
+    UniqueTask& operator=(const UniqueTask&) = delete;
+
+    ~UniqueTask() { reset(); }
+
+    void reset() noexcept {
+        if (ops) {
+            ops->destroy(storage);
+            ops = nullptr;
+        }
+    }
+
+    explicit operator bool() const noexcept { return ops != nullptr; }
+
+    /**
+     * @throws std::bad_function_call if the task is empty
+     */
+    void operator()() {
+        if (!ops) {
+            throw std::bad_function_call();
+        }
+        ops->invoke(storage);
+    }
+};
@@ -3,23 +3,543 @@
  * @brief Implementation of the WeatherAPI class with improved error handling
  */
 #include "WeatherAPI.h"
+#include "JsonStreamReader.h"
+#include "WeatherSchema.h"
+#include "BlockingHttpTransport.h"
+#include "EventHttpClient.h"
+#include "ContentDecoder.h"
+#include <algorithm>
+#include <iterator>
 #include <chrono>
+#include <cctype>
 #include <ctime>
 #include <iomanip>
+#include <random>
 #include <sstream>
+#include <utility>
 
 using json = nlohmann::json;
 
-WeatherAPI::WeatherAPI(const std::string& apiKey)
-    : apiKey(apiKey), baseUrl("api.openweathermap.org"), isRunning(true) {
+std::unique_ptr<HttpTransport> WeatherAPI::createDefaultTransport(const TlsOptions& tls) {
+#ifdef __linux__
+    return std::make_unique<EventHttpClient>(1, tls);
+#else
+    return std::make_unique<BlockingHttpTransport>(tls);
+#endif
+}
+
+WeatherAPI::WeatherAPI(const std::string& apiKey, std::shared_ptr<ThreadPool> executor, std::unique_ptr<HttpTransport> transport)
+    : apiKey(apiKey), baseUrl(kDefaultBaseUrl), isRunning(true), shutdownToken(CancellationToken::create()),
+    transport(transport ? std::move(transport) : createDefaultTransport()), inFlight(0), rateLimiter(timers),
+    executor(executor ? std::move(executor) : std::make_shared<ThreadPool>(kDefaultIoThreads)) {
 }
 
 WeatherAPI::~WeatherAPI() {
     cancel();
+
+    // A shared executor may outlive us, so wait for our queued requests to drain
+    std::unique_lock<std::mutex> lock(inFlightMutex);
+    inFlightDone.wait(lock, [this] { return inFlight == 0; });
+    lock.unlock();
+
+    // Timers reference the limiter and this object, which are destroyed next
+    timers.shutdown();
+}
+
+void WeatherAPI::finishRequest() {
+    std::lock_guard<std::mutex> lock(inFlightMutex);
+    if (--inFlight == 0) {
+        inFlightDone.notify_all();
+    }
 }
 
 void WeatherAPI::cancel() {
     isRunning.store(false);
+
+    // Fails every request and stops the clients of those blocked on the network
+    shutdownToken.cancel();
+
+    // Requests still waiting for a token fail instead of starting, pending retries fire now
+    rateLimiter.shutdown();
+    timers.expireAll();
+}
+
+std::string WeatherAPI::currentApiKey() const {
+    std::lock_guard<std::mutex> lock(apiKeyMutex);
+    return apiKey;
+}
+
+std::string WeatherAPI::currentBaseUrl() const {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    return baseUrl;
+}
+
+void WeatherAPI::setBaseUrl(const std::string& url) {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    baseUrl = url.empty() ? kDefaultBaseUrl : url;
+}
+
+std::string WeatherAPI::getBaseUrl() const {
+    return currentBaseUrl();
+}
+
+struct WeatherAPI::RequestRace {
+    std::string endpoint;
+    RequestPriority priority;   // Guarded by mutex; a more urgent caller joining the flight raises it
+
+    // Cancelled by the caller's token, shutdown, the total deadline, or the winning attempt
+    CancellationToken token;
+    CancellationToken callerToken;
+    size_t callerRegistration = 0;
+    size_t shutdownRegistration = 0;
+
+    // Runs the fetch and publishes the result if no other attempt did, then reports
+    // whether it did, or the error
+    std::function<void(RequestRace&, const CancellationToken&, std::function<void(bool, std::exception_ptr)>)> attempt;
+    std::function<void(std::exception_ptr)> onError;
+
+    std::mutex mutex;
+    bool completed = false;
+    bool deadlineArmed = false;
+    TimerQueue::TimerId deadlineTimer = 0;
+    TimerQueue::TimerId hedgeTimer = 0;     // Of the latest first or retried attempt
+    int attempts = 0;
+    int outstanding = 0;    // Attempts running or waiting for a token, plus a scheduled retry
+
+    // Where attempts wait, so promoting the race moves them up too
+    std::vector<RateLimiter::Ticket> limiterTickets;
+    std::vector<ThreadPool::Ticket> executorTickets;
+
+    bool claim() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (completed) {
+            return false;
+        }
+        completed = true;
+        return true;
+    }
+};
+
+static bool isTransientError(std::exception_ptr error) {
+    try {
+        std::rethrow_exception(error);
+    }
+    catch (const ApiError& e) {
+        return e.isTransient();
+    }
+    catch (...) {
+        return false;
+    }
+}
+
+// Full jitter: a uniform delay up to an exponentially growing ceiling, so clients
+// that failed together do not retry together
+static std::chrono::milliseconds backoffDelay(const RetryPolicy& policy, int attempt, std::exception_ptr error) {
+    thread_local std::mt19937 random(std::random_device{}());
+    long long ceiling = policy.baseDelay.count() << std::min(attempt - 1, 16);
+    ceiling = std::min(ceiling, static_cast<long long>(policy.maxDelay.count()));
+    std::chrono::milliseconds delay(std::uniform_int_distribution<long long>(0, std::max(0LL, ceiling))(random));
+
+    // A 429 or 503 may say how long to wait
+    try {
+        std::rethrow_exception(error);
+    }
+    catch (const ApiError& e) {
+        auto retryAfter = std::chrono::duration_cast<std::chrono::milliseconds>(e.getRetryAfter());
+        delay = std::max(delay, std::min(retryAfter, policy.maxDelay));
+    }
+    catch (...) {
+    }
+    return delay;
+}
+
+std::shared_ptr<WeatherAPI::RequestRace> WeatherAPI::createRace(const char* endpoint, RequestPriority priority,
+    const CancellationToken& token) {
+    auto race = std::make_shared<RequestRace>();
+    race->endpoint = endpoint;
+    race->priority = priority;
+    race->token = CancellationToken::create();
+    race->callerToken = token;
+    return race;
+}
+
+template<class T>
+void WeatherAPI::startRequest(const std::shared_ptr<RequestRace>& race,
+    std::function<void(const CancellationToken&, ResultCallback<T>)> fetch, std::function<void(T)> onValue,
+    std::function<void(std::exception_ptr)> onError) {
+    race->onError = std::move(onError);
+    race->attempt = [fetch = std::move(fetch), onValue = std::move(onValue)](RequestRace& self, const CancellationToken& attemptToken,
+        std::function<void(bool, std::exception_ptr)> finished) {
+        fetch(attemptToken, [&self, onValue, finished](const T* value, std::exception_ptr error) {
+            if (!value) {
+                finished(false, error);
+                return;
+            }
+            if (!self.claim()) {
+                finished(false, nullptr);
+                return;
+            }
+            onValue(*value);
+
+            // Abort the attempts that lost the race
+            self.token.cancel();
+            finished(true, nullptr);
+            });
+    };
+    race->outstanding = 1;
+
+    {
+        std::lock_guard<std::mutex> lock(inFlightMutex);
+        inFlight++;
+    }
+
+    std::weak_ptr<RequestRace> weakRace = race;
+    race->token.onCancel([this, weakRace](CancelReason reason) {
+        auto race = weakRace.lock();
+        if (race) {
+            abortRace(race, reason);
+        }
+        });
+
+    // Deadline timeouts come from the request's own timer; a parent token only cancels
+    auto cancelRace = [raceToken = race->token](CancelReason) { raceToken.cancel(); };
+    race->callerRegistration = race->callerToken.onCancel(cancelRace);
+    race->shutdownRegistration = shutdownToken.onCancel(cancelRace);
+
+    launchAttempt(race, false);
+}
+
+template<class T>
+void WeatherAPI::launchFlight(SingleFlight<T>& flights, const std::string& key, unsigned long long flight, const char* endpoint,
+    std::function<void(const CancellationToken&, ResultCallback<T>)> fetch) {
+    // The race needs the flight's token, and joiners from now on need the race to promote
+    auto race = createRace(endpoint, RequestPriority::Background, CancellationToken());
+    std::weak_ptr<RequestRace> weakRace = race;
+    auto launch = flights.launch(key, flight, [this, weakRace](RequestPriority raised) {
+        if (auto race = weakRace.lock()) {
+            promoteRace(race, raised);
+        }
+        });
+    if (!launch.live) {
+        // Every caller cancelled before it started
+        return;
+    }
+    race->callerToken = launch.token;
+    promoteRace(race, launch.priority);
+
+    startRequest<T>(race, std::move(fetch),
+        [&flights, key, flight](T value) { flights.resolve(key, flight, value); },
+        [&flights, key, flight](std::exception_ptr error) { flights.reject(key, flight, error); });
+}
+
+void WeatherAPI::promoteRace(const std::shared_ptr<RequestRace>& race, RequestPriority priority) {
+    // The limiter and the pool never call back into a race under their own locks, so both
+    // can be promoted under the race's, and attempts queued meanwhile see the new priority
+    std::lock_guard<std::mutex> lock(race->mutex);
+    if (race->completed || priority >= race->priority) {
+        return;
+    }
+    race->priority = priority;
+
+    // Drop the tickets of attempts that already left their queue
+    std::erase_if(race->limiterTickets, [this, priority](const RateLimiter::Ticket& ticket) {
+        return !rateLimiter.promote(ticket, priority);
+        });
+    std::erase_if(race->executorTickets, [this, priority](const ThreadPool::Ticket& ticket) {
+        executor->promote(ticket, priority);
+        return ticket.started();
+        });
+}
+
+void WeatherAPI::abortRace(const std::shared_ptr<RequestRace>& race, CancelReason reason) {
+    // Attempts still running fail on their own and are ignored once the race is completed
+    if (!race->claim()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(policyMutex);
+        if (reason == CancelReason::TimedOut) {
+            requestStats.timedOut++;
+        }
+        else {
+            requestStats.cancelled++;
+        }
+    }
+    race->onError(std::make_exception_ptr(RequestCancelled(reason)));
+}
+
+void WeatherAPI::finishRace(const std::shared_ptr<RequestRace>& race) {
+    race->callerToken.removeCallback(race->callerRegistration);
+    shutdownToken.removeCallback(race->shutdownRegistration);
+    TimerQueue::TimerId deadlineTimer;
+    TimerQueue::TimerId hedgeTimer;
+    {
+        std::lock_guard<std::mutex> lock(race->mutex);
+        race->limiterTickets.clear();
+        race->executorTickets.clear();
+        deadlineTimer = race->deadlineTimer;
+        hedgeTimer = race->hedgeTimer;
+    }
+
+    // Neither may fire into a finished race nor keep it alive until it would have
+    timers.cancel(deadlineTimer);
+    timers.cancel(hedgeTimer);
+    finishRequest();
+}
+
+void WeatherAPI::launchAttempt(const std::shared_ptr<RequestRace>& race, bool hedge) {
+    bool answered;
+    bool done;
+    RequestPriority priority;
+    {
+        std::lock_guard<std::mutex> lock(race->mutex);
+        answered = race->completed;
+        done = answered && --race->outstanding == 0;
+        if (!answered) {
+            race->attempts++;
+        }
+        priority = race->priority;
+    }
+    if (answered) {
+        // Cancelled while a retry was scheduled
+        if (done) {
+            finishRace(race);
+        }
+        return;
+    }
+
+    // Wait for a token without holding an executor thread, then run on the executor
+    std::string bucket = currentApiKey() + "|" + race->endpoint;
+    RateLimiter::Ticket waiting = rateLimiter.acquire(bucket, priority, [this, race, hedge](bool granted) {
+        if (!granted) {
+            attemptFailed(race, std::make_exception_ptr(RequestCancelled(CancelReason::Cancelled)));
+            return;
+        }
+
+        RequestPriority priority;
+        {
+            std::lock_guard<std::mutex> lock(race->mutex);
+            priority = race->priority;
+        }
+        try {
+            ThreadPool::Ticket queued = executor->postPromotable([this, race, hedge]() { runAttempt(race, hedge); }, priority);
+            std::lock_guard<std::mutex> lock(race->mutex);
+            if (race->priority < priority) {
+                executor->promote(queued, race->priority);
+            }
+            race->executorTickets.push_back(std::move(queued));
+        }
+        catch (...) {
+            attemptFailed(race, std::current_exception());
+        }
+        });
+
+    // A promotion that came while the ticket was being issued didn't see it, so apply it here
+    if (waiting) {
+        std::lock_guard<std::mutex> lock(race->mutex);
+        if (race->priority < priority && !rateLimiter.promote(waiting, race->priority)) {
+            return;
+        }
+        race->limiterTickets.push_back(std::move(waiting));
+    }
+}
+
+void WeatherAPI::runAttempt(const std::shared_ptr<RequestRace>& race, bool hedge) {
+    RetryPolicy policy;
+    TimeoutPolicy timeouts;
+    {
+        std::lock_guard<std::mutex> lock(policyMutex);
+        policy = retryPolicy;
+        timeouts = timeoutPolicy;
+    }
+
+    bool answered;
+    bool done;
+    bool armDeadline;
+    {
+        std::lock_guard<std::mutex> lock(race->mutex);
+        answered = race->completed;
+        done = answered && --race->outstanding == 0;
+        armDeadline = !answered && !race->deadlineArmed;
+        race->deadlineArmed = race->deadlineArmed || armDeadline;
+    }
+    if (answered) {
+        // Another attempt answered, or the request was cancelled, while this one waited
+        if (done) {
+            finishRace(race);
+        }
+        return;
+    }
+
+    // The total budget starts with the first attempt, so time spent queued in the
+    // rate limiter doesn't count against it
+    if (armDeadline) {
+        TimerQueue::TimerId deadlineTimer = timers.schedule(timeouts.totalTimeout,
+            [raceToken = race->token]() { raceToken.cancel(CancelReason::TimedOut); });
+        std::lock_guard<std::mutex> lock(race->mutex);
+        race->deadlineTimer = deadlineTimer;
+    }
+
+    // Hedge once the first attempt runs longer than the endpoint's usual p95
+    auto p95 = std::chrono::duration_cast<std::chrono::milliseconds>(latencies.percentile(race->endpoint, 0.95));
+    if (!hedge && policy.hedgeRequests && p95.count() > 0) {
+        TimerQueue::TimerId hedgeTimer = timers.schedule(std::max(p95, policy.minHedgeDelay), [this, race, policy]() {
+            {
+                std::lock_guard<std::mutex> lock(race->mutex);
+                if (race->completed || race->outstanding != 1 || race->attempts >= policy.maxAttempts || !isRunning.load()) {
+                    return;
+                }
+                race->outstanding++;
+            }
+            {
+                std::lock_guard<std::mutex> lock(policyMutex);
+                requestStats.hedges++;
+            }
+            launchAttempt(race, true);
+            });
+
+        // A retry replaces the hedge of the attempt it follows, which would otherwise hedge it early
+        TimerQueue::TimerId previous;
+        {
+            std::lock_guard<std::mutex> lock(race->mutex);
+            previous = std::exchange(race->hedgeTimer, hedgeTimer);
+        }
+        timers.cancel(previous);
+    }
+
+    // The attempt completes on this thread with a blocking transport, or later on the
+    // transport's I/O thread; either way it is reported exactly once
+    auto start = std::chrono::steady_clock::now();
+    auto reported = std::make_shared<std::atomic<bool>>(false);
+    auto finished = [this, race, hedge, start, reported](bool won, std::exception_ptr error) {
+        if (reported->exchange(true)) {
+            return;
+        }
+        if (error) {
+            attemptFailed(race, error);
+            return;
+        }
+        latencies.record(race->endpoint,
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start));
+        attemptSucceeded(race, hedge, won);
+    };
+
+    try {
+        race->attempt(*race, race->token, finished);
+    }
+    catch (...) {
+        finished(false, std::current_exception());
+    }
+}
+
+void WeatherAPI::attemptSucceeded(const std::shared_ptr<RequestRace>& race, bool hedge, bool won) {
+    bool done;
+    {
+        std::lock_guard<std::mutex> lock(race->mutex);
+        done = --race->outstanding == 0;
+    }
+    if (hedge && won) {
+        std::lock_guard<std::mutex> lock(policyMutex);
+        requestStats.hedgeWins++;
+    }
+    if (done) {
+        finishRace(race);
+    }
+}
+
+void WeatherAPI::attemptFailed(const std::shared_ptr<RequestRace>& race, std::exception_ptr error) {
+    RetryPolicy policy;
+    {
+        std::lock_guard<std::mutex> lock(policyMutex);
+        policy = retryPolicy;
+    }
+
+    bool retry = false;
+    bool fail = false;
+    bool done = false;
+    int attempt;
+    {
+        std::lock_guard<std::mutex> lock(race->mutex);
+        race->outstanding--;
+        attempt = race->attempts;
+        if (race->completed || race->outstanding > 0) {
+            // Already answered, or a hedged attempt is still running and may succeed
+            done = race->outstanding == 0;
+        }
+        else if (isTransientError(error) && race->attempts < policy.maxAttempts && isRunning.load()) {
+            race->outstanding++;
+            retry = true;
+        }
+        else {
+            race->completed = true;
+            fail = true;
+            done = true;
+        }
+    }
+
+    if (retry) {
+        {
+            std::lock_guard<std::mutex> lock(policyMutex);
+            requestStats.retries++;
+        }
+        timers.schedule(backoffDelay(policy, attempt, error), [this, race]() { launchAttempt(race, false); });
+        return;
+    }
+    if (fail) {
+        if (attempt > 1) {
+            std::lock_guard<std::mutex> lock(policyMutex);
+            requestStats.exhausted++;
+        }
+        race->onError(error);
+    }
+    if (done) {
+        finishRace(race);
+    }
+}
+
+void WeatherAPI::configureConnectionPool(size_t maxConnectionsPerHost, std::chrono::seconds idleTimeout) {
+    transport->configure(maxConnectionsPerHost, idleTimeout);
+}
+
+HttpPoolStats WeatherAPI::getPoolStats() const {
+    return transport->getStats();
+}
+
+void WeatherAPI::configureResponseCache(size_t maxEntries, std::chrono::seconds defaultMaxAge, const std::string& spillDirectory) {
+    responseCache.configure(maxEntries, defaultMaxAge, spillDirectory);
+}
+
+HttpCacheStats WeatherAPI::getCacheStats() const {
+    return responseCache.getStats();
+}
+
+void WeatherAPI::configureRateLimit(double requestsPerMinute, double burst) {
+    rateLimiter.configure(requestsPerMinute, burst);
+}
+
+RateLimiterStats WeatherAPI::getRateLimiterStats() const {
+    return rateLimiter.getStats();
+}
+
+void WeatherAPI::configureRetryPolicy(const RetryPolicy& policy) {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    retryPolicy = policy;
+    retryPolicy.maxAttempts = std::max(1, policy.maxAttempts);
+}
+
+void WeatherAPI::configureTimeouts(const TimeoutPolicy& policy) {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    timeoutPolicy = policy;
+}
+
+RequestStats WeatherAPI::getRequestStats() const {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    return requestStats;
+}
+
+unsigned long long WeatherAPI::getCoalescedRequestCount() const {
+    return currentFlights.getCoalescedCount() + forecastFlights.getCoalescedCount();
 }
 
 // Encode URL to handle spaces and special characters
@@ -36,163 +556,587 @@ std::string encodeURL(const std::string& input) {
     return result;
 }
 
-WeatherInfo WeatherAPI::parseCurrentWeatherJson(const json& data) {
-    WeatherInfo info;
+// Normalize a city name so "Tel  Aviv " and "tel aviv" map to the same request
+static std::string normalizeCityKey(const std::string& cityName) {
+    std::string key;
+    key.reserve(cityName.size());
+    bool pendingSpace = false;
+    for (unsigned char c : cityName) {
+        if (std::isspace(c)) {
+            pendingSpace = !key.empty();
+            continue;
+        }
+        if (pendingSpace) {
+            key.push_back(' ');
+            pendingSpace = false;
+        }
+        key.push_back(static_cast<char>(std::tolower(c)));
+    }
+    return key;
+}
+
+// Format the current local time for WeatherInfo::lastUpdated
+static std::string currentTimestamp() {
+    auto now = std::chrono::system_clock::now();
+    auto time_t_now = std::chrono::system_clock::to_time_t(now);
+    std::stringstream ss;
+    ss << std::put_time(std::localtime(&time_t_now), "%Y-%m-%d %H:%M:%S");
+    return ss.str();
+}
 
-    info.cityName = data["name"].get<std::string>();
-    info.countryCode = data["sys"]["country"].get<std::string>();
+// The API key is left out of cache keys so rotating it keeps the cached responses
+static std::string cacheKeyFor(const std::string& path) {
+    std::string key = path;
+    auto start = key.find("appid=");
+    if (start != std::string::npos) {
+        auto end = key.find('&', start);
+        key.erase(start, end == std::string::npos ? std::string::npos : end - start + 1);
+    }
+    return key;
+}
 
-    // Temperature is already in Celsius because we use units=metric
-    info.temperature = data["main"]["temp"].get<double>();
-    info.feelsLike = data["main"]["feels_like"].get<double>();
-    info.tempMin = data["main"]["temp_min"].get<double>();
-    info.tempMax = data["main"]["temp_max"].get<double>();
-    info.pressure = data["main"]["pressure"].get<double>();
-    info.humidity = data["main"]["humidity"].get<double>();
+// Delay requested by a Retry-After header in seconds; the HTTP-date form is ignored
+static std::chrono::seconds retryAfterOf(const httplib::Headers& headers) {
+    auto it = headers.find("Retry-After");
+    if (it == headers.end()) {
+        return std::chrono::seconds(0);
+    }
+    return std::chrono::seconds(std::max(0LL, std::atoll(it->second.c_str())));
+}
 
-    if (!data["wind"].is_null()) {
-        info.windSpeed = data["wind"]["speed"].get<double>();
-        info.windDeg = data["wind"]["deg"].get<double>();
+HttpTransport::Request WeatherAPI::makeRequest(const std::string& path, const httplib::Headers& headers,
+    const CancellationToken& token) const {
+    HttpTransport::Request request;
+    request.path = path;
+    request.headers = headers;
+    request.token = token;
+    if (*ContentDecoder::acceptEncoding()) {
+        request.headers.emplace("Accept-Encoding", ContentDecoder::acceptEncoding());
     }
+    std::lock_guard<std::mutex> lock(policyMutex);
+    request.host = baseUrl;
+    request.timeouts = timeoutPolicy;
+    return request;
+}
 
-    if (!data["weather"].empty()) {
-        info.weatherMain = data["weather"][0]["main"].get<std::string>();
-        info.weatherDescription = data["weather"][0]["description"].get<std::string>();
-        info.weatherIcon = data["weather"][0]["icon"].get<std::string>();
+void WeatherAPI::getJson(const std::string& path, const httplib::Headers& requestHeaders, std::shared_ptr<JsonStreamHandler> handler,
+    const std::string& errorContext, std::string* bodyCopy, const CancellationToken& token, ResultCallback<JsonResponse> done) {
+    if (token.isCancelled()) {
+        throw RequestCancelled(token.getReason());
     }
 
-    info.sunrise = data["sys"]["sunrise"].get<long long>();
-    info.sunset = data["sys"]["sunset"].get<long long>();
+    // Parse the body while it downloads (and decompresses) instead of buffering it and building a DOM
+    struct Transfer {
+        JsonResponse response{ 0, {}, 0 };
+        std::unique_ptr<ContentDecoder> decoder;
+        size_t wireBytes = 0;
+    };
+    auto reader = std::make_shared<JsonStreamReader>(*handler);
+    auto transfer = std::make_shared<Transfer>();
+    bool conditional = !requestHeaders.empty();
 
-    // Format current time as string
-    auto now = std::chrono::system_clock::now();
-    auto time_t_now = std::chrono::system_clock::to_time_t(now);
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&time_t_now), "%Y-%m-%d %H:%M:%S");
-    info.lastUpdated = ss.str();
+    transport->get(makeRequest(path, requestHeaders, token),
+        [transfer](const HttpTransport::Response& head) {
+            transfer->response.status = head.status;
+            auto encoding = head.headers.find("Content-Encoding");
+            transfer->decoder = std::make_unique<ContentDecoder>(encoding == head.headers.end() ? "" : encoding->second);
+            return true;
+        },
+        [transfer, reader, bodyCopy](const char* data, size_t length) {
+            // Error bodies are drained but not parsed
+            if (transfer->response.status != 200) {
+                return true;
+            }
+            transfer->wireBytes += length;
+            return transfer->decoder->feed(data, length, [transfer, reader, bodyCopy](const char* decoded, size_t decodedLength) {
+                transfer->response.bodyBytes += decodedLength;
+                if (bodyCopy) {
+                    bodyCopy->append(decoded, decodedLength);
+                }
+                return reader->feed(decoded, decodedLength);
+                });
+        },
+        [this, handler, reader, transfer, conditional, errorContext, token, done](HttpTransport::Response result) {
+            if (token.isCancelled()) {
+                // The transfer may have been aborted mid-request
+                done(nullptr, std::make_exception_ptr(RequestCancelled(token.getReason())));
+                return;
+            }
+            JsonResponse* response = &transfer->response;
+            response->status = result.status;
+            response->headers = std::move(result.headers);
 
-    return info;
+            // 304 answers a conditional request and has no body to parse
+            if (result.status == 304 && conditional) {
+                done(response, nullptr);
+                return;
+            }
+            bool decoded = transfer->decoder && transfer->decoder->finish();
+            if (result.status == 200 && decoded) {
+                recordTransfer(*transfer->decoder, transfer->wireBytes, response->bodyBytes);
+            }
+            if (result.status == 200 && decoded && reader->finish()) {
+                done(response, nullptr);
+                return;
+            }
+
+            std::string errorMsg = errorContext;
+            if (transfer->decoder && transfer->decoder->hasFailed()) {
+                errorMsg += ": " + transfer->decoder->getError();
+            }
+            else if (reader->hasFailed()) {
+                errorMsg += ": " + reader->getError();
+            }
+            else if (result.status != 0) {
+                errorMsg += ": " + std::to_string(result.status);
+            }
+            else {
+                errorMsg += ": " + result.error;
+            }
+            done(nullptr, std::make_exception_ptr(ApiError(errorMsg, result.status, retryAfterOf(response->headers))));
+        });
 }
 
-std::vector<ForecastInfo> WeatherAPI::parseForecastJson(const json& data) {
-    std::vector<ForecastInfo> forecastList;
+void WeatherAPI::recordTransfer(const ContentDecoder& decoder, size_t wireBytes, size_t decodedBytes) {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    transferStats.responses++;
+    if (decoder.isCompressed()) {
+        transferStats.compressedResponses++;
+    }
+    transferStats.wireBytes += wireBytes;
+    transferStats.decodedBytes += decodedBytes;
+}
 
-    for (const auto& item : data["list"]) {
-        ForecastInfo forecast;
+TransferStats WeatherAPI::getTransferStats() const {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    return transferStats;
+}
 
-        forecast.dateTime = item["dt"].get<long long>();
-        // Already in Celsius because of units=metric
-        forecast.temperature = item["main"]["temp"].get<double>();
-        forecast.feelsLike = item["main"]["feels_like"].get<double>();
-        forecast.tempMin = item["main"]["temp_min"].get<double>();
-        forecast.tempMax = item["main"]["temp_max"].get<double>();
-        forecast.pressure = item["main"]["pressure"].get<double>();
-        forecast.humidity = item["main"]["humidity"].get<double>();
+template<class Record, class Schema>
+static std::vector<Record> parseRecords(const std::string& body, RecordLayout layout, const std::string& errorContext) {
+    std::vector<Record> records;
+    SchemaHandler<Record, Schema> handler(records, layout);
+    JsonStreamReader reader(handler);
+    if (!reader.feed(body.data(), body.size()) || !reader.finish()) {
+        throw std::runtime_error(errorContext + ": " + reader.getError());
+    }
+    return records;
+}
 
-        if (!item["wind"].is_null()) {
-            forecast.windSpeed = item["wind"]["speed"].get<double>();
-            forecast.windDeg = item["wind"]["deg"].get<double>();
-        }
+template<class Record, class Schema>
+void WeatherAPI::getCachedRecords(const std::string& path, RecordLayout layout, const std::string& errorContext,
+    const CancellationToken& token, ResultCallback<std::vector<Record>> done) {
+    // Responses of different servers never stand in for each other
+    std::string key = currentBaseUrl() + cacheKeyFor(path);
+    HttpCache::Lookup cached = responseCache.lookup(key);
 
-        if (!item["weather"].empty()) {
-            forecast.weatherMain = item["weather"][0]["main"].get<std::string>();
-            forecast.weatherDescription = item["weather"][0]["description"].get<std::string>();
-            forecast.weatherIcon = item["weather"][0]["icon"].get<std::string>();
+    if (cached.found && cached.fresh) {
+        std::vector<Record> records;
+        if (cached.decoded.has_value()) {
+            records = std::any_cast<std::vector<Record>>(cached.decoded);
         }
+        else {
+            // Entry read back from disk - parse it once and keep the result in memory
+            records = parseRecords<Record, Schema>(cached.body, layout, errorContext);
+            responseCache.attachDecoded(key, records);
+        }
+        done(&records, nullptr);
+        return;
+    }
+
+    struct Download {
+        std::vector<Record> records;
+        SchemaHandler<Record, Schema> handler;
+        std::string body;
+
+        explicit Download(RecordLayout layout) : handler(records, layout) {}
+    };
 
-        forecastList.push_back(forecast);
+    auto download = std::make_shared<Download>(layout);
+    std::string* bodyCopy = responseCache.keepsBodies() ? &download->body : nullptr;
+    std::shared_ptr<JsonStreamHandler> handler(download, &download->handler);
+
+    getJson(path, cached.validators, handler, errorContext, bodyCopy, token,
+        [this, path, key, layout, errorContext, token, download, cachedBody = std::move(cached.body), done](
+            const JsonResponse* response, std::exception_ptr error) {
+            if (!response) {
+                done(nullptr, error);
+                return;
+            }
+
+            std::vector<Record> records;
+            bool evicted = false;
+            try {
+                if (response->status == 304) {
+                    std::any decoded = responseCache.revalidated(key, response->headers);
+                    if (decoded.has_value()) {
+                        records = std::any_cast<std::vector<Record>>(decoded);
+                    }
+                    else if (!cachedBody.empty()) {
+                        records = parseRecords<Record, Schema>(cachedBody, layout, errorContext);
+                        responseCache.attachDecoded(key, records);
+                    }
+                    else {
+                        evicted = true;
+                    }
+                }
+                else {
+                    responseCache.store(key, response->headers, download->records, response->bodyBytes, std::move(download->body));
+                    records = std::move(download->records);
+                }
+            }
+            catch (...) {
+                done(nullptr, std::current_exception());
+                return;
+            }
+
+            if (evicted) {
+                // The entry was evicted while the request was in flight, fetch it in full
+                try {
+                    getCachedRecords<Record, Schema>(path, layout, errorContext, token, done);
+                }
+                catch (...) {
+                    done(nullptr, std::current_exception());
+                }
+                return;
+            }
+            done(&records, nullptr);
+        });
+}
+
+void WeatherAPI::fetchCurrentWeather(const std::string& cityName, const CancellationToken& token, ResultCallback<WeatherInfo> done) {
+    if (!isRunning.load()) {
+        throw std::runtime_error("API operation canceled");
     }
 
-    return forecastList;
+    // Properly encode the city name
+    std::string encodedCity = encodeURL(cityName);
+
+    // Use units=metric to get Celsius temperatures
+    std::string path = "/data/2.5/weather?q=" + encodedCity + "&appid=" + currentApiKey() + "&units=metric";
+
+    getCachedRecords<WeatherInfo, CurrentWeatherSchema>(path, RecordLayout::Document, "Failed to get weather data", token,
+        [this, cityName, done](const std::vector<WeatherInfo>* weather, std::exception_ptr error) {
+            if (!weather) {
+                done(nullptr, error);
+                return;
+            }
+            if (weather->empty()) {
+                done(nullptr, std::make_exception_ptr(std::runtime_error("Failed to get weather data: empty response")));
+                return;
+            }
+
+            WeatherInfo info = weather->front();
+            info.lastUpdated = currentTimestamp();
+            rememberCityId(cityName, info);
+            done(&info, nullptr);
+        });
 }
 
-std::future<WeatherInfo> WeatherAPI::getCurrentWeather(const std::string& cityName) {
-    return std::async(std::launch::async, [this, cityName]() {
-        if (!isRunning.load()) {
-            throw std::runtime_error("API operation canceled");
-        }
+void WeatherAPI::fetchForecast(const std::string& cityName, int days, const CancellationToken& token,
+    ResultCallback<std::vector<ForecastInfo>> done) {
+    if (!isRunning.load()) {
+        throw std::runtime_error("API operation canceled");
+    }
+
+    // Properly encode the city name
+    std::string encodedCity = encodeURL(cityName);
 
-        // Properly encode the city name
-        std::string encodedCity = encodeURL(cityName);
+    // Use units=metric to get Celsius temperatures
+    std::string path = "/data/2.5/forecast?q=" + encodedCity + "&cnt=" + std::to_string(days * 8) + "&appid=" + currentApiKey() + "&units=metric";
+
+    getCachedRecords<ForecastInfo, ForecastSchema>(path, RecordLayout::ListItems, "Failed to get forecast data", token, std::move(done));
+}
 
-        httplib::Client cli(baseUrl);
-        // Use units=metric to get Celsius temperatures
-        std::string path = "/data/2.5/weather?q=" + encodedCity + "&appid=" + apiKey + "&units=metric";
+void WeatherAPI::fetchGroup(const std::vector<long long>& ids, const CancellationToken& token, ResultCallback<std::vector<WeatherInfo>> done) {
+    if (!isRunning.load()) {
+        throw std::runtime_error("API operation canceled");
+    }
 
-        auto res = cli.Get(path.c_str());
-        if (res && res->status == 200) {
-            json data = json::parse(res->body);
-            return parseCurrentWeatherJson(data);
+    std::string idList;
+    for (long long id : ids) {
+        if (!idList.empty()) {
+            idList += ",";
         }
-        else {
-            std::string errorMsg = "Failed to get weather data";
-            if (res) {
-                errorMsg += ": " + std::to_string(res->status);
+        idList += std::to_string(id);
+    }
+
+    std::string path = "/data/2.5/group?id=" + idList + "&appid=" + currentApiKey() + "&units=metric";
+
+    getCachedRecords<WeatherInfo, CurrentWeatherSchema>(path, RecordLayout::ListItems, "Failed to get group weather data", token,
+        [done](const std::vector<WeatherInfo>* weather, std::exception_ptr error) {
+            if (!weather) {
+                done(nullptr, error);
+                return;
             }
-            throw std::runtime_error(errorMsg);
-        }
+
+            std::vector<WeatherInfo> stamped = *weather;
+            std::string lastUpdated = currentTimestamp();
+            for (auto& info : stamped) {
+                info.lastUpdated = lastUpdated;
+            }
+            done(&stamped, nullptr);
         });
 }
 
-std::future<std::vector<ForecastInfo>> WeatherAPI::getForecast(const std::string& cityName, int days) {
-    return std::async(std::launch::async, [this, cityName, days]() {
-        if (!isRunning.load()) {
-            throw std::runtime_error("API operation canceled");
-        }
+void WeatherAPI::fetchCitySearch(const std::string& query, const CancellationToken& token, ResultCallback<std::vector<std::string>> done) {
+    if (!isRunning.load()) {
+        throw std::runtime_error("API operation canceled");
+    }
+
+    // Properly encode the query
+    std::string encodedQuery = encodeURL(query);
+    std::string path = "/geo/1.0/direct?q=" + encodedQuery + "&limit=5&appid=" + currentApiKey();
+
+    struct Transfer {
+        std::string body;
+        std::unique_ptr<ContentDecoder> decoder;
+        size_t wireBytes = 0;
+    };
+    auto transfer = std::make_shared<Transfer>();
+    transport->get(makeRequest(path, {}, token),
+        [transfer](const HttpTransport::Response& head) {
+            auto encoding = head.headers.find("Content-Encoding");
+            transfer->decoder = std::make_unique<ContentDecoder>(encoding == head.headers.end() ? "" : encoding->second);
+            return true;
+        },
+        [transfer](const char* data, size_t length) {
+            transfer->wireBytes += length;
+            return transfer->decoder->feed(data, length, [transfer](const char* decoded, size_t decodedLength) {
+                transfer->body.append(decoded, decodedLength);
+                return true;
+                });
+        },
+        [this, transfer, token, done](HttpTransport::Response res) {
+            if (token.isCancelled()) {
+                done(nullptr, std::make_exception_ptr(RequestCancelled(token.getReason())));
+                return;
+            }
+            bool decoded = transfer->decoder && transfer->decoder->finish();
+            if (res.status != 200 || !decoded) {
+                std::string errorMsg = "Failed to search cities";
+                if (res.status == 200 && transfer->decoder) {
+                    errorMsg += ": " + transfer->decoder->getError();
+                }
+                else if (res.status != 0) {
+                    errorMsg += ": " + std::to_string(res.status);
+                }
+                done(nullptr, std::make_exception_ptr(ApiError(errorMsg, res.status, retryAfterOf(res.headers))));
+                return;
+            }
+            recordTransfer(*transfer->decoder, transfer->wireBytes, transfer->body.size());
+
+            std::vector<std::string> cities;
+            try {
+                json data = json::parse(transfer->body);
+                for (const auto& city : data) {
+                    std::string cityName = city["name"].get<std::string>();
+                    std::string country = city["country"].get<std::string>();
+                    cities.push_back(cityName + ", " + country);
+                }
+            }
+            catch (...) {
+                done(nullptr, std::current_exception());
+                return;
+            }
+            done(&cities, nullptr);
+        });
+}
 
-        // Properly encode the city name
-        std::string encodedCity = encodeURL(cityName);
+void WeatherAPI::rememberCityId(const std::string& cityName, const WeatherInfo& info) {
+    if (info.cityId == 0) {
+        return;
+    }
 
-        httplib::Client cli(baseUrl);
-        // Use units=metric to get Celsius temperatures
-        std::string path = "/data/2.5/forecast?q=" + encodedCity + "&cnt=" + std::to_string(days * 8) + "&appid=" + apiKey + "&units=metric";
+    // Remember both the name that was asked for and the provider's spelling
+    std::lock_guard<std::mutex> lock(cityIdMutex);
+    cityIds[normalizeCityKey(cityName)] = info.cityId;
+    cityIds[normalizeCityKey(info.cityName)] = info.cityId;
+}
 
-        auto res = cli.Get(path.c_str());
-        if (res && res->status == 200) {
-            json data = json::parse(res->body);
-            return parseForecastJson(data);
+// Adapters from a result callback to a promise or a coroutine result
+template<class T>
+static std::function<void(const T*, std::exception_ptr)> completePromise(std::shared_ptr<Promise<T>> promise) {
+    return [promise](const T* value, std::exception_ptr error) {
+        if (value) {
+            promise->setValue(*value);
         }
         else {
-            std::string errorMsg = "Failed to get forecast data";
-            if (res) {
-                errorMsg += ": " + std::to_string(res->status);
-            }
-            throw std::runtime_error(errorMsg);
+            promise->setException(error);
         }
-        });
+    };
 }
 
-std::future<std::vector<std::string>> WeatherAPI::searchCity(const std::string& query) {
-    return std::async(std::launch::async, [this, query]() {
-        if (!isRunning.load()) {
-            throw std::runtime_error("API operation canceled");
+template<class T>
+static std::function<void(const T*, std::exception_ptr)> completeAsync(AsyncResult<T> result) {
+    return [result](const T* value, std::exception_ptr error) {
+        if (value) {
+            result.setValue(*value);
+        }
+        else {
+            result.setException(error);
         }
+    };
+}
 
-        // Properly encode the query
-        std::string encodedQuery = encodeURL(query);
+void WeatherAPI::requestCurrentWeather(const std::string& cityName, RequestPriority priority, const CancellationToken& token,
+    ResultCallback<WeatherInfo> done) {
+    std::string key = normalizeCityKey(cityName);
+    unsigned long long flight = currentFlights.join(key, priority, token, std::move(done));
+    if (flight == 0) {
+        // Same city already being fetched, share its result; a more urgent caller promotes it
+        return;
+    }
 
-        httplib::Client cli(baseUrl);
-        std::string path = "/geo/1.0/direct?q=" + encodedQuery + "&limit=5&appid=" + apiKey;
+    launchFlight<WeatherInfo>(currentFlights, key, flight, "weather",
+        [this, cityName](const CancellationToken& attemptToken, ResultCallback<WeatherInfo> fetched) {
+            fetchCurrentWeather(cityName, attemptToken, std::move(fetched));
+        });
+}
 
-        auto res = cli.Get(path.c_str());
-        if (res && res->status == 200) {
-            json data = json::parse(res->body);
-            std::vector<std::string> cities;
+Future<WeatherInfo> WeatherAPI::getCurrentWeather(const std::string& cityName, RequestPriority priority,
+    const CancellationToken& token) {
+    auto promise = std::make_shared<Promise<WeatherInfo>>();
+    auto result = promise->getFuture();
+    requestCurrentWeather(cityName, priority, token, completePromise(promise));
+    return result;
+}
 
-            for (const auto& city : data) {
-                std::string cityName = city["name"].get<std::string>();
-                std::string country = city["country"].get<std::string>();
-                cities.push_back(cityName + ", " + country);
-            }
+AsyncResult<WeatherInfo> WeatherAPI::awaitCurrentWeather(const std::string& cityName, RequestPriority priority,
+    const CancellationToken& token) {
+    AsyncResult<WeatherInfo> result;
+    requestCurrentWeather(cityName, priority, token, completeAsync(result));
+    return result;
+}
 
-            return cities;
+Future<WeatherBatch> WeatherAPI::getCurrentWeatherBatch(const std::vector<std::string>& cityNames,
+    RequestPriority priority, const CancellationToken& token) {
+    // Split the cities into known provider IDs and names that still need resolving
+    std::vector<long long> ids;
+    std::vector<std::string> idNames;   // The name each ID was asked for, to report failures by
+    std::vector<std::string> unresolved;
+    {
+        std::lock_guard<std::mutex> lock(cityIdMutex);
+        for (const auto& cityName : cityNames) {
+            auto it = cityIds.find(normalizeCityKey(cityName));
+            if (it == cityIds.end()) {
+                unresolved.push_back(cityName);
+            }
+            else if (std::find(ids.begin(), ids.end(), it->second) == ids.end()) {
+                ids.push_back(it->second);
+                idNames.push_back(cityName);
+            }
         }
-        else {
-            std::string errorMsg = "Failed to search cities";
-            if (res) {
-                errorMsg += ": " + std::to_string(res->status);
+    }
+
+    struct BatchState {
+        std::mutex mutex;
+        WeatherBatch batch;
+        size_t pending = 0;
+        Promise<WeatherBatch> promise;
+
+        void complete(std::vector<WeatherInfo>&& part, const std::vector<std::string>& cities, std::exception_ptr error) {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::move(part.begin(), part.end(), std::back_inserter(batch.weather));
+            if (error) {
+                batch.failures.push_back({ cities, error });
+            }
+            if (--pending == 0) {
+                if (batch.weather.empty() && !batch.failures.empty()) {
+                    promise.setException(batch.failures.front().error);
+                }
+                else {
+                    promise.setValue(std::move(batch));
+                }
             }
-            throw std::runtime_error(errorMsg);
         }
+    };
+
+    auto state = std::make_shared<BatchState>();
+    auto result = state->promise.getFuture();
+    state->pending = unresolved.size() + (ids.size() + kMaxGroupSize - 1) / kMaxGroupSize;
+    if (state->pending == 0) {
+        state->promise.setValue({});
+        return result;
+    }
+
+    auto submitPart = [this, state, priority, token](const char* endpoint, std::vector<std::string> cities,
+        std::function<void(const CancellationToken&, ResultCallback<std::vector<WeatherInfo>>)> fetch) {
+        startRequest<std::vector<WeatherInfo>>(createRace(endpoint, priority, token), std::move(fetch),
+            [state](std::vector<WeatherInfo> part) { state->complete(std::move(part), {}, nullptr); },
+            [state, cities](std::exception_ptr error) { state->complete({}, cities, error); });
+    };
+
+    for (size_t start = 0; start < ids.size(); start += kMaxGroupSize) {
+        size_t end = std::min(ids.size(), start + kMaxGroupSize);
+        std::vector<long long> chunk(ids.begin() + start, ids.begin() + end);
+        submitPart("group", std::vector<std::string>(idNames.begin() + start, idNames.begin() + end), [this, chunk](const CancellationToken& attemptToken, ResultCallback<std::vector<WeatherInfo>> done) {
+            fetchGroup(chunk, attemptToken, std::move(done));
+            });
+    }
+
+    // Unknown names cost one request each, after which their IDs are cached; a
+    // name already being fetched on its own joins that request instead
+    for (const auto& cityName : unresolved) {
+        requestCurrentWeather(cityName, priority, token, [state, cityName](const WeatherInfo* info, std::exception_ptr error) {
+            if (!info) {
+                state->complete({}, { cityName }, error);
+                return;
+            }
+            state->complete({ *info }, {}, nullptr);
+            });
+    }
+
+    return result;
+}
+
+void WeatherAPI::requestForecast(const std::string& cityName, int days, RequestPriority priority, const CancellationToken& token,
+    ResultCallback<std::vector<ForecastInfo>> done) {
+    std::string key = normalizeCityKey(cityName) + "|" + std::to_string(days);
+    unsigned long long flight = forecastFlights.join(key, priority, token, std::move(done));
+    if (flight == 0) {
+        return;
+    }
+
+    launchFlight<std::vector<ForecastInfo>>(forecastFlights, key, flight, "forecast",
+        [this, cityName, days](const CancellationToken& attemptToken, ResultCallback<std::vector<ForecastInfo>> fetched) {
+            fetchForecast(cityName, days, attemptToken, std::move(fetched));
         });
+}
+
+Future<std::vector<ForecastInfo>> WeatherAPI::getForecast(const std::string& cityName, int days, RequestPriority priority,
+    const CancellationToken& token) {
+    auto promise = std::make_shared<Promise<std::vector<ForecastInfo>>>();
+    auto result = promise->getFuture();
+    requestForecast(cityName, days, priority, token, completePromise(promise));
+    return result;
+}
+
+AsyncResult<std::vector<ForecastInfo>> WeatherAPI::awaitForecast(const std::string& cityName, int days, RequestPriority priority,
+    const CancellationToken& token) {
+    AsyncResult<std::vector<ForecastInfo>> result;
+    requestForecast(cityName, days, priority, token, completeAsync(result));
+    return result;
+}
+
+Future<std::vector<std::string>> WeatherAPI::searchCity(const std::string& query, const CancellationToken& token) {
+    auto promise = std::make_shared<Promise<std::vector<std::string>>>();
+    auto result = promise->getFuture();
+    requestSearch(query, token, completePromise(promise));
+    return result;
+}
+
+AsyncResult<std::vector<std::string>> WeatherAPI::awaitSearchCity(const std::string& query, const CancellationToken& token) {
+    AsyncResult<std::vector<std::string>> result;
+    requestSearch(query, token, completeAsync(result));
+    return result;
+}
+
+void WeatherAPI::requestSearch(const std::string& query, const CancellationToken& token, ResultCallback<std::vector<std::string>> done) {
+    startRequest<std::vector<std::string>>(createRace("geo", RequestPriority::Interactive, token),
+        [this, query](const CancellationToken& attemptToken, ResultCallback<std::vector<std::string>> fetched) {
+            fetchCitySearch(query, attemptToken, std::move(fetched));
+        },
+        [done](std::vector<std::string> cities) { done(&cities, nullptr); },
+        [done](std::exception_ptr error) { done(nullptr, error); });
 }
\ No newline at end of file
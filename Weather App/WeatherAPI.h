@@ -1,18 +1,55 @@
-/**
+﻿/**
  * @file WeatherAPI.h
  * @brief Interface for retrieving weather data from API
  */
 #pragma once
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include <future>
 #include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
 #include "WeatherData.h"
+#include "HttpTransport.h"
+#include "HttpCache.h"
+#include "ContentDecoder.h"
+#include "RateLimiter.h"
+#include "RequestPriority.h"
+#include "RetryPolicy.h"
+#include "LatencyTracker.h"
+#include "CancellationToken.h"
+#include "SingleFlight.h"
+#include "AsyncResult.h"
+#include "Future.h"
+#include "JsonStreamReader.h"
+#include "SchemaParser.h"
+#include "ThreadPool.h"
+#include "TimerQueue.h"
 #include "httplib.h"
 #include "json.hpp"
 
 using json = nlohmann::json;
 
+/**
+ * @struct WeatherBatch
+ * @brief Result of WeatherAPI::getCurrentWeatherBatch(): the weather that came back, and what didn't
+ */
+struct WeatherBatch {
+    /**
+     * @brief Cities of one request of the batch that failed, with its error
+     */
+    struct Failure {
+        std::vector<std::string> cities;
+        std::exception_ptr error;
+    };
+
+    std::vector<WeatherInfo> weather;   // Every city that could be fetched
+    std::vector<Failure> failures;      // Empty when every request succeeded
+};
+
 /**
  * @class WeatherAPI
  * @brief Class for interacting with the OpenWeatherMap API
@@ -20,20 +57,237 @@ using json = nlohmann::json;
 class WeatherAPI {
 private:
     std::string apiKey;
-    std::string baseUrl;
+    mutable std::mutex apiKeyMutex;
+    std::string baseUrl;                // Guarded by policyMutex
     std::atomic<bool> isRunning;
+    CancellationToken shutdownToken;    // Cancelled by cancel(), aborts every request
+    std::unique_ptr<HttpTransport> transport;
+    HttpCache responseCache;
+    SingleFlight<WeatherInfo> currentFlights;
+    SingleFlight<std::vector<ForecastInfo>> forecastFlights;
+
+    // Normalized city name -> provider city ID, filled by every current weather response
+    std::unordered_map<std::string, long long> cityIds;
+    mutable std::mutex cityIdMutex;
+
+    // Requests (including pending retries) that still reference this object
+    size_t inFlight;
+    std::mutex inFlightMutex;
+    std::condition_variable inFlightDone;
+
+    RetryPolicy retryPolicy;
+    TimeoutPolicy timeoutPolicy;
+    RequestStats requestStats;
+    TransferStats transferStats;
+    mutable std::mutex policyMutex;
+    LatencyTracker latencies;
+
+    // The timer thread comes first so the limiter is built on a constructed queue;
+    // the destructor stops it before the limiter goes, so no grant fires into a destroyed limiter
+    TimerQueue timers;
+    RateLimiter rateLimiter;
+
+    // Declared last so an owned executor is joined before the members its tasks use
+    std::shared_ptr<ThreadPool> executor;
+
+    struct JsonResponse {
+        int status;
+        httplib::Headers headers;
+        size_t bodyBytes;       // Decoded
+    };
+
+    // Receives a result or, with a null result, the error. Requests complete through
+    // callbacks so an asynchronous transport holds no thread while they wait
+    template<class T>
+    using ResultCallback = std::function<void(const T*, std::exception_ptr)>;
+
+    HttpTransport::Request makeRequest(const std::string& path, const httplib::Headers& headers, const CancellationToken& token) const;
+    void getJson(const std::string& path, const httplib::Headers& requestHeaders, std::shared_ptr<JsonStreamHandler> handler,
+        const std::string& errorContext, std::string* bodyCopy, const CancellationToken& token, ResultCallback<JsonResponse> done);
+
+    template<class Record, class Schema>
+    void getCachedRecords(const std::string& path, RecordLayout layout, const std::string& errorContext,
+        const CancellationToken& token, ResultCallback<std::vector<Record>> done);
+
+    void recordTransfer(const ContentDecoder& decoder, size_t wireBytes, size_t decodedBytes);
+
+    void fetchCurrentWeather(const std::string& cityName, const CancellationToken& token, ResultCallback<WeatherInfo> done);
+    void fetchForecast(const std::string& cityName, int days, const CancellationToken& token, ResultCallback<std::vector<ForecastInfo>> done);
+    void fetchGroup(const std::vector<long long>& ids, const CancellationToken& token, ResultCallback<std::vector<WeatherInfo>> done);
+    void fetchCitySearch(const std::string& query, const CancellationToken& token, ResultCallback<std::vector<std::string>> done);
+    void rememberCityId(const std::string& cityName, const WeatherInfo& info);
+
+    void requestCurrentWeather(const std::string& cityName, RequestPriority priority, const CancellationToken& token,
+        ResultCallback<WeatherInfo> done);
+    void requestForecast(const std::string& cityName, int days, RequestPriority priority, const CancellationToken& token,
+        ResultCallback<std::vector<ForecastInfo>> done);
+    void requestSearch(const std::string& query, const CancellationToken& token, ResultCallback<std::vector<std::string>> done);
 
-    WeatherInfo parseCurrentWeatherJson(const json& json);
-    std::vector<ForecastInfo> parseForecastJson(const json& json);
+    std::string currentApiKey() const;
+    std::string currentBaseUrl() const;
+    void finishRequest();
+
+    // Attempts of one logical request: retries and hedges race, the first success wins
+    struct RequestRace;
+
+    std::shared_ptr<RequestRace> createRace(const char* endpoint, RequestPriority priority, const CancellationToken& token);
+    template<class T>
+    void startRequest(const std::shared_ptr<RequestRace>& race,
+        std::function<void(const CancellationToken&, ResultCallback<T>)> fetch, std::function<void(T)> onValue,
+        std::function<void(std::exception_ptr)> onError);
+    template<class T>
+    void launchFlight(SingleFlight<T>& flights, const std::string& key, unsigned long long flight, const char* endpoint,
+        std::function<void(const CancellationToken&, ResultCallback<T>)> fetch);
+    void promoteRace(const std::shared_ptr<RequestRace>& race, RequestPriority priority);
+    void abortRace(const std::shared_ptr<RequestRace>& race, CancelReason reason);
+    void finishRace(const std::shared_ptr<RequestRace>& race);
+    void launchAttempt(const std::shared_ptr<RequestRace>& race, bool hedge);
+    void runAttempt(const std::shared_ptr<RequestRace>& race, bool hedge);
+    void attemptFailed(const std::shared_ptr<RequestRace>& race, std::exception_ptr error);
+    void attemptSucceeded(const std::shared_ptr<RequestRace>& race, bool hedge, bool won);
 
 public:
-    WeatherAPI(const std::string& apiKey);
+    /**
+     * @brief Default number of I/O threads, matching the default connections per host
+     */
+    static constexpr size_t kDefaultIoThreads = 8;
+
+    /**
+     * @brief Maximum number of city IDs the provider accepts in one group query
+     */
+    static constexpr size_t kMaxGroupSize = 20;
+
+    /**
+     * @brief Host every request goes to unless setBaseUrl() points elsewhere, over TLS when it is compiled in
+     */
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+    static constexpr const char* kDefaultBaseUrl = "https://api.openweathermap.org";
+#else
+    static constexpr const char* kDefaultBaseUrl = "api.openweathermap.org";
+#endif
+
+    /**
+     * @brief Constructor
+     * @param apiKey OpenWeatherMap API key
+     * @param executor Pool the requests are started on (and run on, with a blocking
+     *        transport); a private pool of kDefaultIoThreads workers is created when none is given
+     * @param transport HTTP engine; the epoll engine on Linux and pooled blocking
+     *        clients elsewhere when none is given
+     */
+    WeatherAPI(const std::string& apiKey, std::shared_ptr<ThreadPool> executor = nullptr,
+        std::unique_ptr<HttpTransport> transport = nullptr);
     ~WeatherAPI();
 
-    std::future<WeatherInfo> getCurrentWeather(const std::string& cityName);
-    std::future<std::vector<ForecastInfo>> getForecast(const std::string& cityName, int days = 5);
-    std::future<std::vector<std::string>> searchCity(const std::string& query);
+    /**
+     * @brief The transport used when the constructor is given none, e.g. to wrap in a CassetteRecorder
+     * @param tls Certificate checks of https:// base URLs
+     */
+    static std::unique_ptr<HttpTransport> createDefaultTransport(const TlsOptions& tls = {});
+
+    /**
+     * @brief Fetch the current weather of a city
+     * @param cityName City to fetch
+     * @param priority Rate limiter lane of the request; a call that joins an identical
+     *        request already in flight moves that request up if this one is more urgent
+     * @param token Cancels this call; a request shared with identical calls in flight
+     *        is only cancelled once every one of them is
+     * @return Future for the weather, holding RequestCancelled when cancelled or timed out
+     */
+    Future<WeatherInfo> getCurrentWeather(const std::string& cityName, RequestPriority priority = RequestPriority::Interactive,
+        const CancellationToken& token = CancellationToken());
+
+    /**
+     * @brief Fetch current weather for many cities with as few round trips as possible
+     *
+     * Cities whose provider ID is already known are fetched kMaxGroupSize at a
+     * time through the group endpoint; unknown names are fetched one by one and
+     * their IDs remembered for the next batch. Cities that fail are left out of
+     * the weather and listed with their error among the failures; the future only
+     * holds an error when every city failed.
+     * @param cityNames Cities to fetch
+     * @param priority Rate limiter lane of the requests
+     * @param token Cancels every request of the batch
+     * @return Future for the weather of every city that could be fetched, and the failed requests
+     */
+    Future<WeatherBatch> getCurrentWeatherBatch(const std::vector<std::string>& cityNames,
+        RequestPriority priority = RequestPriority::Interactive, const CancellationToken& token = CancellationToken());
+    Future<std::vector<ForecastInfo>> getForecast(const std::string& cityName, int days = 5,
+        RequestPriority priority = RequestPriority::Interactive, const CancellationToken& token = CancellationToken());
+    Future<std::vector<std::string>> searchCity(const std::string& query, const CancellationToken& token = CancellationToken());
+
+    /**
+     * @brief Coroutine variants of getCurrentWeather(), getForecast() and searchCity()
+     *
+     * The request starts immediately; co_await the result to suspend until it
+     * arrives without blocking a thread. The coroutine resumes on the thread that
+     * completed the request.
+     */
+    AsyncResult<WeatherInfo> awaitCurrentWeather(const std::string& cityName, RequestPriority priority = RequestPriority::Interactive,
+        const CancellationToken& token = CancellationToken());
+    AsyncResult<std::vector<ForecastInfo>> awaitForecast(const std::string& cityName, int days = 5,
+        RequestPriority priority = RequestPriority::Interactive, const CancellationToken& token = CancellationToken());
+    AsyncResult<std::vector<std::string>> awaitSearchCity(const std::string& query, const CancellationToken& token = CancellationToken());
+
+    /**
+     * @brief Abort every request, including HTTP calls blocked on the network
+     */
     void cancel();
     void updateApiKey(const std::string& newApiKey);
 
+    /**
+     * @brief Send later requests to another server, e.g. a local stand-in
+     * @param url Host, host:port or http://host:port
+     */
+    void setBaseUrl(const std::string& url);
+    std::string getBaseUrl() const;
+
+    /**
+     * @brief Configure the keep-alive connection pool used for all requests
+     * @param maxConnectionsPerHost Upper bound on open connections to the API host
+     * @param idleTimeout Idle connections older than this are closed
+     */
+    void configureConnectionPool(size_t maxConnectionsPerHost, std::chrono::seconds idleTimeout);
+    HttpPoolStats getPoolStats() const;
+
+    /**
+     * @brief Configure the response cache used for weather, forecast and group requests
+     * @param maxEntries Responses kept in memory
+     * @param defaultMaxAge Lifetime of responses that carry no Cache-Control max-age
+     * @param spillDirectory Directory for entries evicted from memory; empty disables the spill
+     */
+    void configureResponseCache(size_t maxEntries, std::chrono::seconds defaultMaxAge, const std::string& spillDirectory = "");
+    HttpCacheStats getCacheStats() const;
+
+    /**
+     * @brief Configure the per API key, per endpoint request quota
+     * @param requestsPerMinute Sustained request rate of each endpoint
+     * @param burst Requests an idle endpoint may send at once
+     */
+    void configureRateLimit(double requestsPerMinute, double burst);
+    RateLimiterStats getRateLimiterStats() const;
+
+    /**
+     * @brief Set how failed requests are retried and whether slow ones are hedged
+     */
+    void configureRetryPolicy(const RetryPolicy& policy);
+
+    /**
+     * @brief Set the connect, read and total timeouts of every request
+     */
+    void configureTimeouts(const TimeoutPolicy& policy);
+    RequestStats getRequestStats() const;
+
+    /**
+     * @brief Response body bytes as received against after decompression
+     *
+     * Requests ask for gzip or deflate when the build has zlib; bodies are
+     * decompressed as they arrive, straight into the parsers.
+     */
+    TransferStats getTransferStats() const;
+
+    /**
+     * @brief Number of weather and forecast calls that joined an identical in-flight request
+     */
+    unsigned long long getCoalescedRequestCount() const;
+
 };
\ No newline at end of file
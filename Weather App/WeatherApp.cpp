@@ -7,6 +7,7 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include <GLFW/glfw3.h>
+#include <algorithm>
 #include <chrono>
 #include <ctime>
 #include <sstream>
@@ -14,16 +15,27 @@
 #include <iostream>
 
  // Constructor
-WeatherApp::WeatherApp()
-    : weatherApi("16ba674059f20f1fbb75756ba6397cd9"), // Replace with your actual API key
-    favoriteCities("favorites.txt"),
+WeatherApp::WeatherApp(const std::string& baseUrl, std::unique_ptr<HttpTransport> transport)
+    : cityRegistry(std::make_shared<CityRegistry>()),
+    weatherData(cityRegistry),
+    ioPool(std::make_shared<ThreadPool>(WeatherAPI::kDefaultIoThreads)),
+    weatherApi("16ba674059f20f1fbb75756ba6397cd9", ioPool, std::move(transport)), // Replace with your actual API key
+    favoriteCities("favorites.txt", cityRegistry),
     threadPool(4),
+    scheduler(threadPool),
+    cityListVersion(0),
     window(nullptr),
     isRunning(false),
+    selectedCity(CityRegistry::kNoCity),
     showForecast(false),
     showFavorites(false),
     showAddCityPopup(false),
     showSettingsPopup(false) {
+    // Hedge slow weather requests so one stalled response doesn't hold up a city
+    RetryPolicy retryPolicy;
+    retryPolicy.hedgeRequests = true;
+    weatherApi.configureRetryPolicy(retryPolicy);
+    weatherApi.setBaseUrl(baseUrl);
 }
 
 // Destructor
@@ -163,6 +175,11 @@ void WeatherApp::run() {
 void WeatherApp::shutdown() {
     isRunning.store(false);
 
+    // Abort requests blocked on the network so the pools can join right away. Cancelling fails
+    // every outstanding future on this thread, so their then() continuations are already queued
+    // on threadPool, which runs them before it joins
+    weatherApi.cancel();
+
     // Clean up ImGui resources
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
@@ -178,24 +195,92 @@ void WeatherApp::shutdown() {
 
 // Update weather data
 void WeatherApp::updateWeatherData() {
-    auto cities = weatherData.getAllCities();
-
-    for (const auto& city : cities) {
-        threadPool.enqueue([this, city]() {
+    auto cities = weatherData.getAllCityIds();
+    if (cities.empty()) {
+        return;
+    }
+    std::vector<std::string> cityNames;
+    cityNames.reserve(cities.size());
+    for (CityId city : cities) {
+        cityNames.push_back(cityRegistry->name(city));
+    }
+
+    // Current weather for all cities in a few group requests, handed to each city's
+    // promise once the responses are in. No worker waits for the network.
+    std::vector<Promise<WeatherInfo>> currentPromises(cities.size());
+    std::vector<Future<WeatherInfo>> currentWeather;
+    currentWeather.reserve(cities.size());
+    for (auto& promise : currentPromises) {
+        currentWeather.push_back(promise.getFuture());
+    }
+    weatherApi.getCurrentWeatherBatch(cityNames, RequestPriority::Background).then(threadPool,
+        [this, cities, promises = std::move(currentPromises)](Future<WeatherBatch> weather) mutable {
+            std::vector<bool> settled(cities.size(), false);
+            auto settle = [&](CityId city, auto&& complete) {
+                auto it = std::find(cities.begin(), cities.end(), city);
+                size_t index = static_cast<size_t>(it - cities.begin());
+                if (it != cities.end() && !settled[index]) {
+                    settled[index] = true;
+                    complete(promises[index]);
+                }
+            };
+
+            std::exception_ptr batchError;
             try {
-                auto weatherFuture = weatherApi.getCurrentWeather(city);
-                auto forecastFuture = weatherApi.getForecast(city);
-
-                auto weather = weatherFuture.get();
-                auto forecast = forecastFuture.get();
-
-                weatherData.updateCurrentWeather(weather);
-                weatherData.updateForecast(city, forecast);
+                WeatherBatch batch = weather.get();
+                for (auto& info : batch.weather) {
+                    settle(cityRegistry->bindProvider(info.cityId, info.cityName),
+                        [&info](Promise<WeatherInfo>& promise) { promise.setValue(std::move(info)); });
+                }
+                for (const auto& failure : batch.failures) {
+                    for (const auto& cityName : failure.cities) {
+                        settle(cityRegistry->find(cityName),
+                            [&failure](Promise<WeatherInfo>& promise) { promise.setException(failure.error); });
+                    }
+                }
             }
-            catch (const std::exception& e) {
-                std::cerr << "Error updating weather for " << city << ": " << e.what() << std::endl;
+            catch (...) {
+                batchError = std::current_exception();
             }
-            });
+
+            // Every city failed, or the provider left some out of its response
+            for (size_t i = 0; i < cities.size(); ++i) {
+                if (!settled[i]) {
+                    promises[i].setException(batchError ? batchError
+                        : std::make_exception_ptr(std::runtime_error("No current weather in the response")));
+                }
+            }
+        }, RequestPriority::Background);
+
+    // The forecast endpoint has no group query, so forecasts are still fetched per city.
+    // Each one keeps a ticket, so selecting its city moves it ahead of the rest.
+    std::lock_guard<std::mutex> lock(queuedRefreshesMutex);
+    queuedRefreshes.clear();
+    for (size_t i = 0; i < cities.size(); ++i) {
+        CityId city = cities[i];
+        queuedRefreshes[city] = threadPool.postPromotable([this, city, current = std::move(currentWeather[i])]() mutable {
+            // Interactive once promoted
+            RequestPriority priority = ThreadPool::currentPriority();
+
+            // The city is updated once, when both its current weather and its forecast are in
+            using Joined = std::tuple<Future<WeatherInfo>, Future<std::vector<ForecastInfo>>>;
+            whenAll(std::move(current), weatherApi.getForecast(cityRegistry->name(city), 5, priority)).then(threadPool,
+                [this, city](Future<Joined> joined) {
+                    auto [current, forecast] = joined.get();
+                    try {
+                        weatherData.updateCurrentWeather(city, current.get());
+                    }
+                    catch (const std::exception& e) {
+                        std::cerr << "Error updating current weather for " << cityRegistry->name(city) << ": " << e.what() << std::endl;
+                    }
+                    try {
+                        weatherData.updateForecast(city, forecast.get());
+                    }
+                    catch (const std::exception& e) {
+                        std::cerr << "Error updating weather for " << cityRegistry->name(city) << ": " << e.what() << std::endl;
+                    }
+                }, priority);
+            }, RequestPriority::Background);
     }
 }
 
@@ -245,8 +330,8 @@ void WeatherApp::renderMainWindow() {
     if (ImGui::InputText("##Search", searchBuffer, sizeof(searchBuffer), ImGuiInputTextFlags_EnterReturnsTrue)) {
         // Add city directly when hitting Enter
         if (strlen(searchBuffer) > 0) {
-            addCity(searchBuffer);
-            selectedCity = searchBuffer;  // Select the city immediately
+            selectedCity = cityRegistry->intern(searchBuffer);  // Select the city immediately
+            addCity(selectedCity);
             searchQuery = "";  // Clear search filter after adding
         }
     }
@@ -258,8 +343,8 @@ void WeatherApp::renderMainWindow() {
     if (ImGui::Button("Search", ImVec2(100, 0))) { // Wider search button
         // Add city directly when clicking Search button
         if (strlen(searchBuffer) > 0) {
-            addCity(searchBuffer);
-            selectedCity = searchBuffer;  // Select the city immediately
+            selectedCity = cityRegistry->intern(searchBuffer);  // Select the city immediately
+            addCity(selectedCity);
             searchQuery = "";  // Clear search filter after adding
         }
     }
@@ -275,7 +360,9 @@ void WeatherApp::renderMainWindow() {
     ImGui::NextColumn();
 
     // Right column - weather details
-    if (!selectedCity.empty()) {
+    // A city the provider identified as one already listed carries on as that one
+    selectedCity = cityRegistry->canonical(selectedCity);
+    if (selectedCity != CityRegistry::kNoCity) {
         renderWeatherDetails();
 
         if (showForecast) {
@@ -307,6 +394,62 @@ void WeatherApp::renderMainWindow() {
     ImGui::PopStyleVar();
 }
 
+static std::string formatLocalTime(long long timestamp, const char* format) {
+    std::time_t time = timestamp;
+    std::stringstream ss;
+    ss << std::put_time(std::localtime(&time), format);
+    return ss.str();
+}
+
+// The selected city's formatted times and forecast days, rebuilt only when its snapshot version changes
+const WeatherApp::CityView& WeatherApp::selectedCityView() {
+    std::shared_ptr<const CitySnapshot> snapshot = weatherData.getSnapshot(selectedCity);
+    unsigned long long version = snapshot ? snapshot->version : 0;
+    unsigned long long built = cityView.snapshot ? cityView.snapshot->version : 0;
+    if (cityView.city == selectedCity && version == built) {
+        return cityView;
+    }
+
+    cityView = CityView();
+    cityView.city = selectedCity;
+    cityView.snapshot = std::move(snapshot);
+    if (!cityView.snapshot) {
+        return cityView;
+    }
+
+    if (const auto& current = cityView.snapshot->current) {
+        cityView.sunrise = formatLocalTime(current->sunrise, "%H:%M");
+        cityView.sunset = formatLocalTime(current->sunset, "%H:%M");
+    }
+
+    // Group forecast by days; entries come in time order, so a day is a run of equal dates
+    if (const auto& forecast = cityView.snapshot->forecast) {
+        std::string day;
+        for (const auto& item : *forecast) {
+            std::string date = formatLocalTime(item.dateTime, "%Y-%m-%d");
+            if (cityView.days.empty() || date != day) {
+                cityView.days.push_back({ formatLocalTime(item.dateTime, "%A, %d %B"), {} });
+                day = std::move(date);
+            }
+            cityView.days.back().entries.emplace_back(formatLocalTime(item.dateTime, "%H:%M"), &item);
+        }
+    }
+    return cityView;
+}
+
+// weatherData's cities, listed again only when a change brings one the list doesn't have yet
+const std::vector<CityId>& WeatherApp::allCities() {
+    WeatherChanges changes = weatherData.changedSince(cityListVersion);
+    bool added = std::any_of(changes.cities.begin(), changes.cities.end(), [this](CityId city) {
+        return std::find(cityList.begin(), cityList.end(), city) == cityList.end();
+        });
+    if (changes.cleared || added) {
+        cityList = weatherData.getAllCityIds();
+    }
+    cityListVersion = changes.version;
+    return cityList;
+}
+
 // Render the city list
 void WeatherApp::renderCityList() {
     ImGui::PushStyleVar(ImGuiStyleVar_ChildRounding, 8.0f);
@@ -322,26 +465,27 @@ void WeatherApp::renderCityList() {
 
     ImGui::Separator();
 
-    std::vector<std::string> cities;
+    std::vector<CityId> favorites;
     if (showFavorites) {
-        cities = favoriteCities.getAllFavorites();
-    }
-    else {
-        cities = weatherData.getAllCities();
+        favorites = favoriteCities.getAllFavorites();
     }
+    const std::vector<CityId>& listed = showFavorites ? favorites : allCities();
 
     // Filter by search query - keeping this for filtering existing cities
+    std::vector<CityId> filteredCities;
     if (!searchQuery.empty()) {
-        std::vector<std::string> filteredCities;
-        std::copy_if(cities.begin(), cities.end(), std::back_inserter(filteredCities),
-            [this](const std::string& city) {
-                return city.find(searchQuery) != std::string::npos;
+        std::copy_if(listed.begin(), listed.end(), std::back_inserter(filteredCities),
+            [this](CityId city) {
+                return cityRegistry->name(city).find(searchQuery) != std::string::npos;
             });
-        cities = filteredCities;
     }
+    const std::vector<CityId>& cities = searchQuery.empty() ? listed : filteredCities;
 
     ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(8, 10)); // More space between city buttons
-    for (const auto& city : cities) {
+    for (CityId city : cities) {
+        // Widget IDs come from the city ID, so no label strings are built per frame
+        ImGui::PushID(static_cast<int>(city));
+        const std::string& name = cityRegistry->name(city);
         bool isFav = favoriteCities.isFavorite(city);
         bool isSelected = city == selectedCity;
 
@@ -353,7 +497,7 @@ void WeatherApp::renderCityList() {
         ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.30f, 0.60f, 1.00f, 0.90f));
 
         // Taller button for better visibility
-        if (ImGui::Button(city.c_str(), ImVec2(ImGui::GetContentRegionAvail().x, 50))) {
+        if (ImGui::Button(name.c_str(), ImVec2(ImGui::GetContentRegionAvail().x, 50))) {
             selectCity(city);
         }
 
@@ -368,10 +512,10 @@ void WeatherApp::renderCityList() {
         }
 
         if (ImGui::IsItemHovered() && ImGui::IsMouseClicked(1)) {
-            ImGui::OpenPopup(("##CityContextMenu_" + city).c_str());
+            ImGui::OpenPopup("##CityContextMenu");
         }
 
-        if (ImGui::BeginPopup(("##CityContextMenu_" + city).c_str())) {
+        if (ImGui::BeginPopup("##CityContextMenu")) {
             if (ImGui::MenuItem(isFav ? "Remove from Favorites" : "Add to Favorites")) {
                 toggleFavorite(city);
             }
@@ -380,6 +524,7 @@ void WeatherApp::renderCityList() {
             }
             ImGui::EndPopup();
         }
+        ImGui::PopID();
     }
     ImGui::PopStyleVar();
 
@@ -405,8 +550,10 @@ void WeatherApp::renderCityList() {
 
 // Render weather details
 void WeatherApp::renderWeatherDetails() {
-    WeatherInfo info;
-    bool hasWeather = weatherData.getCurrentWeather(selectedCity, info);
+    // Held for the whole frame; writers publish new snapshots instead of changing this one
+    const CityView& view = selectedCityView();
+    std::shared_ptr<const CitySnapshot> snapshot = view.snapshot;
+    bool hasWeather = snapshot && snapshot->current;
 
     ImGui::PushStyleVar(ImGuiStyleVar_ChildRounding, 8.0f);
     ImGui::BeginChild("WeatherDetails", ImVec2(0, ImGui::GetContentRegionAvail().y * 0.6f), true);
@@ -414,7 +561,7 @@ void WeatherApp::renderWeatherDetails() {
     if (!hasWeather) {
         // Loading message with large font
         ImGui::PushFont(ImGui::GetIO().Fonts->Fonts[0]);
-        ImGui::TextColored(ImVec4(1.0f, 0.65f, 0.0f, 1.0f), "Loading weather data for %s...", selectedCity.c_str());
+        ImGui::TextColored(ImVec4(1.0f, 0.65f, 0.0f, 1.0f), "Loading weather data for %s...", cityRegistry->name(selectedCity).c_str());
         ImGui::PopFont();
 
         ImGui::Spacing();
@@ -423,7 +570,7 @@ void WeatherApp::renderWeatherDetails() {
         // Prominent refresh button
         ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.25f, 0.52f, 0.80f, 1.00f));
         if (ImGui::Button("Refresh", ImVec2(150, 50))) {
-            addCity(selectedCity);
+            addCity(selectedCity, selectedCityToken);
         }
         ImGui::PopStyleColor();
 
@@ -431,6 +578,7 @@ void WeatherApp::renderWeatherDetails() {
         ImGui::PopStyleVar();
         return;
     }
+    const WeatherInfo& info = *snapshot->current;
 
     // City title with large font
     ImGui::PushFont(ImGui::GetIO().Fonts->Fonts[0]);
@@ -490,7 +638,7 @@ void WeatherApp::renderWeatherDetails() {
     ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.3f, 0.5f, 0.7f, 0.9f));
 
     if (ImGui::Button("Refresh", ImVec2(130, 40))) {
-        addCity(selectedCity);
+        addCity(selectedCity, selectedCityToken);
     }
 
     ImGui::Spacing();
@@ -529,16 +677,8 @@ void WeatherApp::renderWeatherDetails() {
     ImGui::TextColored(ImVec4(0.7f, 0.9f, 1.0f, 1.0f), "%.1f hPa", info.pressure);
     ImGui::TextColored(ImVec4(0.7f, 0.9f, 1.0f, 1.0f), "%.1f m/s at %.1f°", info.windSpeed, info.windDeg);
 
-    // Format sunrise and sunset times
-    auto formatTime = [](long long timestamp) {
-        std::time_t time = timestamp;
-        std::stringstream ss;
-        ss << std::put_time(std::localtime(&time), "%H:%M");
-        return ss.str();
-        };
-
-    ImGui::TextColored(ImVec4(0.7f, 0.9f, 1.0f, 1.0f), "%s", formatTime(info.sunrise).c_str());
-    ImGui::TextColored(ImVec4(0.7f, 0.9f, 1.0f, 1.0f), "%s", formatTime(info.sunset).c_str());
+    ImGui::TextColored(ImVec4(0.7f, 0.9f, 1.0f, 1.0f), "%s", view.sunrise.c_str());
+    ImGui::TextColored(ImVec4(0.7f, 0.9f, 1.0f, 1.0f), "%s", view.sunset.c_str());
 
     ImGui::Columns(1);
 
@@ -551,49 +691,34 @@ void WeatherApp::renderWeatherDetails() {
 
 // Render forecast
 void WeatherApp::renderForecast() {
-    std::vector<ForecastInfo> forecast;
-    bool hasForecast = weatherData.getForecast(selectedCity, forecast);
+    const CityView& view = selectedCityView();
+    bool hasForecast = view.snapshot && view.snapshot->forecast;
 
     ImGui::PushStyleVar(ImGuiStyleVar_ChildRounding, 8.0f);
     ImGui::BeginChild("Forecast", ImVec2(0, 0), true);
 
     ImGui::PushFont(ImGui::GetIO().Fonts->Fonts[0]);
-    ImGui::Text("5-Day Forecast for %s", selectedCity.c_str());
+    ImGui::Text("5-Day Forecast for %s", cityRegistry->name(selectedCity).c_str());
     ImGui::PopFont();
 
     ImGui::Separator();
 
-    if (!hasForecast || forecast.empty()) {
+    if (!hasForecast || view.days.empty()) {
         ImGui::TextColored(ImVec4(1.0f, 0.65f, 0.0f, 1.0f), "Loading forecast data...");
         ImGui::EndChild();
         ImGui::PopStyleVar();
         return;
     }
 
-    // Group forecast by days
-    std::unordered_map<std::string, std::vector<ForecastInfo>> dailyForecasts;
-
-    for (const auto& item : forecast) {
-        std::time_t time = item.dateTime;
-        std::stringstream ss;
-        ss << std::put_time(std::localtime(&time), "%Y-%m-%d");
-        dailyForecasts[ss.str()].push_back(item);
-    }
-
     // Improved styling for forecast panels
     ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(12, 12));
     ImGui::PushStyleColor(ImGuiCol_Header, ImVec4(0.15f, 0.35f, 0.6f, 0.8f));
     ImGui::PushStyleColor(ImGuiCol_HeaderHovered, ImVec4(0.25f, 0.45f, 0.7f, 0.9f));
     ImGui::PushStyleColor(ImGuiCol_HeaderActive, ImVec4(0.20f, 0.40f, 0.65f, 1.0f));
 
-    for (const auto& pair : dailyForecasts) {
-        // Display day in format: Day name - date
-        std::time_t time = pair.second[0].dateTime;
-        std::stringstream headerSS;
-        headerSS << std::put_time(std::localtime(&time), "%A, %d %B");
-
-        // Collapsing headers for each day
-        if (ImGui::CollapsingHeader(headerSS.str().c_str())) {
+    for (const auto& day : view.days) {
+        // Collapsing headers for each day, titled "Day name, date"
+        if (ImGui::CollapsingHeader(day.header.c_str())) {
             ImGui::Columns(4, nullptr, false);
 
             // Column headers
@@ -608,13 +733,11 @@ void WeatherApp::renderForecast() {
 
             ImGui::Separator();
 
-            for (const auto& item : pair.second) {
-                std::time_t itemTime = item.dateTime;
-                std::stringstream ss;
-                ss << std::put_time(std::localtime(&itemTime), "%H:%M");
+            for (const auto& [time, entry] : day.entries) {
+                const ForecastInfo& item = *entry;
 
                 // Time column
-                ImGui::TextColored(ImVec4(1.0f, 1.0f, 1.0f, 1.0f), "%s", ss.str().c_str());
+                ImGui::TextColored(ImVec4(1.0f, 1.0f, 1.0f, 1.0f), "%s", time.c_str());
 
                 // Temperature column
                 ImGui::NextColumn();
@@ -670,8 +793,8 @@ void WeatherApp::renderAddCityPopup() {
         ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.25f, 0.52f, 0.80f, 1.00f));
         ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.35f, 0.62f, 0.90f, 1.00f));
         if (ImGui::Button("Add", ImVec2(150, 50)) && strlen(cityInput) > 0) {
-            addCity(cityInput);
-            selectedCity = cityInput;  // Select the city immediately
+            selectedCity = cityRegistry->intern(cityInput);  // Select the city immediately
+            addCity(selectedCity);
             showAddCityPopup = false;
         }
         ImGui::PopStyleColor(2);
@@ -742,42 +865,81 @@ void WeatherApp::renderSettingsPopup() {
 }
 
 // Select a city to display
-void WeatherApp::selectCity(const std::string& cityName) {
-    selectedCity = cityName;
+void WeatherApp::selectCity(CityId city) {
+    city = cityRegistry->canonical(city);
+    if (city == CityRegistry::kNoCity) {
+        return;
+    }
+    if (city != selectedCity) {
+        // The previous city's fetch is no longer worth waiting for
+        selectedCityToken.cancel();
+        selectedCityToken = CancellationToken::create();
+    }
+    selectedCity = city;
+
+    // A refresh of this city still waiting behind the others goes first
+    {
+        std::lock_guard<std::mutex> lock(queuedRefreshesMutex);
+        auto queued = queuedRefreshes.find(city);
+        if (queued != queuedRefreshes.end()) {
+            threadPool.promote(queued->second, RequestPriority::Interactive);
+        }
+    }
 
     // If city isn't in the data, add it
-    WeatherInfo info;
-    if (!weatherData.getCurrentWeather(cityName, info)) {
-        addCity(cityName);
+    std::shared_ptr<const CitySnapshot> snapshot = weatherData.getSnapshot(city);
+    if (!snapshot || !snapshot->current) {
+        addCity(city, selectedCityToken);
     }
 }
 
+void WeatherApp::selectCity(const std::string& cityName) {
+    selectCity(cityRegistry->intern(cityName));
+}
+
 // Add a city and fetch its weather data - IMPROVED
-void WeatherApp::addCity(const std::string& cityName) {
-    if (cityName.empty()) {
+void WeatherApp::addCity(CityId city, const CancellationToken& token) {
+    if (city == CityRegistry::kNoCity) {
         return;
     }
 
     // Print status to console
-    std::cout << "Adding city: " << cityName << std::endl;
+    std::cout << "Adding city: " << cityRegistry->name(city) << std::endl;
+
+    scheduler.spawn(refreshCity(city, token));
+}
 
-    threadPool.enqueue([this, cityName]() {
-        try {
-            auto weatherFuture = weatherApi.getCurrentWeather(cityName);
-            auto forecastFuture = weatherApi.getForecast(cityName);
+void WeatherApp::addCity(const std::string& cityName, const CancellationToken& token) {
+    addCity(cityRegistry->intern(cityName), token);
+}
 
-            auto weather = weatherFuture.get();
-            auto forecast = forecastFuture.get();
+// Fetch a city's weather and forecast; the coroutine holds no thread while the requests run
+Task<> WeatherApp::refreshCity(CityId city, CancellationToken token) {
+    // The registry keeps every name it hands out alive, so the reference survives the awaits
+    const std::string& cityName = cityRegistry->name(city);
+    try {
+        auto weatherResult = weatherApi.awaitCurrentWeather(cityName, RequestPriority::Interactive, token);
+        auto forecastResult = weatherApi.awaitForecast(cityName, 5, RequestPriority::Interactive, token);
 
-            weatherData.updateCurrentWeather(weather);
-            weatherData.updateForecast(cityName, forecast);
+        auto weather = co_await weatherResult;
+        auto forecast = co_await forecastResult;
 
-            // No need to update selectedCity here as it's done when calling the function
-        }
-        catch (const std::exception& e) {
-            std::cerr << "Error adding city " << cityName << ": " << e.what() << std::endl;
+        // Results can complete on an I/O or timer thread, continue on our own pool
+        co_await scheduler.schedule();
+
+        // The provider's answer says which city this is, "jerusalem" and "Jerusalem" alike
+        city = cityRegistry->bind(city, weather.cityId, weather.cityName);
+        weatherData.updateCurrentWeather(city, std::move(weather));
+        weatherData.updateForecast(city, std::move(forecast));
+    }
+    catch (const RequestCancelled& e) {
+        if (e.getReason() == CancelReason::TimedOut) {
+            std::cerr << "Timed out adding city " << cityName << std::endl;
         }
-        });
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error adding city " << cityName << ": " << e.what() << std::endl;
+    }
 }
 
 // Refresh weather data for all cities
@@ -786,12 +948,12 @@ void WeatherApp::refreshWeather() {
 }
 
 // Toggle favorite status for a city
-void WeatherApp::toggleFavorite(const std::string& cityName) {
-    if (favoriteCities.isFavorite(cityName)) {
-        favoriteCities.removeFavorite(cityName);
+void WeatherApp::toggleFavorite(CityId city) {
+    if (favoriteCities.isFavorite(city)) {
+        favoriteCities.removeFavorite(city);
     }
     else {
-        favoriteCities.addFavorite(cityName);
+        favoriteCities.addFavorite(city);
     }
 }
 
@@ -800,5 +962,6 @@ void WeatherApp::setSearchQuery(const std::string& query) {
     searchQuery = query;
 }
 void WeatherAPI::updateApiKey(const std::string& newApiKey) {
+    std::lock_guard<std::mutex> lock(apiKeyMutex);
     this->apiKey = newApiKey;
 }
\ No newline at end of file
@@ -11,42 +11,18 @@
 #include <condition_variable>
 #include <queue>
 #include <functional>
+#include <unordered_map>
+#include "CityRegistry.h"
 #include "WeatherData.h"
 #include "WeatherAPI.h"
 #include "FavoriteCities.h"
+#include "ThreadPool.h"
+#include "CoroutineScheduler.h"
+#include "Task.h"
 
  // Forward declarations
 struct GLFWwindow;
 
-/**
- * @class ThreadPool
- * @brief Thread pool for executing tasks in parallel
- */
-class ThreadPool {
-private:
-    std::vector<std::thread> workers;
-    std::queue<std::function<void()>> tasks;
-    std::mutex queueMutex;
-    std::condition_variable condition;
-    std::atomic<bool> stop;
-
-public:
-    ThreadPool(size_t numThreads);
-    ~ThreadPool();
-
-    template<class F>
-    void enqueue(F&& f) {
-        {
-            std::unique_lock<std::mutex> lock(queueMutex);
-            if (stop.load()) {
-                throw std::runtime_error("Enqueue on stopped ThreadPool");
-            }
-            tasks.emplace(std::forward<F>(f));
-        }
-        condition.notify_one();
-    }
-};
-
 /**
  * @class WeatherApp
  * @brief Main application class with GUI and weather data management
@@ -54,17 +30,43 @@ public:
 class WeatherApp {
 private:
     // Core components
+    std::shared_ptr<CityRegistry> cityRegistry;     // City IDs shared by the data, favorites and UI
     WeatherData weatherData;
+    std::shared_ptr<ThreadPool> ioPool;
     WeatherAPI weatherApi;
     FavoriteCities favoriteCities;
     ThreadPool threadPool;
+    CoroutineScheduler scheduler;   // Runs city refreshes as coroutines on threadPool
+
+    // Background forecast refreshes of the last "Refresh All", promoted when their city is selected
+    std::unordered_map<CityId, ThreadPool::Ticket> queuedRefreshes;
+    std::mutex queuedRefreshesMutex;
+
+    // Text and day grouping shown for the selected city, rebuilt only when its snapshot changes
+    struct ForecastDay {
+        std::string header;                                                 // e.g. "Monday, 01 January"
+        std::vector<std::pair<std::string, const ForecastInfo*>> entries;   // Time of day and entry
+    };
+    struct CityView {
+        CityId city = CityRegistry::kNoCity;
+        std::shared_ptr<const CitySnapshot> snapshot;   // Owns the entries the days point into
+        std::string sunrise;
+        std::string sunset;
+        std::vector<ForecastDay> days;
+    };
+    CityView cityView;
+
+    // weatherData's cities as of cityListVersion
+    std::vector<CityId> cityList;
+    unsigned long long cityListVersion;
 
     // GLFW and GUI
     GLFWwindow* window;
 
     // Application state
     std::atomic<bool> isRunning;
-    std::string selectedCity;
+    CityId selectedCity;
+    CancellationToken selectedCityToken;   // Cancels the selected city's fetch when another city is selected
     std::string searchQuery;
     bool showForecast;
     bool showFavorites;
@@ -73,6 +75,9 @@ private:
 
     // Rendering methods
     void updateWeatherData();
+    Task<> refreshCity(CityId city, CancellationToken token);
+    const CityView& selectedCityView();
+    const std::vector<CityId>& allCities();
     void renderMainWindow();
     void renderCityList();
     void renderWeatherDetails();
@@ -81,16 +86,23 @@ private:
     void renderSettingsPopup();
 
 public:
-    WeatherApp();
+    /**
+     * @brief Constructor
+     * @param baseUrl Weather server to use instead of the provider, e.g. a local stand-in
+     * @param transport HTTP engine of the API, e.g. a cassette recorder or replayer; the default when null
+     */
+    explicit WeatherApp(const std::string& baseUrl = "", std::unique_ptr<HttpTransport> transport = nullptr);
     ~WeatherApp();
 
     void initialize();
     void run();
     void shutdown();
 
+    void selectCity(CityId city);
     void selectCity(const std::string& cityName);
-    void addCity(const std::string& cityName);
+    void addCity(CityId city, const CancellationToken& token = CancellationToken());
+    void addCity(const std::string& cityName, const CancellationToken& token = CancellationToken());
     void refreshWeather();
-    void toggleFavorite(const std::string& cityName);
+    void toggleFavorite(CityId city);
     void setSearchQuery(const std::string& query);
 };
\ No newline at end of file
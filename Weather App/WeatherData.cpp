@@ -5,53 +5,203 @@
 #include "WeatherData.h"
 #include <algorithm>
 
-void WeatherData::updateCurrentWeather(const WeatherInfo& info) {
-    std::lock_guard<std::mutex> lock(weatherMutex);
-    currentWeather[info.cityName] = info;
+WeatherData::WeatherData(std::shared_ptr<CityRegistry> registry)
+    : registry(std::move(registry)), table(std::make_shared<const CityTable>()) {}
+
+std::shared_ptr<WeatherData::CitySlot> WeatherData::findSlot(CityId city) const {
+    std::shared_ptr<const CityTable> slots = table.load();
+    return city < slots->size() ? (*slots)[city] : nullptr;
+}
+
+std::vector<std::shared_ptr<WeatherData::CitySlot>> WeatherData::slotsFor(const std::vector<CityId>& cities) {
+    std::vector<std::shared_ptr<CitySlot>> slots;
+    slots.reserve(cities.size());
+    std::shared_ptr<const CityTable> current = table.load();
+    for (CityId city : cities) {
+        slots.push_back(city < current->size() ? (*current)[city] : nullptr);
+    }
+    if (std::find(slots.begin(), slots.end(), nullptr) == slots.end()) {
+        return slots;
+    }
+
+    // New cities: copy the table once for all of them, another writer may have added some meanwhile
+    std::lock_guard<std::mutex> lock(tableMutex);
+    auto grown = std::make_shared<CityTable>(*table.load());
+    for (size_t i = 0; i < cities.size(); ++i) {
+        if (!slots[i]) {
+            if (cities[i] >= grown->size()) {
+                grown->resize(cities[i] + 1);
+            }
+            auto& slot = (*grown)[cities[i]];
+            if (!slot) {
+                slot = std::make_shared<CitySlot>();
+            }
+            slots[i] = slot;
+        }
+    }
+    table.store(std::move(grown));
+    return slots;
+}
+
+std::shared_ptr<WeatherData::CitySlot> WeatherData::slotFor(CityId city) {
+    if (auto slot = findSlot(city)) {
+        return slot;
+    }
+    return slotsFor({ city }).front();
+}
+
+CityId WeatherData::resolve(const WeatherInfo& info) const {
+    return info.cityId != 0 ? registry->bindProvider(info.cityId, info.cityName) : registry->intern(info.cityName);
 }
 
-void WeatherData::updateForecast(const std::string& cityName, const std::vector<ForecastInfo>& forecastData) {
-    std::lock_guard<std::mutex> lock(forecastMutex);
-    forecasts[cityName] = forecastData;
+template<class Change>
+void WeatherData::publish(CitySlot& slot, Change change) {
+    std::lock_guard<std::mutex> lock(publishMutex);
+    std::shared_ptr<const CitySnapshot> previous = slot.snapshot.load();
+    auto updated = std::make_shared<CitySnapshot>(previous ? *previous : CitySnapshot());
+    change(*updated);
+    updated->version = version.load() + 1;
+    slot.snapshot.store(updated);
+    // Only after the snapshot, so whoever reads the version also finds the change
+    version.store(updated->version);
+}
+
+void WeatherData::record(CityId city, const WeatherInfo& info) {
+    // Without the provider's time a refresh can't be told apart from a new observation
+    if (info.observedAt != 0) {
+        history.append(city, { info.observedAt, static_cast<float>(info.temperature), static_cast<float>(info.humidity),
+            static_cast<float>(info.pressure), static_cast<float>(info.windSpeed) });
+    }
+}
+
+void WeatherData::updateCurrentWeather(CityId city, WeatherInfo info) {
+    if (city == CityRegistry::kNoCity) {
+        return;
+    }
+    city = registry->canonical(city);
+    record(city, info);
+    std::shared_ptr<CitySlot> slot = slotFor(city);
+    auto current = std::make_shared<const WeatherInfo>(std::move(info));
+    publish(*slot, [&current](CitySnapshot& snapshot) { snapshot.current = current; });
+}
+
+void WeatherData::updateCurrentWeather(WeatherInfo info) {
+    CityId city = resolve(info);
+    updateCurrentWeather(city, std::move(info));
+}
+
+void WeatherData::updateCurrentWeatherBatch(std::vector<WeatherInfo> infos) {
+    // Cities the registry can't place, i.e. without a name, are skipped
+    std::vector<CityId> cities;
+    cities.reserve(infos.size());
+    size_t kept = 0;
+    for (size_t i = 0; i < infos.size(); ++i) {
+        CityId city = resolve(infos[i]);
+        if (city != CityRegistry::kNoCity) {
+            if (kept != i) {
+                infos[kept] = std::move(infos[i]);
+            }
+            cities.push_back(city);
+            kept++;
+        }
+    }
+    std::vector<std::shared_ptr<CitySlot>> slots = slotsFor(cities);
+
+    for (size_t i = 0; i < kept; ++i) {
+        record(cities[i], infos[i]);
+        auto current = std::make_shared<const WeatherInfo>(std::move(infos[i]));
+        publish(*slots[i], [&current](CitySnapshot& snapshot) { snapshot.current = current; });
+    }
+}
+
+void WeatherData::updateForecast(CityId city, std::vector<ForecastInfo> forecastData) {
+    if (city == CityRegistry::kNoCity) {
+        return;
+    }
+    std::shared_ptr<CitySlot> slot = slotFor(registry->canonical(city));
+    auto forecast = std::make_shared<const std::vector<ForecastInfo>>(std::move(forecastData));
+    publish(*slot, [&forecast](CitySnapshot& snapshot) { snapshot.forecast = forecast; });
+}
+
+void WeatherData::updateForecast(const std::string& cityName, std::vector<ForecastInfo> forecastData) {
+    updateForecast(registry->intern(cityName), std::move(forecastData));
+}
+
+std::shared_ptr<const CitySnapshot> WeatherData::getSnapshot(CityId city) const {
+    // An alias may still have a slot of its own, with the data fetched before the merge
+    std::shared_ptr<CitySlot> slot = findSlot(registry->canonical(city));
+    return slot ? slot->snapshot.load() : nullptr;
+}
+
+std::shared_ptr<const CitySnapshot> WeatherData::getSnapshot(std::string_view cityName) const {
+    return getSnapshot(registry->find(cityName));
 }
 
 bool WeatherData::getCurrentWeather(const std::string& cityName, WeatherInfo& info) const {
-    std::lock_guard<std::mutex> lock(weatherMutex);
-    auto it = currentWeather.find(cityName);
-    if (it != currentWeather.end()) {
-        info = it->second;
+    std::shared_ptr<const CitySnapshot> snapshot = getSnapshot(std::string_view(cityName));
+    if (snapshot && snapshot->current) {
+        info = *snapshot->current;
         return true;
     }
     return false;
 }
 
 bool WeatherData::getForecast(const std::string& cityName, std::vector<ForecastInfo>& forecastData) const {
-    std::lock_guard<std::mutex> lock(forecastMutex);
-    auto it = forecasts.find(cityName);
-    if (it != forecasts.end()) {
-        forecastData = it->second;
+    std::shared_ptr<const CitySnapshot> snapshot = getSnapshot(std::string_view(cityName));
+    if (snapshot && snapshot->forecast) {
+        forecastData = *snapshot->forecast;
         return true;
     }
     return false;
 }
 
-std::vector<std::string> WeatherData::getAllCities() const {
-    std::lock_guard<std::mutex> lock(weatherMutex);
-    std::vector<std::string> cities;
-    cities.reserve(currentWeather.size());
-    for (const auto& pair : currentWeather) {
-        cities.push_back(pair.first);
+WeatherChanges WeatherData::changedSince(unsigned long long since) const {
+    WeatherChanges changes;
+    changes.version = version.load();
+    if (changes.version <= since) {
+        return changes;
     }
-    return cities;
+
+    changes.cleared = clearedVersion.load() > since;
+    std::shared_ptr<const CityTable> slots = table.load();
+    for (CityId city = 0; city < slots->size(); ++city) {
+        if (!(*slots)[city]) {
+            continue;
+        }
+        std::shared_ptr<const CitySnapshot> snapshot = (*slots)[city]->snapshot.load();
+        if (snapshot && snapshot->version > since) {
+            changes.cities.push_back(city);
+        }
+    }
+    return changes;
 }
 
-void WeatherData::clearData() {
-    {
-        std::lock_guard<std::mutex> lock(weatherMutex);
-        currentWeather.clear();
+std::vector<CityId> WeatherData::getAllCityIds() const {
+    std::shared_ptr<const CityTable> slots = table.load();
+    std::vector<CityId> cities;
+    for (CityId city = 0; city < slots->size(); ++city) {
+        // Data stored under a name that later turned out to be another city's alias is left out
+        if ((*slots)[city] && registry->canonical(city) == city) {
+            cities.push_back(city);
+        }
     }
-    {
-        std::lock_guard<std::mutex> lock(forecastMutex);
-        forecasts.clear();
+    return cities;
+}
+
+std::vector<std::string> WeatherData::getAllCities() const {
+    std::vector<std::string> names;
+    for (CityId city : getAllCityIds()) {
+        names.push_back(registry->name(city));
     }
-}
\ No newline at end of file
+    return names;
+}
+
+void WeatherData::clearData() {
+    std::lock_guard<std::mutex> tableLock(tableMutex);
+    std::lock_guard<std::mutex> publishLock(publishMutex);
+    table.store(std::make_shared<const CityTable>());
+    history.clear();
+    unsigned long long cleared = version.load() + 1;
+    clearedVersion.store(cleared);
+    version.store(cleared);
+}
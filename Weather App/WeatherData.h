@@ -7,13 +7,18 @@
 #include <vector>
 #include <unordered_map>
 #include <atomic>
+#include <memory>
 #include <mutex>
+#include <string_view>
+#include "CityRegistry.h"
+#include "WeatherHistory.h"
 
  /**
   * @struct WeatherInfo
   * @brief Structure to store current weather information for a city
   */
 struct WeatherInfo {
+    long long cityId;   // Provider city ID, used for group queries
     std::string cityName;
     std::string countryCode;
     double temperature;
@@ -29,6 +34,7 @@ struct WeatherInfo {
     std::string weatherIcon;
     long long sunrise;
     long long sunset;
+    long long observedAt;   // Provider's observation time; 0 if unknown
     std::string lastUpdated;
 };
 
@@ -51,25 +57,119 @@ struct ForecastInfo {
     std::string weatherIcon;
 };
 
+/**
+ * @struct CitySnapshot
+ * @brief Immutable view of everything known about one city
+ *
+ * Never modified once published, so a reader can hold on to one for a whole
+ * frame. A new current weather shares the forecast of the snapshot it
+ * replaces, and the other way round.
+ */
+struct CitySnapshot {
+    unsigned long long version = 0;                             // WeatherData version of the city's latest change
+    std::shared_ptr<const WeatherInfo> current;                 // Null until fetched
+    std::shared_ptr<const std::vector<ForecastInfo>> forecast;  // Null until fetched
+};
+
+/**
+ * @struct WeatherChanges
+ * @brief What WeatherData::changedSince() found
+ */
+struct WeatherChanges {
+    unsigned long long version = 0;     // Pass to the next changedSince() call
+    bool cleared = false;               // clearData() ran since; drop everything derived
+    std::vector<CityId> cities;         // Cities whose snapshot is newer
+};
+
 /**
  * @class WeatherData
  * @brief Class for managing weather data with thread-safe access
+ *
+ * Cities are keyed by their CityRegistry ID, so the table is a vector indexed
+ * by ID and the per-frame and per-update paths neither hash nor copy names.
+ * The string overloads resolve names through the registry first.
+ *
+ * Read-copy-update: the city table and each city's snapshot are published
+ * through atomic shared pointers. Readers load them without taking a lock or
+ * copying any weather, and writers build a new snapshot and swap it in.
+ *
+ * Every change gets the next value of one global version, which also becomes
+ * the changed city's snapshot version, so both only ever grow. Consumers that
+ * derive something from the data remember the version they built it from and
+ * ask changedSince() what to rebuild. Writers stamp and store under a short
+ * lock so that everything up to getVersion() is visible once it is read;
+ * readers never take it.
  */
 class WeatherData {
 private:
-    std::unordered_map<std::string, WeatherInfo> currentWeather;
-    std::unordered_map<std::string, std::vector<ForecastInfo>> forecasts;
-    mutable std::mutex weatherMutex;
-    mutable std::mutex forecastMutex;
+    struct CitySlot {
+        std::atomic<std::shared_ptr<const CitySnapshot>> snapshot;
+    };
+    using CityTable = std::vector<std::shared_ptr<CitySlot>>;   // Indexed by CityId, null for cities without data
+
+    std::shared_ptr<CityRegistry> registry;
+    std::atomic<std::shared_ptr<const CityTable>> table;
+    std::mutex tableMutex;      // Held while the table is copied and replaced
+    std::mutex publishMutex;    // Held while a change is stamped and stored
+    std::atomic<unsigned long long> version{ 0 };
+    std::atomic<unsigned long long> clearedVersion{ 0 };
+    WeatherHistory history;
+
+    std::vector<std::shared_ptr<CitySlot>> slotsFor(const std::vector<CityId>& cities);
+    std::shared_ptr<CitySlot> slotFor(CityId city);
+    std::shared_ptr<CitySlot> findSlot(CityId city) const;
+    CityId resolve(const WeatherInfo& info) const;
+
+    template<class Change>
+    void publish(CitySlot& slot, Change change);
+
+    void record(CityId city, const WeatherInfo& info);
 
 public:
-    WeatherData() = default;
+    /**
+     * @brief Constructor
+     * @param registry Registry the city IDs come from, shared with the rest of the app
+     */
+    explicit WeatherData(std::shared_ptr<CityRegistry> registry = std::make_shared<CityRegistry>());
     ~WeatherData() = default;
 
-    void updateCurrentWeather(const WeatherInfo& info);
-    void updateForecast(const std::string& cityName, const std::vector<ForecastInfo>& forecastData);
+    const std::shared_ptr<CityRegistry>& getRegistry() const { return registry; }
+
+    /**
+     * @brief Every observation stored as current weather, by canonical city ID
+     */
+    const WeatherHistory& getHistory() const { return history; }
+
+    void updateCurrentWeather(CityId city, WeatherInfo info);
+    void updateCurrentWeather(WeatherInfo info);
+    void updateCurrentWeatherBatch(std::vector<WeatherInfo> infos);
+    void updateForecast(CityId city, std::vector<ForecastInfo> forecastData);
+    void updateForecast(const std::string& cityName, std::vector<ForecastInfo> forecastData);
+
+    /**
+     * @brief Latest snapshot of a city, without hashing or copying
+     * @param city ID of the city; an ID merged into another finds that city's snapshot
+     * @return Null if nothing is known about the city
+     */
+    std::shared_ptr<const CitySnapshot> getSnapshot(CityId city) const;
+    std::shared_ptr<const CitySnapshot> getSnapshot(std::string_view cityName) const;
+
+    /**
+     * @brief Version of the latest change; one atomic load
+     */
+    unsigned long long getVersion() const { return version.load(); }
+
+    /**
+     * @brief Cities changed after the given version
+     *
+     * Returns at once when nothing changed. The list may include changes newer
+     * than the returned version, which the next call reports again.
+     */
+    WeatherChanges changedSince(unsigned long long since) const;
+
     bool getCurrentWeather(const std::string& cityName, WeatherInfo& info) const;
     bool getForecast(const std::string& cityName, std::vector<ForecastInfo>& forecastData) const;
+    std::vector<CityId> getAllCityIds() const;
     std::vector<std::string> getAllCities() const;
     void clearData();
-};
\ No newline at end of file
+};
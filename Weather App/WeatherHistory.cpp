@@ -0,0 +1,311 @@
+/**
+ * @file WeatherHistory.cpp
+ * @brief Implementation of the WeatherHistory class
+ */
+#include "WeatherHistory.h"
+#include <algorithm>
+#include <bit>
+#include <mutex>
+
+namespace {
+
+    constexpr float HistoryPoint::* kFieldMembers[] = {
+        &HistoryPoint::temperature, &HistoryPoint::humidity, &HistoryPoint::pressure, &HistoryPoint::windSpeed };
+
+    // Writes bits into a block's words, most significant bit first
+    template<class Block>
+    struct BitWriter {
+        Block& block;
+
+        void put(std::uint64_t value, unsigned count) {
+            if (count == 0) {
+                return;
+            }
+            size_t word = block.bits / 64;
+            unsigned used = block.bits % 64;
+            unsigned room = 64 - used;
+            if (count <= room) {
+                block.words[word] |= value << (room - count);
+            }
+            else {
+                block.words[word] |= value >> (count - room);
+                block.words[word + 1] |= value << (64 - (count - room));
+            }
+            block.bits += count;
+        }
+    };
+
+    // Only counts, so a point can be sized before it is written
+    struct BitCounter {
+        size_t bits = 0;
+
+        void put(std::uint64_t, unsigned count) { bits += count; }
+    };
+
+    template<class Block>
+    struct BitReader {
+        const Block& block;
+        size_t position = 0;
+
+        std::uint64_t get(unsigned count) {
+            if (count == 0) {
+                return 0;
+            }
+            size_t word = position / 64;
+            unsigned used = position % 64;
+            std::uint64_t value = block.words[word] << used;
+            if (used + count > 64) {
+                value |= block.words[word + 1] >> (64 - used);
+            }
+            position += count;
+            return value >> (64 - count);
+        }
+    };
+
+    long long signExtend(std::uint64_t value, unsigned count) {
+        return static_cast<long long>(value << (64 - count)) >> (64 - count);
+    }
+
+}
+
+template<class Sink>
+void WeatherHistory::Encoder::encode(const HistoryPoint& point, bool first, Sink& sink) {
+    if (first) {
+        sink.put(static_cast<std::uint64_t>(point.time), 64);
+        for (size_t field = 0; field < kFields; ++field) {
+            values[field] = std::bit_cast<std::uint32_t>(point.*kFieldMembers[field]);
+            window[field] = false;
+            sink.put(values[field], 32);
+        }
+        time = point.time;
+        delta = 0;
+        return;
+    }
+
+    // Delta-of-delta with Gorilla's prefix buckets; a steady pace costs one bit
+    long long nextDelta = point.time - time;
+    long long deltaOfDelta = nextDelta - delta;
+    std::uint64_t raw = static_cast<std::uint64_t>(deltaOfDelta);
+    if (deltaOfDelta == 0) {
+        sink.put(0b0, 1);
+    }
+    else if (deltaOfDelta >= -64 && deltaOfDelta <= 63) {
+        sink.put(0b10, 2);
+        sink.put(raw & 0x7F, 7);
+    }
+    else if (deltaOfDelta >= -256 && deltaOfDelta <= 255) {
+        sink.put(0b110, 3);
+        sink.put(raw & 0x1FF, 9);
+    }
+    else if (deltaOfDelta >= -2048 && deltaOfDelta <= 2047) {
+        sink.put(0b1110, 4);
+        sink.put(raw & 0xFFF, 12);
+    }
+    else {
+        sink.put(0b1111, 4);
+        sink.put(raw, 64);
+    }
+    time = point.time;
+    delta = nextDelta;
+
+    // XOR with the previous value; the meaningful bits reuse the last window when they fit in it
+    for (size_t field = 0; field < kFields; ++field) {
+        std::uint32_t value = std::bit_cast<std::uint32_t>(point.*kFieldMembers[field]);
+        std::uint32_t changed = value ^ values[field];
+        values[field] = value;
+        if (changed == 0) {
+            sink.put(0b0, 1);
+            continue;
+        }
+        unsigned lead = static_cast<unsigned>(std::countl_zero(changed));
+        unsigned trail = static_cast<unsigned>(std::countr_zero(changed));
+        if (window[field] && lead >= leading[field] && trail >= trailing[field]) {
+            sink.put(0b10, 2);
+            sink.put(changed >> trailing[field], 32 - leading[field] - trailing[field]);
+        }
+        else {
+            unsigned length = 32 - lead - trail;
+            sink.put(0b11, 2);
+            sink.put(lead, 5);
+            sink.put(length - 1, 5);
+            sink.put(changed >> trail, length);
+            leading[field] = static_cast<std::uint8_t>(lead);
+            trailing[field] = static_cast<std::uint8_t>(trail);
+            window[field] = true;
+        }
+    }
+}
+
+WeatherHistory::WeatherHistory(size_t budgetBytes)
+    : maxBlocks(std::max<size_t>(1, budgetBytes / sizeof(Block))) {}
+
+std::unique_ptr<WeatherHistory::Block> WeatherHistory::allocateBlock() {
+    if (blocksInUse < maxBlocks) {
+        blocksInUse++;
+        return std::make_unique<Block>();
+    }
+
+    // Over budget: recycle the oldest block of all, which is the front block of its city
+    CityId oldest = allocationOrder.front();
+    allocationOrder.pop_front();
+    CityHistory& victim = cities[oldest];
+    std::unique_ptr<Block> block = std::move(victim.blocks.front());
+    victim.blocks.pop_front();
+    victim.points -= block->count;
+    totalPoints -= block->count;
+    bitsUsed -= block->bits;
+    *block = Block();
+    return block;
+}
+
+bool WeatherHistory::append(CityId city, const HistoryPoint& point) {
+    if (city == CityRegistry::kNoCity) {
+        return false;
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (city >= cities.size()) {
+        cities.resize(static_cast<size_t>(city) + 1);
+    }
+    CityHistory& history = cities[city];
+    if (point.time <= history.lastTime) {
+        return false;
+    }
+
+    Block* open = history.blocks.empty() ? nullptr : history.blocks.back().get();
+    if (open) {
+        Encoder trial = history.encoder;
+        BitCounter counter;
+        trial.encode(point, open->count == 0, counter);
+        if (open->bits + counter.bits > open->words.size() * 64) {
+            open = nullptr;
+        }
+    }
+    if (!open) {
+        std::unique_ptr<Block> block = allocateBlock();
+        open = block.get();
+        history.blocks.push_back(std::move(block));
+        allocationOrder.push_back(city);
+    }
+
+    BitWriter<Block> writer{ *open };
+    std::uint32_t before = open->bits;
+    history.encoder.encode(point, open->count == 0, writer);
+    if (open->count == 0) {
+        open->firstTime = point.time;
+    }
+    open->lastTime = point.time;
+    open->count++;
+
+    history.points++;
+    history.lastTime = point.time;
+    totalPoints++;
+    bitsUsed += open->bits - before;
+    return true;
+}
+
+void WeatherHistory::decode(const Block& block, long long from, long long to, std::vector<HistoryPoint>& out) {
+    BitReader<Block> reader{ block };
+    long long time = 0;
+    long long delta = 0;
+    std::array<std::uint32_t, kFields> values{};
+    std::array<unsigned, kFields> leading{};
+    std::array<unsigned, kFields> trailing{};
+
+    for (std::uint32_t i = 0; i < block.count; ++i) {
+        if (i == 0) {
+            time = static_cast<long long>(reader.get(64));
+            for (size_t field = 0; field < kFields; ++field) {
+                values[field] = static_cast<std::uint32_t>(reader.get(32));
+            }
+        }
+        else {
+            long long deltaOfDelta = 0;
+            if (reader.get(1) != 0) {
+                if (reader.get(1) == 0) {
+                    deltaOfDelta = signExtend(reader.get(7), 7);
+                }
+                else if (reader.get(1) == 0) {
+                    deltaOfDelta = signExtend(reader.get(9), 9);
+                }
+                else if (reader.get(1) == 0) {
+                    deltaOfDelta = signExtend(reader.get(12), 12);
+                }
+                else {
+                    deltaOfDelta = static_cast<long long>(reader.get(64));
+                }
+            }
+            delta += deltaOfDelta;
+            time += delta;
+
+            for (size_t field = 0; field < kFields; ++field) {
+                if (reader.get(1) == 0) {
+                    continue;
+                }
+                if (reader.get(1) != 0) {
+                    leading[field] = static_cast<unsigned>(reader.get(5));
+                    unsigned meaningful = static_cast<unsigned>(reader.get(5)) + 1;
+                    trailing[field] = 32 - leading[field] - meaningful;
+                }
+                unsigned length = 32 - leading[field] - trailing[field];
+                values[field] ^= static_cast<std::uint32_t>(reader.get(length)) << trailing[field];
+            }
+        }
+
+        if (time > to) {
+            return;
+        }
+        if (time >= from) {
+            HistoryPoint point;
+            point.time = time;
+            for (size_t field = 0; field < kFields; ++field) {
+                point.*kFieldMembers[field] = std::bit_cast<float>(values[field]);
+            }
+            out.push_back(point);
+        }
+    }
+}
+
+void WeatherHistory::range(CityId city, long long from, long long to, std::vector<HistoryPoint>& out) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    if (city >= cities.size()) {
+        return;
+    }
+    for (const auto& block : cities[city].blocks) {
+        if (block->count == 0 || block->lastTime < from) {
+            continue;
+        }
+        if (block->firstTime > to) {
+            break;
+        }
+        decode(*block, from, to, out);
+    }
+}
+
+size_t WeatherHistory::pointCount() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return totalPoints;
+}
+
+size_t WeatherHistory::pointCount(CityId city) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return city < cities.size() ? cities[city].points : 0;
+}
+
+size_t WeatherHistory::memoryUsage() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return blocksInUse * sizeof(Block);
+}
+
+size_t WeatherHistory::encodedBytes() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return (bitsUsed + 7) / 8;
+}
+
+void WeatherHistory::clear() {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    cities.clear();
+    allocationOrder.clear();
+    blocksInUse = 0;
+    totalPoints = 0;
+    bitsUsed = 0;
+}
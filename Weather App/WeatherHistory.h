@@ -0,0 +1,123 @@
+/**
+ * @file WeatherHistory.h
+ * @brief Compressed per-city observation history within a fixed memory budget
+ */
+#pragma once
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <shared_mutex>
+#include <vector>
+#include "CityRegistry.h"
+
+/**
+ * @struct HistoryPoint
+ * @brief One observation of a city
+ */
+struct HistoryPoint {
+    long long time;         // Unix time the provider observed it
+    float temperature;
+    float humidity;
+    float pressure;
+    float windSpeed;
+};
+
+/**
+ * @class WeatherHistory
+ * @brief Time series of observations per city, Gorilla-compressed in fixed-size blocks
+ *
+ * Timestamps are stored as delta-of-delta: observations come at a nearly
+ * steady pace, so most take a bit or a few. Each value is XORed with the same
+ * field's previous value and only the differing bits are kept, one bit when
+ * the value didn't change.
+ *
+ * Blocks are all the same size and start over from a full point, so each one
+ * decodes on its own. A range scan skips blocks outside the range by their
+ * first and last time and decodes only the rest. Once the budget is used up,
+ * the oldest block of all is recycled, so every city keeps its most recent
+ * observations.
+ */
+class WeatherHistory {
+public:
+    static constexpr size_t kBlockBytes = 512;
+
+private:
+    static constexpr size_t kFields = 4;
+
+    struct Block {
+        long long firstTime = 0;
+        long long lastTime = 0;
+        std::uint32_t count = 0;
+        std::uint32_t bits = 0;
+        std::array<std::uint64_t, (kBlockBytes - 24) / 8> words{};
+    };
+    static_assert(sizeof(Block) == kBlockBytes, "Block must fill its size exactly");
+
+    // What the encoder remembers of the point before, to encode the next one against it
+    struct Encoder {
+        long long time = 0;
+        long long delta = 0;
+        std::array<std::uint32_t, kFields> values{};
+        std::array<std::uint8_t, kFields> leading{};
+        std::array<std::uint8_t, kFields> trailing{};
+        std::array<bool, kFields> window{};    // Whether leading and trailing hold a window to reuse
+
+        template<class Sink>
+        void encode(const HistoryPoint& point, bool first, Sink& sink);
+    };
+
+    struct CityHistory {
+        std::deque<std::unique_ptr<Block>> blocks;  // Oldest first; the last one is being filled
+        Encoder encoder;                            // State after the last block's last point
+        size_t points = 0;
+        long long lastTime = std::numeric_limits<long long>::min();
+    };
+
+    mutable std::shared_mutex mutex;
+    std::deque<CityHistory> cities;                 // Indexed by CityId; a deque, since blocks can't be copied on growth
+    std::deque<CityId> allocationOrder;             // City of every block in use, oldest first
+    size_t maxBlocks;
+    size_t blocksInUse = 0;
+    size_t totalPoints = 0;
+    size_t bitsUsed = 0;
+
+    std::unique_ptr<Block> allocateBlock();
+    static void decode(const Block& block, long long from, long long to, std::vector<HistoryPoint>& out);
+
+public:
+    /**
+     * @param budgetBytes Memory the blocks may take; at least one block is always allowed
+     */
+    explicit WeatherHistory(size_t budgetBytes = 64 * 1024 * 1024);
+
+    WeatherHistory(const WeatherHistory&) = delete;
+    WeatherHistory& operator=(const WeatherHistory&) = delete;
+
+    /**
+     * @brief Add an observation
+     * @return false, storing nothing, if it is not newer than the city's last one
+     */
+    bool append(CityId city, const HistoryPoint& point);
+
+    /**
+     * @brief Append the city's observations from from to to, both included, in time order
+     */
+    void range(CityId city, long long from, long long to, std::vector<HistoryPoint>& out) const;
+
+    size_t pointCount() const;
+    size_t pointCount(CityId city) const;
+
+    /**
+     * @brief Bytes taken by blocks in use, headers and unfilled space included
+     */
+    size_t memoryUsage() const;
+
+    /**
+     * @brief Bytes of encoded points alone, block headers and unfilled space left out
+     */
+    size_t encodedBytes() const;
+
+    void clear();
+};
@@ -0,0 +1,58 @@
+/**
+ * @file WeatherSchema.h
+ * @brief Field tables mapping OpenWeatherMap responses onto WeatherInfo and ForecastInfo
+ */
+#pragma once
+#include "WeatherData.h"
+#include "SchemaParser.h"
+
+/**
+ * @struct CurrentWeatherSchema
+ * @brief Members of a /data/2.5/weather response (and of each /data/2.5/group item)
+ */
+struct CurrentWeatherSchema {
+    static constexpr FieldDescriptor<WeatherInfo> fields[] = {
+        { "", "id", nullptr, &WeatherInfo::cityId },
+        { "", "name", nullptr, nullptr, &WeatherInfo::cityName },
+        // Temperatures are already in Celsius because we use units=metric
+        { "main", "temp", &WeatherInfo::temperature },
+        { "main", "feels_like", &WeatherInfo::feelsLike },
+        { "main", "temp_min", &WeatherInfo::tempMin },
+        { "main", "temp_max", &WeatherInfo::tempMax },
+        { "main", "pressure", &WeatherInfo::pressure },
+        { "main", "humidity", &WeatherInfo::humidity },
+        { "wind", "speed", &WeatherInfo::windSpeed },
+        { "wind", "deg", &WeatherInfo::windDeg },
+        { "weather", "main", nullptr, nullptr, &WeatherInfo::weatherMain },
+        { "weather", "description", nullptr, nullptr, &WeatherInfo::weatherDescription },
+        { "weather", "icon", nullptr, nullptr, &WeatherInfo::weatherIcon },
+        { "sys", "country", nullptr, nullptr, &WeatherInfo::countryCode },
+        { "sys", "sunrise", nullptr, &WeatherInfo::sunrise },
+        { "sys", "sunset", nullptr, &WeatherInfo::sunset },
+        { "", "dt", nullptr, &WeatherInfo::observedAt },
+    };
+};
+
+/**
+ * @struct ForecastSchema
+ * @brief Members of each item in the list of a /data/2.5/forecast response
+ */
+struct ForecastSchema {
+    static constexpr FieldDescriptor<ForecastInfo> fields[] = {
+        { "", "dt", nullptr, &ForecastInfo::dateTime },
+        { "main", "temp", &ForecastInfo::temperature },
+        { "main", "feels_like", &ForecastInfo::feelsLike },
+        { "main", "temp_min", &ForecastInfo::tempMin },
+        { "main", "temp_max", &ForecastInfo::tempMax },
+        { "main", "pressure", &ForecastInfo::pressure },
+        { "main", "humidity", &ForecastInfo::humidity },
+        { "wind", "speed", &ForecastInfo::windSpeed },
+        { "wind", "deg", &ForecastInfo::windDeg },
+        { "weather", "main", nullptr, nullptr, &ForecastInfo::weatherMain },
+        { "weather", "description", nullptr, nullptr, &ForecastInfo::weatherDescription },
+        { "weather", "icon", nullptr, nullptr, &ForecastInfo::weatherIcon },
+    };
+};
+
+using CurrentWeatherHandler = SchemaHandler<WeatherInfo, CurrentWeatherSchema>;
+using ForecastHandler = SchemaHandler<ForecastInfo, ForecastSchema>;
@@ -0,0 +1,205 @@
+/**
+ * @file ForecastBenchmark.cpp
+ * @brief Per-day min/max/sum/mean over all cities: ForecastColumns against vectors of ForecastInfo
+ *
+ * Usage: ForecastBenchmark [cities] [passes]
+ * Builds 40-step forecasts (5 days in 3 hour steps, starting at noon UTC) for
+ * every city, once as the app stores them, one std::vector<ForecastInfo> per
+ * city, and once as ForecastColumns. Then aggregates temperature alone and
+ * all four numeric fields per city and UTC day with both, reporting the best
+ * pass, and checks that both produce the same numbers.
+ */
+#include "ForecastColumns.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static const long long kStartTime = 1700006400 + 4 * 10800;    // Noon UTC
+static const size_t kSteps = 40;
+
+static const char* const kConditions[] = { "Clear", "Clouds", "Rain", "Snow", "Mist" };
+static const char* const kDescriptions[] = {
+    "clear sky over the whole region", "broken clouds in the late hours",
+    "moderate rain through the afternoon", "light snow turning to sleet", "mist along the coast early on" };
+
+static std::vector<std::vector<ForecastInfo>> makeForecasts(size_t cities) {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> noise(-1.0, 1.0);
+    std::vector<std::vector<ForecastInfo>> forecasts(cities);
+    for (size_t city = 0; city < cities; ++city) {
+        double climate = 30.0 * noise(random);
+        forecasts[city].resize(kSteps);
+        for (size_t step = 0; step < kSteps; ++step) {
+            ForecastInfo& item = forecasts[city][step];
+            size_t kind = random() % 5;
+            item.dateTime = kStartTime + static_cast<long long>(step) * 10800;
+            item.temperature = climate + 5.0 * std::sin(step * 0.785) + noise(random);
+            item.feelsLike = item.temperature - 1.5;
+            item.tempMin = item.temperature - 0.5;
+            item.tempMax = item.temperature + 0.5;
+            item.pressure = 1013.0 + 15.0 * noise(random);
+            item.humidity = 60.0 + 35.0 * noise(random);
+            item.windSpeed = 6.0 + 5.0 * noise(random);
+            item.windDeg = 180.0 + 180.0 * noise(random);
+            item.weatherMain = kConditions[kind];
+            item.weatherDescription = kDescriptions[kind];
+            item.weatherIcon = "10d";
+        }
+    }
+    return forecasts;
+}
+
+static long long dayOf(long long time) {
+    return time / 86400;   // Benchmark times are all positive
+}
+
+// What the app can do today: walk every city's entries, bucketing them by day
+static DailyStats dailyAos(const std::vector<std::vector<ForecastInfo>>& forecasts, double ForecastInfo::* field) {
+    size_t cities = forecasts.size();
+    long long firstDay = dayOf(kStartTime);
+    size_t days = static_cast<size_t>(dayOf(kStartTime + (kSteps - 1) * 10800) - firstDay) + 1;
+
+    DailyStats stats;
+    stats.stride = cities;
+    for (size_t day = 0; day < days; ++day) {
+        stats.dayStart.push_back((firstDay + static_cast<long long>(day)) * 86400);
+    }
+    stats.min.assign(days * cities, std::numeric_limits<float>::quiet_NaN());
+    stats.max.assign(days * cities, std::numeric_limits<float>::quiet_NaN());
+    stats.sum.assign(days * cities, 0.0f);
+    stats.mean.assign(days * cities, std::numeric_limits<float>::quiet_NaN());
+
+    std::vector<size_t> counts(days);
+    std::vector<double> sums(days);
+    std::vector<double> lows(days);
+    std::vector<double> highs(days);
+    for (size_t city = 0; city < cities; ++city) {
+        std::fill(counts.begin(), counts.end(), 0);
+        std::fill(sums.begin(), sums.end(), 0.0);
+        for (const auto& item : forecasts[city]) {
+            size_t day = static_cast<size_t>(dayOf(item.dateTime) - firstDay);
+            double value = item.*field;
+            lows[day] = counts[day] == 0 ? value : std::min(lows[day], value);
+            highs[day] = counts[day] == 0 ? value : std::max(highs[day], value);
+            sums[day] += value;
+            counts[day]++;
+        }
+        for (size_t day = 0; day < days; ++day) {
+            size_t at = stats.index(day, static_cast<CityId>(city));
+            stats.sum[at] = static_cast<float>(sums[day]);
+            if (counts[day] > 0) {
+                stats.min[at] = static_cast<float>(lows[day]);
+                stats.max[at] = static_cast<float>(highs[day]);
+                stats.mean[at] = static_cast<float>(sums[day] / counts[day]);
+            }
+        }
+    }
+    return stats;
+}
+
+// Largest difference between the two results, relative to the value's size
+static double compare(const DailyStats& aos, const DailyStats& soa, size_t cities) {
+    double worst = 0;
+    auto check = [&worst](float a, float b) {
+        if (std::isnan(a) != std::isnan(b)) {
+            worst = std::numeric_limits<double>::infinity();
+        }
+        else if (!std::isnan(a)) {
+            worst = std::max(worst, std::fabs(double(a) - double(b)) / std::max(1.0, std::fabs(double(a))));
+        }
+    };
+    for (size_t day = 0; day < aos.dayStart.size(); ++day) {
+        for (CityId city = 0; city < cities; ++city) {
+            size_t a = aos.index(day, city);
+            size_t b = soa.index(day, city);
+            check(aos.min[a], soa.min[b]);
+            check(aos.max[a], soa.max[b]);
+            check(aos.sum[a], soa.sum[b]);
+            check(aos.mean[a], soa.mean[b]);
+        }
+    }
+    return worst;
+}
+
+template<class F>
+static double bestMillis(size_t passes, F&& pass) {
+    double best = std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < passes; ++i) {
+        auto start = Clock::now();
+        pass();
+        best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        size_t cities = argc > 1 ? std::stoul(argv[1]) : 10000;
+        size_t passes = argc > 2 ? std::stoul(argv[2]) : 20;
+
+        auto forecasts = makeForecasts(cities);
+        auto buildStart = Clock::now();
+        ForecastColumns columns(cities, kStartTime, kSteps);
+        for (size_t city = 0; city < cities; ++city) {
+            columns.assign(static_cast<CityId>(city), forecasts[city]);
+        }
+        double buildMillis = std::chrono::duration<double, std::milli>(Clock::now() - buildStart).count();
+
+        size_t points = cities * kSteps;
+        std::cout << cities << " cities x " << kSteps << " steps, " << columns.dayCount() << " days, best of "
+            << passes << " passes" << std::endl;
+        std::cout << "ForecastInfo " << sizeof(ForecastInfo) << " bytes per step (strings inline), columns "
+            << 4 * sizeof(float) + sizeof(WeatherCondition) << " bytes per step; columns built in "
+            << std::fixed << std::setprecision(1) << buildMillis << " ms" << std::endl;
+
+        const ForecastField fields[] = { ForecastField::Temperature, ForecastField::Humidity, ForecastField::WindSpeed, ForecastField::Pressure };
+        double ForecastInfo::* const members[] = { &ForecastInfo::temperature, &ForecastInfo::humidity, &ForecastInfo::windSpeed, &ForecastInfo::pressure };
+
+        double worst = 0;
+        for (size_t i = 0; i < 4; ++i) {
+            worst = std::max(worst, compare(dailyAos(forecasts, members[i]), columns.daily(fields[i]), cities));
+        }
+
+        double sink = 0;
+        double aosOne = bestMillis(passes, [&]() { sink += dailyAos(forecasts, members[0]).mean[0]; });
+        double soaOne = bestMillis(passes, [&]() { sink += columns.daily(fields[0]).mean[0]; });
+        double aosAll = bestMillis(passes, [&]() {
+            for (auto member : members) {
+                sink += dailyAos(forecasts, member).mean[0];
+            }
+            });
+        double soaAll = bestMillis(passes, [&]() {
+            for (auto field : fields) {
+                sink += columns.daily(field).mean[0];
+            }
+            });
+
+        std::cout << std::left << std::setw(14) << "aggregate" << std::right
+            << std::setw(12) << "AoS ms" << std::setw(12) << "SoA ms" << std::setw(10) << "speedup"
+            << std::setw(16) << "SoA Mpoints/s" << std::endl;
+        auto row = [points](const char* name, double aos, double soa, size_t fieldCount) {
+            std::cout << std::left << std::setw(14) << name << std::right << std::fixed << std::setprecision(2)
+                << std::setw(12) << aos << std::setw(12) << soa << std::setprecision(1) << std::setw(9) << aos / soa << "x"
+                << std::setprecision(0) << std::setw(16) << points * fieldCount / soa / 1000.0 << std::endl;
+        };
+        row("temperature", aosOne, soaOne, 1);
+        row("all 4 fields", aosAll, soaAll, 4);
+        std::cout << "largest relative difference " << std::scientific << std::setprecision(1) << worst << std::endl;
+        if (std::isnan(sink)) {
+            std::cout << sink << std::endl;
+        }
+        return worst < 1e-4 ? 0 : 1;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,169 @@
+/**
+ * @file HistoryBenchmark.cpp
+ * @brief Bytes per point, append rate and range scan speed of WeatherHistory
+ *
+ * Usage: HistoryBenchmark [cities] [days] [payload directory]
+ * Feeds every city an observation every ten minutes, with the provider's
+ * precision: temperature and wind in hundredths, humidity and pressure whole.
+ * The series follow a daily cycle plus drift, and the observation times
+ * jitter by up to a minute. Also compresses the 40 steps of the recorded
+ * forecast payload as a series of its own. Every point is read back and
+ * compared.
+ */
+#include "WeatherHistory.h"
+#include "json.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using json = nlohmann::json;
+
+static const long long kStartTime = 1741305600;    // 2025-03-07 00:00 UTC
+static const long long kInterval = 600;
+
+static float hundredths(double value) {
+    return static_cast<float>(std::round(value * 100.0) / 100.0);
+}
+
+static float whole(double value) {
+    return static_cast<float>(std::round(value));
+}
+
+static std::vector<HistoryPoint> makeSeries(size_t points, std::mt19937& random) {
+    std::uniform_real_distribution<double> noise(-1.0, 1.0);
+    double climate = 15.0 + 12.0 * noise(random);
+    double pressure = 1013.0 + 10.0 * noise(random);
+    double humidity = 60.0 + 20.0 * noise(random);
+    double wind = 4.0 + 3.0 * noise(random);
+    std::vector<HistoryPoint> series(points);
+    for (size_t i = 0; i < points; ++i) {
+        long long time = kStartTime + static_cast<long long>(i) * kInterval + static_cast<long long>(random() % 61) - 30;
+        double hour = double(time % 86400) / 3600.0;
+        climate += 0.02 * noise(random);
+        pressure = std::clamp(pressure + 0.15 * noise(random), 980.0, 1045.0);
+        humidity = std::clamp(humidity + 0.8 * noise(random), 10.0, 100.0);
+        wind = std::clamp(wind + 0.3 * noise(random), 0.0, 25.0);
+        series[i].time = time;
+        series[i].temperature = hundredths(climate + 5.0 * std::sin((hour - 9.0) * 3.14159265 / 12.0) + 0.1 * noise(random));
+        series[i].humidity = whole(humidity);
+        series[i].pressure = whole(pressure);
+        series[i].windSpeed = hundredths(wind);
+    }
+    return series;
+}
+
+static std::vector<HistoryPoint> loadForecastSeries(const std::string& directory) {
+    std::ifstream file(directory + "/forecast.json");
+    if (!file) {
+        throw std::runtime_error("Cannot open " + directory + "/forecast.json");
+    }
+    json data = json::parse(file);
+    std::vector<HistoryPoint> series;
+    for (auto& item : data["list"]) {
+        series.push_back({ item["dt"].get<long long>(), item["main"]["temp"].get<float>(),
+            item["main"]["humidity"].get<float>(), item["main"]["pressure"].get<float>(), item["wind"]["speed"].get<float>() });
+    }
+    return series;
+}
+
+static bool samePoint(const HistoryPoint& a, const HistoryPoint& b) {
+    return a.time == b.time && a.temperature == b.temperature && a.humidity == b.humidity &&
+        a.pressure == b.pressure && a.windSpeed == b.windSpeed;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        size_t cities = argc > 1 ? std::stoul(argv[1]) : 2000;
+        size_t days = argc > 2 ? std::stoul(argv[2]) : 21;
+        std::string payloads = argc > 3 ? argv[3] : "bench/payloads";
+        size_t perCity = days * 86400 / kInterval;
+        const double rawBytes = sizeof(long long) + 4 * sizeof(float);
+
+        std::mt19937 random(7);
+        std::vector<std::vector<HistoryPoint>> series;
+        for (size_t city = 0; city < cities; ++city) {
+            series.push_back(makeSeries(perCity, random));
+        }
+
+        // Interleaved by time, as refreshes arrive
+        WeatherHistory history(size_t(1) << 32);
+        auto start = Clock::now();
+        for (size_t i = 0; i < perCity; ++i) {
+            for (size_t city = 0; city < cities; ++city) {
+                history.append(static_cast<CityId>(city), series[city][i]);
+            }
+        }
+        double appendSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+        size_t points = history.pointCount();
+
+        std::vector<HistoryPoint> out;
+        bool exact = true;
+        start = Clock::now();
+        for (size_t city = 0; city < cities; ++city) {
+            out.clear();
+            history.range(static_cast<CityId>(city), series[city].front().time, series[city].back().time, out);
+            exact = exact && out.size() == perCity && std::equal(out.begin(), out.end(), series[city].begin(), samePoint);
+        }
+        double scanSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        // The last day of every city, which skips all older blocks
+        long long lastDay = kStartTime + static_cast<long long>(days - 1) * 86400;
+        size_t dayPoints = 0;
+        start = Clock::now();
+        for (size_t city = 0; city < cities; ++city) {
+            out.clear();
+            history.range(static_cast<CityId>(city), lastDay, lastDay + 86399, out);
+            dayPoints += out.size();
+        }
+        double daySeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::cout << cities << " cities x " << days << " days every " << kInterval / 60 << " min: " << points << " points, "
+            << (exact ? "all read back exactly" : "MISMATCH") << std::endl;
+        std::cout << std::fixed << std::setprecision(2)
+            << "raw " << rawBytes << " B/point, encoded " << double(history.encodedBytes()) / points
+            << " B/point, in blocks " << double(history.memoryUsage()) / points << " B/point ("
+            << history.memoryUsage() / (1024.0 * 1024.0) << " MiB)" << std::endl;
+        std::cout << std::setprecision(1)
+            << "append " << points / appendSeconds / 1e6 << " M points/s, full scan " << points / scanSeconds / 1e6
+            << " M points/s, last day of every city " << daySeconds * 1000.0 << " ms (" << dayPoints << " points)" << std::endl;
+
+        // A budget of a quarter of that keeps every city's latest observations
+        WeatherHistory bounded(history.memoryUsage() / 4);
+        for (size_t i = 0; i < perCity; ++i) {
+            for (size_t city = 0; city < cities; ++city) {
+                bounded.append(static_cast<CityId>(city), series[city][i]);
+            }
+        }
+        out.clear();
+        bounded.range(0, lastDay, lastDay + 86399, out);
+        bool recent = !out.empty() && samePoint(out.back(), series[0].back());
+        std::cout << "quarter budget: " << bounded.memoryUsage() / (1024.0 * 1024.0) << " MiB, "
+            << bounded.pointCount() << " points kept, latest " << (recent ? "intact" : "LOST") << std::endl;
+
+        std::vector<HistoryPoint> recorded = loadForecastSeries(payloads);
+        WeatherHistory payload;
+        for (const auto& point : recorded) {
+            payload.append(0, point);
+        }
+        out.clear();
+        payload.range(0, recorded.front().time, recorded.back().time, out);
+        bool payloadExact = out.size() == recorded.size() && std::equal(out.begin(), out.end(), recorded.begin(), samePoint);
+        std::cout << std::setprecision(2) << "recorded forecast payload: " << recorded.size() << " points, encoded "
+            << double(payload.encodedBytes()) / recorded.size() << " B/point, "
+            << (payloadExact ? "read back exactly" : "MISMATCH") << std::endl;
+
+        return exact && recent && payloadExact ? 0 : 1;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
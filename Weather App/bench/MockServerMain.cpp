@@ -0,0 +1,130 @@
+/**
+ * @file MockServerMain.cpp
+ * @brief Runs MockWeatherServer until interrupted, for pointing the app or a benchmark at it
+ *
+ * Usage: MockWeatherServer [--port n] [--latency fixed|uniform|lognormal] [--median ms] [--p99 ms]
+ *        [--error-rate fraction] [--error-status code] [--rps n] [--burst n] [--max-age seconds]
+ *        [--threads n] [--payloads directory] [--tls certificate.pem]
+ * Then run the app with --base-url 127.0.0.1:<port>. --tls serves https:// with a
+ * self-signed certificate written to the given file; run the app with
+ * --base-url https://127.0.0.1:<port> --ca-file certificate.pem.
+ */
+#include "MockWeatherServer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+static std::atomic<bool> interrupted(false);
+
+static void onSignal(int) {
+    interrupted.store(true);
+}
+
+static LatencyDistribution::Shape parseShape(const std::string& name) {
+    if (name == "fixed") {
+        return LatencyDistribution::Shape::Fixed;
+    }
+    if (name == "uniform") {
+        return LatencyDistribution::Shape::Uniform;
+    }
+    if (name == "lognormal") {
+        return LatencyDistribution::Shape::LogNormal;
+    }
+    throw std::invalid_argument("Unknown latency distribution: " + name);
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        MockServerConfig config;
+        int port = 8080;
+        std::string certificateFile;
+
+        for (int i = 1; i < argc; ++i) {
+            std::string option = argv[i];
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + option);
+            }
+            std::string value = argv[++i];
+
+            if (option == "--port") {
+                port = std::stoi(value);
+            }
+            else if (option == "--latency") {
+                config.latency.shape = parseShape(value);
+            }
+            else if (option == "--median") {
+                config.latency.median = std::chrono::milliseconds(std::stoll(value));
+                config.latency.p99 = std::max(config.latency.p99, config.latency.median);
+            }
+            else if (option == "--p99") {
+                config.latency.p99 = std::chrono::milliseconds(std::stoll(value));
+            }
+            else if (option == "--error-rate") {
+                config.errorRate = std::stod(value);
+            }
+            else if (option == "--error-status") {
+                config.errorStatus = std::stoi(value);
+            }
+            else if (option == "--rps") {
+                config.requestsPerSecond = std::stod(value);
+            }
+            else if (option == "--burst") {
+                config.burst = std::stod(value);
+            }
+            else if (option == "--max-age") {
+                config.maxAgeSeconds = std::stoi(value);
+            }
+            else if (option == "--threads") {
+                config.threads = std::stoul(value);
+            }
+            else if (option == "--payloads") {
+                config.payloadDirectory = value;
+            }
+            else if (option == "--tls") {
+                config.tls = true;
+                certificateFile = value;
+            }
+            else {
+                throw std::invalid_argument("Unknown option: " + option);
+            }
+        }
+
+        MockWeatherServer server(config);
+        server.start("127.0.0.1", port);
+        if (config.tls) {
+            std::ofstream(certificateFile, std::ios::binary) << server.getCertificatePem();
+            std::cout << "Certificate written to " << certificateFile << std::endl;
+        }
+        std::cout << "Serving on " << server.getBaseUrl() << ", Ctrl+C to stop" << std::endl;
+
+        std::signal(SIGINT, onSignal);
+        std::signal(SIGTERM, onSignal);
+
+        // Report the counters every few seconds while they change
+        unsigned long long reported = 0;
+        auto lastReport = std::chrono::steady_clock::now();
+        while (!interrupted.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            auto stats = server.getStats();
+            if (stats.requests != reported && std::chrono::steady_clock::now() - lastReport >= std::chrono::seconds(5)) {
+                std::cout << stats.requests << " requests: " << stats.served << " served, " << stats.errors << " errors, "
+                    << stats.throttled << " throttled, " << stats.unauthorized << " unauthorized" << std::endl;
+                reported = stats.requests;
+                lastReport = std::chrono::steady_clock::now();
+            }
+        }
+
+        server.stop();
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,364 @@
+/**
+ * @file MockWeatherServer.cpp
+ * @brief Implementation of the MockWeatherServer class
+ */
+#include "MockWeatherServer.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509v3.h>
+#endif
+
+using json = nlohmann::json;
+
+// Used when the recorded payloads can't be found
+static const char* kSyntheticCurrentWeather = R"({"coord":{"lon":34.78,"lat":32.08},
+"weather":[{"id":801,"main":"Clouds","description":"few clouds","icon":"02d"}],"base":"stations",
+"main":{"temp":21.4,"feels_like":21.0,"temp_min":20.5,"temp_max":22.2,"pressure":1016,"humidity":56},
+"visibility":10000,"wind":{"speed":4.1,"deg":290},"clouds":{"all":20},"dt":1741352400,
+"sys":{"country":"IL","sunrise":1741320000,"sunset":1741362000},"timezone":7200,"id":293397,"name":"Tel Aviv","cod":200})";
+
+static json readPayload(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return json();
+    }
+    std::stringstream ss;
+    ss << file.rdbuf();
+    return json::parse(ss.str(), nullptr, false);
+}
+
+// Stable positive ID per city name, in the range of the provider's IDs
+static long long cityIdOf(const std::string& name) {
+    return static_cast<long long>(std::hash<std::string>{}(name) % 9000000) + 1000000;
+}
+
+MockWeatherServer::MockWeatherServer(const MockServerConfig& config)
+    : config(config), port(0), random(std::random_device{}()), tokens(std::max(1.0, config.burst)),
+    lastRefill(std::chrono::steady_clock::now()), requests(0), served(0), errors(0), throttled(0), unauthorized(0) {
+    loadPayloads();
+    createServer();
+
+    size_t threads = std::max<size_t>(1, config.threads);
+    server->new_task_queue = [threads] { return new httplib::ThreadPool(threads); };
+    server->set_keep_alive_max_count(std::max<size_t>(1, config.keepAliveRequests));
+    server->set_tcp_nodelay(true);
+
+    server->set_pre_routing_handler([this](const httplib::Request& req, httplib::Response& res) { return screen(req, res); });
+    server->Get("/data/2.5/weather", [this](const httplib::Request& req, httplib::Response& res) { handleWeather(req, res); });
+    server->Get("/data/2.5/group", [this](const httplib::Request& req, httplib::Response& res) { handleGroup(req, res); });
+    server->Get("/data/2.5/forecast", [this](const httplib::Request& req, httplib::Response& res) { handleForecast(req, res); });
+    server->Get("/geo/1.0/direct", [this](const httplib::Request& req, httplib::Response& res) { handleGeocoding(req, res); });
+}
+
+MockWeatherServer::~MockWeatherServer() {
+    stop();
+}
+
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+// Self-signed P-256 certificate for the loopback names, valid for a day
+static bool createCertificate(EVP_PKEY*& key, X509*& certificate) {
+    key = EVP_EC_gen("P-256");
+    certificate = X509_new();
+    if (!key || !certificate) {
+        return false;
+    }
+
+    long serial = static_cast<long>(std::random_device{}() & 0x7fffffff);
+    X509_set_version(certificate, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(certificate), serial);
+    X509_gmtime_adj(X509_getm_notBefore(certificate), -3600);
+    X509_gmtime_adj(X509_getm_notAfter(certificate), 24 * 3600);
+    X509_set_pubkey(certificate, key);
+
+    X509_NAME* name = X509_get_subject_name(certificate);
+    // A distinct name per server, so a client trusting several of them finds the right issuer
+    std::string commonName = "MockWeatherServer " + std::to_string(serial);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>(commonName.c_str()), -1, -1, 0);
+    X509_set_issuer_name(certificate, name);
+
+    X509V3_CTX context;
+    X509V3_set_ctx_nodb(&context);
+    X509V3_set_ctx(&context, certificate, certificate, nullptr, nullptr, 0);
+    for (auto extension : { std::make_pair(NID_subject_alt_name, "IP:127.0.0.1,IP:::1,DNS:localhost"),
+                            std::make_pair(NID_basic_constraints, "critical,CA:TRUE") }) {
+        X509_EXTENSION* created = X509V3_EXT_conf_nid(nullptr, &context, extension.first, extension.second);
+        if (!created) {
+            return false;
+        }
+        X509_add_ext(certificate, created, -1);
+        X509_EXTENSION_free(created);
+    }
+    return X509_sign(certificate, key, EVP_sha256()) > 0;
+}
+#endif
+
+void MockWeatherServer::createServer() {
+    if (!config.tls) {
+        server = std::make_unique<httplib::Server>();
+        return;
+    }
+
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+    EVP_PKEY* key = nullptr;
+    X509* certificate = nullptr;
+    bool created = createCertificate(key, certificate);
+    if (created) {
+        BIO* pem = BIO_new(BIO_s_mem());
+        PEM_write_bio_X509(pem, certificate);
+        char* data = nullptr;
+        long length = BIO_get_mem_data(pem, &data);
+        certificatePem.assign(data, static_cast<size_t>(length));
+        BIO_free(pem);
+
+        // The server context takes its own references
+        auto tlsServer = std::make_unique<httplib::SSLServer>(certificate, key);
+        created = tlsServer->is_valid();
+        server = std::move(tlsServer);
+    }
+    X509_free(certificate);
+    EVP_PKEY_free(key);
+    if (!created) {
+        throw std::runtime_error("Failed to create the mock server certificate");
+    }
+#else
+    throw std::runtime_error("The TLS mock server needs a build with CPPHTTPLIB_OPENSSL_SUPPORT");
+#endif
+}
+
+void MockWeatherServer::loadPayloads() {
+    currentTemplate = readPayload(config.payloadDirectory + "/current_weather.json");
+    if (!currentTemplate.is_object()) {
+        currentTemplate = json::parse(kSyntheticCurrentWeather);
+    }
+
+    forecastTemplate = readPayload(config.payloadDirectory + "/forecast.json");
+    if (!forecastTemplate.is_object() || !forecastTemplate["list"].is_array()) {
+        // 40 three-hour steps derived from the current weather
+        forecastTemplate = json{ { "cod", "200" }, { "message", 0 }, { "list", json::array() } };
+        long long start = currentTemplate.value("dt", 1741352400LL);
+        for (int i = 0; i < 40; ++i) {
+            json item;
+            item["dt"] = start + i * 3 * 3600;
+            item["main"] = currentTemplate["main"];
+            item["main"]["temp"] = currentTemplate["main"].value("temp", 20.0) + 4.0 * std::sin(i * 3.14159265 / 4);
+            item["weather"] = currentTemplate["weather"];
+            item["wind"] = currentTemplate["wind"];
+            item["pop"] = 0.1;
+            forecastTemplate["list"].push_back(item);
+        }
+        forecastTemplate["city"] = json{ { "name", currentTemplate.value("name", "") },
+            { "country", currentTemplate["sys"].value("country", "") } };
+    }
+    forecastTemplate["cnt"] = forecastTemplate["list"].size();
+}
+
+int MockWeatherServer::start(const std::string& host, int port) {
+    if (listener.joinable()) {
+        throw std::runtime_error("Mock server already running");
+    }
+
+    this->port = port == 0 ? server->bind_to_any_port(host) : (server->bind_to_port(host, port) ? port : -1);
+    if (this->port < 0) {
+        throw std::runtime_error("Failed to bind mock server to " + host + ":" + std::to_string(port));
+    }
+    this->host = host;
+
+    listener = std::thread([this] { server->listen_after_bind(); });
+    server->wait_until_ready();
+    return this->port;
+}
+
+void MockWeatherServer::stop() {
+    if (listener.joinable()) {
+        server->stop();
+        listener.join();
+    }
+}
+
+std::string MockWeatherServer::getBaseUrl() const {
+    return (config.tls ? "https://" : "") + host + ":" + std::to_string(port);
+}
+
+MockServerStats MockWeatherServer::getStats() const {
+    MockServerStats stats;
+    stats.requests = requests.load();
+    stats.served = served.load();
+    stats.errors = errors.load();
+    stats.throttled = throttled.load();
+    stats.unauthorized = unauthorized.load();
+    return stats;
+}
+
+std::chrono::milliseconds MockWeatherServer::sampleLatency() {
+    const auto& latency = config.latency;
+    double median = static_cast<double>(latency.median.count());
+    double p99 = static_cast<double>(std::max(latency.p99, latency.median).count());
+
+    std::lock_guard<std::mutex> lock(randomMutex);
+    double delay = median;
+    switch (latency.shape) {
+    case LatencyDistribution::Shape::Fixed:
+        break;
+    case LatencyDistribution::Shape::Uniform:
+        delay = std::uniform_real_distribution<double>(std::max(0.0, 2 * median - p99), p99)(random);
+        break;
+    case LatencyDistribution::Shape::LogNormal:
+        if (median > 0) {
+            // z of the 99th percentile of the standard normal distribution
+            double sigma = std::log(p99 / median) / 2.326;
+            delay = std::lognormal_distribution<double>(std::log(median), sigma)(random);
+        }
+        break;
+    }
+    return std::chrono::milliseconds(static_cast<long long>(delay));
+}
+
+bool MockWeatherServer::injectError() {
+    if (config.errorRate <= 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(randomMutex);
+    return std::bernoulli_distribution(std::min(1.0, config.errorRate))(random);
+}
+
+bool MockWeatherServer::admit(int& retryAfterSeconds) {
+    if (config.requestsPerSecond <= 0) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(throttleMutex);
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - lastRefill).count();
+    lastRefill = now;
+    tokens = std::min(std::max(1.0, config.burst), tokens + elapsed * config.requestsPerSecond);
+    if (tokens >= 1.0) {
+        tokens -= 1.0;
+        return true;
+    }
+    retryAfterSeconds = static_cast<int>(std::ceil((1.0 - tokens) / config.requestsPerSecond));
+    return false;
+}
+
+httplib::Server::HandlerResponse MockWeatherServer::screen(const httplib::Request& req, httplib::Response& res) {
+    requests++;
+
+    auto delay = sampleLatency();
+    if (delay.count() > 0) {
+        std::this_thread::sleep_for(delay);
+    }
+
+    if (!req.has_param("appid") || req.get_param_value("appid").empty()) {
+        unauthorized++;
+        res.status = 401;
+        res.set_content(R"({"cod":401,"message":"Invalid API key."})", "application/json");
+        return httplib::Server::HandlerResponse::Handled;
+    }
+
+    int retryAfter = 1;
+    if (!admit(retryAfter)) {
+        throttled++;
+        res.status = 429;
+        res.set_header("Retry-After", std::to_string(retryAfter));
+        res.set_content(R"({"cod":429,"message":"Your account is temporary blocked due to exceeding of requests limitation."})",
+            "application/json");
+        return httplib::Server::HandlerResponse::Handled;
+    }
+
+    if (injectError()) {
+        errors++;
+        res.status = config.errorStatus;
+        res.set_content(R"({"cod":)" + std::to_string(config.errorStatus) + R"(,"message":"Injected error"})", "application/json");
+        return httplib::Server::HandlerResponse::Handled;
+    }
+    return httplib::Server::HandlerResponse::Unhandled;
+}
+
+void MockWeatherServer::reply(httplib::Response& res, const json& body) {
+    served++;
+    if (config.maxAgeSeconds >= 0) {
+        res.set_header("Cache-Control", "max-age=" + std::to_string(config.maxAgeSeconds));
+    }
+    res.set_content(body.dump(), "application/json");
+}
+
+json MockWeatherServer::currentWeatherFor(const std::string& query, long long id) const {
+    // "City" or "City, CC"
+    std::string name = query;
+    std::string country;
+    auto comma = query.find(',');
+    if (comma != std::string::npos) {
+        name = query.substr(0, comma);
+        auto start = query.find_first_not_of(' ', comma + 1);
+        if (start != std::string::npos) {
+            country = query.substr(start);
+        }
+    }
+
+    json weather = currentTemplate;
+    weather["name"] = name;
+    weather["id"] = id;
+    if (!country.empty()) {
+        weather["sys"]["country"] = country;
+    }
+    return weather;
+}
+
+void MockWeatherServer::handleWeather(const httplib::Request& req, httplib::Response& res) {
+    std::string query = req.get_param_value("q");
+    if (query.empty()) {
+        res.status = 400;
+        res.set_content(R"({"cod":"400","message":"Nothing to geocode"})", "application/json");
+        return;
+    }
+    reply(res, currentWeatherFor(query, cityIdOf(query)));
+}
+
+void MockWeatherServer::handleGroup(const httplib::Request& req, httplib::Response& res) {
+    json list = json::array();
+    std::stringstream ids(req.get_param_value("id"));
+    std::string id;
+    while (std::getline(ids, id, ',')) {
+        if (!id.empty()) {
+            list.push_back(currentWeatherFor("City" + id, std::atoll(id.c_str())));
+        }
+    }
+    reply(res, json{ { "cnt", list.size() }, { "list", std::move(list) } });
+}
+
+void MockWeatherServer::handleForecast(const httplib::Request& req, httplib::Response& res) {
+    std::string query = req.get_param_value("q");
+    size_t count = forecastTemplate["list"].size();
+    if (req.has_param("cnt")) {
+        count = std::min(count, static_cast<size_t>(std::max(0, std::atoi(req.get_param_value("cnt").c_str()))));
+    }
+
+    json forecast = forecastTemplate;
+    auto& list = forecast["list"];
+    list.erase(list.begin() + count, list.end());
+    forecast["cnt"] = count;
+    forecast["city"]["name"] = query;
+    forecast["city"]["id"] = cityIdOf(query);
+    reply(res, forecast);
+}
+
+void MockWeatherServer::handleGeocoding(const httplib::Request& req, httplib::Response& res) {
+    static const char* kCountries[] = { "IL", "US", "GB", "FR", "DE" };
+
+    std::string query = req.get_param_value("q");
+    int limit = req.has_param("limit") ? std::atoi(req.get_param_value("limit").c_str()) : 5;
+    limit = std::max(0, std::min(limit, 5));
+
+    json matches = json::array();
+    for (int i = 0; i < limit && !query.empty(); ++i) {
+        matches.push_back(json{ { "name", query }, { "country", kCountries[i] },
+            { "lat", 32.08 + i }, { "lon", 34.78 - i * 10 } });
+    }
+    reply(res, matches);
+}
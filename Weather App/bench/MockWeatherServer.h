@@ -0,0 +1,137 @@
+/**
+ * @file MockWeatherServer.h
+ * @brief Local stand-in for the OpenWeatherMap endpoints WeatherAPI uses
+ */
+#pragma once
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <memory>
+#include "httplib.h"
+#include "json.hpp"
+
+/**
+ * @struct LatencyDistribution
+ * @brief Delay added before every response
+ *
+ * Fixed waits the median. Uniform draws from median +/- (p99 - median).
+ * LogNormal has the given median and 99th percentile, which gives the long
+ * tail of a real provider.
+ */
+struct LatencyDistribution {
+    enum class Shape { Fixed, Uniform, LogNormal };
+
+    Shape shape = Shape::Fixed;
+    std::chrono::milliseconds median{ 20 };
+    std::chrono::milliseconds p99{ 20 };
+};
+
+/**
+ * @struct MockServerConfig
+ * @brief Behaviour of the stand-in server
+ */
+struct MockServerConfig {
+    std::string payloadDirectory = "bench/payloads";   // Recorded current_weather.json and forecast.json; synthetic when missing
+    LatencyDistribution latency;
+    double errorRate = 0.0;             // Fraction of requests answered with errorStatus
+    int errorStatus = 503;
+    double requestsPerSecond = 0.0;     // Beyond this rate requests get 429 with Retry-After; 0 disables throttling
+    double burst = 1.0;                 // Requests an idle server accepts at once when throttling
+    int maxAgeSeconds = -1;             // Cache-Control max-age of successful responses; negative sends none
+    size_t threads = 256;               // Requests answered at once; each one waiting out its latency holds a thread
+    size_t keepAliveRequests = 100000;  // Requests a connection carries before the server closes it; 1 disables keep-alive
+    bool tls = false;                   // Serve https:// with a self-signed certificate for 127.0.0.1 and localhost
+};
+
+/**
+ * @struct MockServerStats
+ * @brief Counters of the requests the server answered
+ */
+struct MockServerStats {
+    unsigned long long requests = 0;
+    unsigned long long served = 0;          // 200 responses
+    unsigned long long errors = 0;          // Injected errors
+    unsigned long long throttled = 0;       // 429 responses
+    unsigned long long unauthorized = 0;    // Requests without an appid
+};
+
+/**
+ * @class MockWeatherServer
+ * @brief Serves weather, group, forecast and geocoding requests on a local port
+ *
+ * Responses are built from the recorded payloads with the requested city
+ * substituted, so different cities get different cache entries and IDs. Every
+ * request first waits out a latency drawn from the configured distribution,
+ * then may be throttled or answered with an injected error.
+ *
+ * With config.tls (and CPPHTTPLIB_OPENSSL_SUPPORT) a certificate is generated
+ * at construction; clients trust it through getCertificatePem().
+ */
+class MockWeatherServer {
+private:
+    MockServerConfig config;
+    std::unique_ptr<httplib::Server> server;
+    std::string certificatePem;
+    std::thread listener;
+    std::string host;
+    int port;
+
+    nlohmann::json currentTemplate;
+    nlohmann::json forecastTemplate;
+
+    std::mutex randomMutex;
+    std::mt19937 random;
+
+    std::mutex throttleMutex;
+    double tokens;
+    std::chrono::steady_clock::time_point lastRefill;
+
+    std::atomic<unsigned long long> requests;
+    std::atomic<unsigned long long> served;
+    std::atomic<unsigned long long> errors;
+    std::atomic<unsigned long long> throttled;
+    std::atomic<unsigned long long> unauthorized;
+
+    void loadPayloads();
+    void createServer();
+    std::chrono::milliseconds sampleLatency();
+    bool injectError();
+    bool admit(int& retryAfterSeconds);
+    httplib::Server::HandlerResponse screen(const httplib::Request& req, httplib::Response& res);
+    void reply(httplib::Response& res, const nlohmann::json& body);
+
+    nlohmann::json currentWeatherFor(const std::string& query, long long id) const;
+    void handleWeather(const httplib::Request& req, httplib::Response& res);
+    void handleGroup(const httplib::Request& req, httplib::Response& res);
+    void handleForecast(const httplib::Request& req, httplib::Response& res);
+    void handleGeocoding(const httplib::Request& req, httplib::Response& res);
+
+public:
+    explicit MockWeatherServer(const MockServerConfig& config = MockServerConfig());
+    ~MockWeatherServer();
+
+    MockWeatherServer(const MockWeatherServer&) = delete;
+    MockWeatherServer& operator=(const MockWeatherServer&) = delete;
+
+    /**
+     * @brief Start listening on a background thread
+     * @param port Port to bind, 0 for any free one
+     * @return The bound port
+     */
+    int start(const std::string& host = "127.0.0.1", int port = 0);
+    void stop();
+
+    /**
+     * @brief host:port of the running server (https://host:port with TLS), for WeatherAPI::setBaseUrl()
+     */
+    std::string getBaseUrl() const;
+
+    /**
+     * @brief PEM of the self-signed certificate, empty without TLS
+     */
+    const std::string& getCertificatePem() const { return certificatePem; }
+    MockServerStats getStats() const;
+};
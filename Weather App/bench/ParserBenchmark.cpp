@@ -0,0 +1,182 @@
+/**
+ * @file ParserBenchmark.cpp
+ * @brief Parse throughput of the schema parser against the nlohmann DOM path on recorded payloads
+ *
+ * Usage: ParserBenchmark [payload directory] (defaults to bench/payloads)
+ */
+#include "JsonStreamReader.h"
+#include "WeatherSchema.h"
+#include "json.hpp"
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+// Reference implementation: the DOM based parsing WeatherAPI used before the schema parser
+static WeatherInfo parseCurrentWeatherDom(const std::string& body) {
+    json data = json::parse(body);
+    WeatherInfo info{};
+
+    info.cityId = data.value("id", 0LL);
+    info.cityName = data["name"].get<std::string>();
+    info.countryCode = data["sys"]["country"].get<std::string>();
+    info.temperature = data["main"]["temp"].get<double>();
+    info.feelsLike = data["main"]["feels_like"].get<double>();
+    info.tempMin = data["main"]["temp_min"].get<double>();
+    info.tempMax = data["main"]["temp_max"].get<double>();
+    info.pressure = data["main"]["pressure"].get<double>();
+    info.humidity = data["main"]["humidity"].get<double>();
+    if (!data["wind"].is_null()) {
+        info.windSpeed = data["wind"]["speed"].get<double>();
+        info.windDeg = data["wind"]["deg"].get<double>();
+    }
+    if (!data["weather"].empty()) {
+        info.weatherMain = data["weather"][0]["main"].get<std::string>();
+        info.weatherDescription = data["weather"][0]["description"].get<std::string>();
+        info.weatherIcon = data["weather"][0]["icon"].get<std::string>();
+    }
+    info.sunrise = data["sys"]["sunrise"].get<long long>();
+    info.sunset = data["sys"]["sunset"].get<long long>();
+    info.observedAt = data.value("dt", 0LL);
+    return info;
+}
+
+static std::vector<ForecastInfo> parseForecastDom(const std::string& body) {
+    json data = json::parse(body);
+    std::vector<ForecastInfo> forecastList;
+
+    for (auto& item : data["list"]) {
+        ForecastInfo forecast{};
+        forecast.dateTime = item["dt"].get<long long>();
+        forecast.temperature = item["main"]["temp"].get<double>();
+        forecast.feelsLike = item["main"]["feels_like"].get<double>();
+        forecast.tempMin = item["main"]["temp_min"].get<double>();
+        forecast.tempMax = item["main"]["temp_max"].get<double>();
+        forecast.pressure = item["main"]["pressure"].get<double>();
+        forecast.humidity = item["main"]["humidity"].get<double>();
+        if (!item["wind"].is_null()) {
+            forecast.windSpeed = item["wind"]["speed"].get<double>();
+            forecast.windDeg = item["wind"]["deg"].get<double>();
+        }
+        if (!item["weather"].empty()) {
+            forecast.weatherMain = item["weather"][0]["main"].get<std::string>();
+            forecast.weatherDescription = item["weather"][0]["description"].get<std::string>();
+            forecast.weatherIcon = item["weather"][0]["icon"].get<std::string>();
+        }
+        forecastList.push_back(forecast);
+    }
+    return forecastList;
+}
+
+template<class Handler, class Record>
+static std::vector<Record> parseWithSchema(const std::string& body, RecordLayout layout) {
+    std::vector<Record> records;
+    Handler handler(records, layout);
+    JsonStreamReader reader(handler);
+    if (!reader.feed(body.data(), body.size()) || !reader.finish()) {
+        throw std::runtime_error(reader.getError());
+    }
+    return records;
+}
+
+static std::string readFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    std::stringstream ss;
+    ss << file.rdbuf();
+    return ss.str();
+}
+
+static bool sameWeather(const WeatherInfo& a, const WeatherInfo& b) {
+    return a.cityId == b.cityId && a.cityName == b.cityName && a.countryCode == b.countryCode &&
+        a.temperature == b.temperature && a.feelsLike == b.feelsLike && a.tempMin == b.tempMin &&
+        a.tempMax == b.tempMax && a.pressure == b.pressure && a.humidity == b.humidity &&
+        a.windSpeed == b.windSpeed && a.windDeg == b.windDeg && a.weatherMain == b.weatherMain &&
+        a.weatherDescription == b.weatherDescription && a.weatherIcon == b.weatherIcon &&
+        a.sunrise == b.sunrise && a.sunset == b.sunset && a.observedAt == b.observedAt;
+}
+
+static bool sameForecast(const ForecastInfo& a, const ForecastInfo& b) {
+    return a.dateTime == b.dateTime && a.temperature == b.temperature && a.feelsLike == b.feelsLike &&
+        a.tempMin == b.tempMin && a.tempMax == b.tempMax && a.pressure == b.pressure &&
+        a.humidity == b.humidity && a.windSpeed == b.windSpeed && a.windDeg == b.windDeg &&
+        a.weatherMain == b.weatherMain && a.weatherDescription == b.weatherDescription &&
+        a.weatherIcon == b.weatherIcon;
+}
+
+// Runs the parse repeatedly for about a second and returns documents per second
+static double measure(const std::function<size_t()>& parse) {
+    using Clock = std::chrono::steady_clock;
+    size_t sink = 0;
+    long long iterations = 0;
+    auto start = Clock::now();
+    auto elapsed = Clock::duration::zero();
+    while (elapsed < std::chrono::seconds(1)) {
+        for (int i = 0; i < 100; ++i) {
+            sink += parse();
+        }
+        iterations += 100;
+        elapsed = Clock::now() - start;
+    }
+    if (sink == 0) {
+        std::cerr << "Parser produced no records" << std::endl;
+    }
+    return iterations / std::chrono::duration<double>(elapsed).count();
+}
+
+static void report(const std::string& name, size_t bytes, double domRate, double schemaRate) {
+    std::cout << std::left << std::setw(18) << name
+        << std::right << std::fixed << std::setprecision(1)
+        << std::setw(12) << domRate << std::setw(14) << schemaRate
+        << std::setw(10) << (domRate * bytes / 1e6) << std::setw(10) << (schemaRate * bytes / 1e6)
+        << std::setw(9) << std::setprecision(2) << (schemaRate / domRate) << "x" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        std::string directory = argc > 1 ? argv[1] : "bench/payloads";
+        std::string current = readFile(directory + "/current_weather.json");
+        std::string forecast = readFile(directory + "/forecast.json");
+
+        // Both paths must agree before their speed means anything
+        auto domWeather = parseCurrentWeatherDom(current);
+        auto schemaWeather = parseWithSchema<CurrentWeatherHandler, WeatherInfo>(current, RecordLayout::Document);
+        auto domForecast = parseForecastDom(forecast);
+        auto schemaForecast = parseWithSchema<ForecastHandler, ForecastInfo>(forecast, RecordLayout::ListItems);
+        bool forecastMatches = domForecast.size() == schemaForecast.size();
+        for (size_t i = 0; forecastMatches && i < domForecast.size(); ++i) {
+            forecastMatches = sameForecast(domForecast[i], schemaForecast[i]);
+        }
+        if (schemaWeather.size() != 1 || !sameWeather(domWeather, schemaWeather[0]) || !forecastMatches) {
+            std::cerr << "Schema parser output differs from the DOM parser" << std::endl;
+            return 1;
+        }
+
+        double domCurrent = measure([&] { return parseCurrentWeatherDom(current).cityName.size(); });
+        double schemaCurrent = measure([&] {
+            return parseWithSchema<CurrentWeatherHandler, WeatherInfo>(current, RecordLayout::Document).size();
+            });
+        double domFc = measure([&] { return parseForecastDom(forecast).size(); });
+        double schemaFc = measure([&] {
+            return parseWithSchema<ForecastHandler, ForecastInfo>(forecast, RecordLayout::ListItems).size();
+            });
+
+        std::cout << std::left << std::setw(18) << "payload"
+            << std::right << std::setw(12) << "dom doc/s" << std::setw(14) << "schema doc/s"
+            << std::setw(10) << "dom MB/s" << std::setw(10) << "sch MB/s" << std::setw(10) << "speedup" << std::endl;
+        report("current_weather", current.size(), domCurrent, schemaCurrent);
+        report("forecast (40)", forecast.size(), domFc, schemaFc);
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,119 @@
+/**
+ * @file RefreshBenchmark.cpp
+ * @brief Refresh throughput of WeatherAPI against a local MockWeatherServer
+ *
+ * Usage: RefreshBenchmark [cities] [rounds] [median ms] [p99 ms] [error rate] [https]
+ * Each round fetches the current weather and the forecast of every city, the
+ * way the app refreshes its list. Latency is log-normal with the given median
+ * and 99th percentile; errors are retried by WeatherAPI's default policy.
+ * With https the server uses a self-signed certificate the client trusts.
+ */
+#include "WeatherAPI.h"
+#include "MockWeatherServer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double percentile(std::vector<double> values, double fraction) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()))];
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        size_t cities = argc > 1 ? std::stoul(argv[1]) : 200;
+        int rounds = argc > 2 ? std::stoi(argv[2]) : 3;
+
+        MockServerConfig config;
+        config.latency.shape = LatencyDistribution::Shape::LogNormal;
+        config.latency.median = std::chrono::milliseconds(argc > 3 ? std::stoll(argv[3]) : 40);
+        config.latency.p99 = std::chrono::milliseconds(argc > 4 ? std::stoll(argv[4]) : 400);
+        config.errorRate = argc > 5 ? std::stod(argv[5]) : 0.0;
+        config.threads = 512;
+        config.tls = argc > 6 && std::string(argv[6]) == "https";
+
+        MockWeatherServer server(config);
+        server.start();
+
+        TlsOptions tls;
+        if (config.tls) {
+            tls.caFile = "refresh_benchmark_ca.pem";
+            std::ofstream(tls.caFile, std::ios::binary) << server.getCertificatePem();
+        }
+        WeatherAPI api("bench", nullptr, WeatherAPI::createDefaultTransport(tls));
+        if (config.tls) {
+            std::remove(tls.caFile.c_str());
+        }
+        api.setBaseUrl(server.getBaseUrl());
+        api.configureRateLimit(1e9, 1e6);
+        api.configureConnectionPool(64, std::chrono::seconds(30));
+        // Every round goes to the server instead of the cache
+        api.configureResponseCache(cities * 2, std::chrono::seconds(0));
+
+        std::cout << cities << " cities, " << rounds << " rounds, log-normal latency median "
+            << config.latency.median.count() << " ms p99 " << config.latency.p99.count() << " ms, error rate "
+            << config.errorRate << ", server " << server.getBaseUrl() << std::endl;
+        std::cout << std::setw(6) << "round" << std::setw(12) << "cities/s" << std::setw(10) << "p50 ms"
+            << std::setw(10) << "p99 ms" << std::setw(10) << "failed" << std::endl;
+
+        for (int round = 1; round <= rounds; ++round) {
+            std::vector<double> latenciesMs;
+            size_t failures = 0;
+            auto start = Clock::now();
+
+            std::vector<Future<WeatherInfo>> weather;
+            std::vector<Future<std::vector<ForecastInfo>>> forecasts;
+            for (size_t i = 0; i < cities; ++i) {
+                std::string city = "City" + std::to_string(i);
+                weather.push_back(api.getCurrentWeather(city, RequestPriority::Background));
+                forecasts.push_back(api.getForecast(city, 5, RequestPriority::Background));
+            }
+
+            // A city is refreshed once both of its responses arrived
+            for (size_t i = 0; i < cities; ++i) {
+                try {
+                    weather[i].get();
+                    forecasts[i].get();
+                }
+                catch (const std::exception&) {
+                    failures++;
+                }
+                latenciesMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+            }
+
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            std::cout << std::setw(6) << round << std::fixed << std::setprecision(0) << std::setw(12) << (cities / seconds)
+                << std::setprecision(1) << std::setw(10) << percentile(latenciesMs, 0.5)
+                << std::setw(10) << percentile(latenciesMs, 0.99) << std::setw(10) << failures << std::endl;
+        }
+
+        auto stats = server.getStats();
+        std::cout << "server: " << stats.requests << " requests, " << stats.served << " served, "
+            << stats.errors << " errors, " << stats.throttled << " throttled" << std::endl;
+
+        auto transfer = api.getTransferStats();
+        auto pool = api.getPoolStats();
+        std::cout << "connections: " << pool.misses << " opened, " << pool.tlsHandshakes << " full TLS handshakes, "
+            << pool.tlsResumptions << " resumed" << std::endl;
+
+        std::cout << "bodies: " << transfer.responses << " (" << transfer.compressedResponses << " compressed), "
+            << transfer.wireBytes << " bytes received, " << transfer.decodedBytes << " decoded, ratio "
+            << std::setprecision(1) << transfer.compressionRatio() << std::endl;
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
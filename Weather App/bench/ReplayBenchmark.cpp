@@ -0,0 +1,155 @@
+/**
+ * @file ReplayBenchmark.cpp
+ * @brief Record a refresh storm to a cassette, then replay it through WeatherAPI without a network
+ *
+ * Usage: ReplayBenchmark record <cassette> [cities] [base url]
+ *        ReplayBenchmark replay <cassette> [--fast]
+ * record refreshes the weather and forecast of every city against the given
+ * server, or an in-process MockWeatherServer. replay reissues the recorded
+ * requests at their original offsets (or all at once with --fast), answers
+ * them from the cassette and applies the results to a WeatherData, so the
+ * time measured is parse and update cost plus the recorded pacing.
+ */
+#include "WeatherAPI.h"
+#include "WeatherData.h"
+#include "CassetteTransport.h"
+#include "MockWeatherServer.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static void configureForBenchmark(WeatherAPI& api, size_t cities) {
+    api.configureRateLimit(1e9, 1e6);
+    api.configureConnectionPool(64, std::chrono::seconds(30));
+    // Every request is sent (or replayed) instead of being answered by the cache
+    api.configureResponseCache(cities * 2 + 16, std::chrono::seconds(0));
+}
+
+static int record(const std::string& cassette, size_t cities, std::string baseUrl) {
+    MockWeatherServer server;
+    if (baseUrl.empty()) {
+        server.start();
+        baseUrl = server.getBaseUrl();
+    }
+
+    WeatherAPI api("bench", nullptr, std::make_unique<CassetteRecorder>(cassette, WeatherAPI::createDefaultTransport()));
+    api.setBaseUrl(baseUrl);
+    configureForBenchmark(api, cities);
+
+    std::vector<Future<WeatherInfo>> weather;
+    std::vector<Future<std::vector<ForecastInfo>>> forecasts;
+    for (size_t i = 0; i < cities; ++i) {
+        std::string city = "City" + std::to_string(i);
+        weather.push_back(api.getCurrentWeather(city, RequestPriority::Background));
+        forecasts.push_back(api.getForecast(city, 5, RequestPriority::Background));
+    }
+
+    size_t failures = 0;
+    for (size_t i = 0; i < cities; ++i) {
+        try {
+            weather[i].get();
+            forecasts[i].get();
+        }
+        catch (const std::exception&) {
+            failures++;
+        }
+    }
+    std::cout << "Recorded " << cities << " cities from " << baseUrl << " to " << cassette
+        << ", " << failures << " failed" << std::endl;
+    return 0;
+}
+
+static int replay(const std::string& cassette, bool fast) {
+    std::vector<CassetteEntry> entries = Cassette::load(cassette);
+    WeatherAPI api("bench", nullptr,
+        std::make_unique<CassetteReplayer>(cassette, fast ? ReplayTiming::AsFastAsPossible : ReplayTiming::Original));
+    configureForBenchmark(api, entries.size());
+    WeatherData weatherData;
+
+    // Applied in request order once everything is issued, so the issuing loop keeps the recorded pacing
+    std::vector<std::function<void()>> updates;
+    size_t skipped = 0;
+    auto start = Clock::now();
+
+    for (const auto& entry : entries) {
+        if (!fast) {
+            std::this_thread::sleep_until(start + std::chrono::microseconds(entry.startMicros));
+        }
+
+        httplib::Params params;
+        auto query = entry.path.find('?');
+        if (query != std::string::npos) {
+            httplib::detail::parse_query_text(entry.path.substr(query + 1), params);
+        }
+        auto param = [&params](const char* name) {
+            auto it = params.find(name);
+            return it == params.end() ? std::string() : it->second;
+        };
+        std::string endpoint = entry.path.substr(0, query);
+
+        if (endpoint == "/data/2.5/weather") {
+            auto fetched = std::make_shared<Future<WeatherInfo>>(api.getCurrentWeather(param("q"), RequestPriority::Background));
+            updates.push_back([fetched, &weatherData]() { weatherData.updateCurrentWeather(fetched->get()); });
+        }
+        else if (endpoint == "/data/2.5/forecast") {
+            std::string city = param("q");
+            int days = std::max(1, std::atoi(param("cnt").c_str()) / 8);
+            auto fetched = std::make_shared<Future<std::vector<ForecastInfo>>>(
+                api.getForecast(city, days, RequestPriority::Background));
+            updates.push_back([fetched, city, &weatherData]() { weatherData.updateForecast(city, fetched->get()); });
+        }
+        else if (endpoint == "/geo/1.0/direct") {
+            auto fetched = std::make_shared<Future<std::vector<std::string>>>(api.searchCity(param("q")));
+            updates.push_back([fetched]() { fetched->get(); });
+        }
+        else {
+            // Group queries need the city IDs learned from earlier responses; not reissued
+            skipped++;
+        }
+    }
+
+    size_t failures = 0;
+    for (auto& update : updates) {
+        try {
+            update();
+        }
+        catch (const std::exception&) {
+            failures++;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    double recordedSeconds = entries.empty() ? 0.0 : (entries.back().startMicros + entries.back().totalMicros) / 1e6;
+    auto stats = api.getPoolStats();
+    std::cout << "Replayed " << updates.size() << " requests (" << skipped << " skipped) in " << seconds
+        << " s, recorded " << recordedSeconds << " s; " << (updates.size() / seconds) << " req/s, "
+        << failures << " failed, " << stats.misses << " unmatched, "
+        << weatherData.getAllCities().size() << " cities updated" << std::endl;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        std::string mode = argc > 1 ? argv[1] : "";
+        if (mode == "record" && argc > 2) {
+            return record(argv[2], argc > 3 ? std::stoul(argv[3]) : 200, argc > 4 ? argv[4] : "");
+        }
+        if (mode == "replay" && argc > 2) {
+            return replay(argv[2], argc > 3 && std::string(argv[3]) == "--fast");
+        }
+        std::cerr << "Usage: ReplayBenchmark record <cassette> [cities] [base url]" << std::endl
+            << "       ReplayBenchmark replay <cassette> [--fast]" << std::endl;
+        return 1;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
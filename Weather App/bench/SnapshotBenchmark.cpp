@@ -0,0 +1,233 @@
+/**
+ * @file SnapshotBenchmark.cpp
+ * @brief Render-thread read latency under writer contention: RCU snapshots against the mutex-and-copy WeatherData
+ *
+ * Usage: SnapshotBenchmark [writers] [seconds] [cities]
+ * Writer threads keep storing fresh current weather and a 40-entry forecast
+ * for random cities, as refreshes do. One reader wakes at 60 Hz and does what
+ * a frame does: list the cities, then read the selected city's current weather
+ * and forecast. Reported are the reader's time per frame and the writers'
+ * update rate, for the locked store the app used before and for WeatherData.
+ */
+#include "WeatherData.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// WeatherData as it was: two maps behind two mutexes keyed by name, readers copy out
+class LockedWeatherData {
+private:
+    std::unordered_map<std::string, WeatherInfo> currentWeather;
+    std::unordered_map<std::string, std::vector<ForecastInfo>> forecasts;
+    mutable std::mutex weatherMutex;
+    mutable std::mutex forecastMutex;
+
+public:
+    using Key = std::string;
+
+    Key key(const std::string& cityName) { return cityName; }
+
+    void updateCurrentWeather(const Key&, const WeatherInfo& info) {
+        std::lock_guard<std::mutex> lock(weatherMutex);
+        currentWeather[info.cityName] = info;
+    }
+
+    void updateForecast(const std::string& cityName, const std::vector<ForecastInfo>& forecastData) {
+        std::lock_guard<std::mutex> lock(forecastMutex);
+        forecasts[cityName] = forecastData;
+    }
+
+    bool getCurrentWeather(const std::string& cityName, WeatherInfo& info) const {
+        std::lock_guard<std::mutex> lock(weatherMutex);
+        auto it = currentWeather.find(cityName);
+        if (it != currentWeather.end()) {
+            info = it->second;
+            return true;
+        }
+        return false;
+    }
+
+    bool getForecast(const std::string& cityName, std::vector<ForecastInfo>& forecastData) const {
+        std::lock_guard<std::mutex> lock(forecastMutex);
+        auto it = forecasts.find(cityName);
+        if (it != forecasts.end()) {
+            forecastData = it->second;
+            return true;
+        }
+        return false;
+    }
+
+    std::vector<std::string> getAllCities() const {
+        std::lock_guard<std::mutex> lock(weatherMutex);
+        std::vector<std::string> cities;
+        cities.reserve(currentWeather.size());
+        for (const auto& pair : currentWeather) {
+            cities.push_back(pair.first);
+        }
+        return cities;
+    }
+};
+
+// WeatherData keyed by the IDs its registry hands out, as the app uses it
+class IdWeatherData : public WeatherData {
+public:
+    using Key = CityId;
+
+    Key key(const std::string& cityName) { return getRegistry()->intern(cityName); }
+};
+
+// One frame's reads; returns something derived from them so nothing is optimized away
+static double readFrame(const LockedWeatherData& store, const std::string& selected) {
+    WeatherInfo info;
+    std::vector<ForecastInfo> forecast;
+    double sum = double(store.getAllCities().size());
+    if (store.getCurrentWeather(selected, info)) {
+        sum += info.temperature;
+    }
+    if (store.getForecast(selected, forecast)) {
+        sum += forecast.back().temperature;
+    }
+    return sum;
+}
+
+static double readFrame(const IdWeatherData& store, CityId selected) {
+    double sum = double(store.getAllCityIds().size());
+    if (auto snapshot = store.getSnapshot(selected)) {
+        if (snapshot->current) {
+            sum += snapshot->current->temperature;
+        }
+        if (snapshot->forecast) {
+            sum += snapshot->forecast->back().temperature;
+        }
+    }
+    return sum;
+}
+
+static WeatherInfo makeWeather(const std::string& city) {
+    WeatherInfo info{};
+    info.cityName = city;
+    info.countryCode = "GB";
+    info.temperature = 12.5;
+    info.weatherMain = "Clouds";
+    info.weatherDescription = "scattered clouds over the whole area";
+    info.weatherIcon = "03d";
+    info.lastUpdated = "2024-01-01 12:00:00";
+    return info;
+}
+
+static std::vector<ForecastInfo> makeForecast() {
+    std::vector<ForecastInfo> forecast(40);
+    for (size_t i = 0; i < forecast.size(); ++i) {
+        forecast[i].dateTime = 1700000000 + static_cast<long long>(i) * 10800;
+        forecast[i].temperature = 10.0 + i % 8;
+        forecast[i].weatherMain = "Rain";
+        forecast[i].weatherDescription = "light rain during the afternoon";
+        forecast[i].weatherIcon = "10d";
+    }
+    return forecast;
+}
+
+struct RunResult {
+    std::vector<double> frameMicros;
+    double updatesPerSecond = 0;
+};
+
+template<class Store>
+static RunResult run(size_t writers, double seconds, const std::vector<std::string>& names) {
+    Store store;
+    const std::vector<ForecastInfo> forecast = makeForecast();
+    std::vector<typename Store::Key> cities;
+    for (const auto& name : names) {
+        cities.push_back(store.key(name));
+        store.updateCurrentWeather(cities.back(), makeWeather(name));
+        store.updateForecast(cities.back(), forecast);
+    }
+
+    std::atomic<bool> done{ false };
+    std::atomic<size_t> updates{ 0 };
+    std::vector<std::thread> threads;
+    for (size_t w = 0; w < writers; ++w) {
+        threads.emplace_back([&, w]() {
+            std::mt19937 random(static_cast<unsigned>(w));
+            size_t count = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                // A fresh forecast each time, as a parsed response would be
+                size_t index = random() % cities.size();
+                std::vector<ForecastInfo> fetched = forecast;
+                store.updateCurrentWeather(cities[index], makeWeather(names[index]));
+                store.updateForecast(cities[index], std::move(fetched));
+                count++;
+            }
+            updates += count;
+            });
+    }
+
+    RunResult result;
+    double sink = 0;
+    auto frame = std::chrono::microseconds(16667);
+    auto start = Clock::now();
+    auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    for (auto next = start; next < end; next += frame) {
+        std::this_thread::sleep_until(next);
+        auto before = Clock::now();
+        sink += readFrame(store, cities.front());
+        result.frameMicros.push_back(std::chrono::duration<double, std::micro>(Clock::now() - before).count());
+    }
+    done.store(true);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    result.updatesPerSecond = updates.load() / std::chrono::duration<double>(Clock::now() - start).count();
+    if (sink < 0) {
+        std::cout << sink << std::endl;
+    }
+    return result;
+}
+
+static double percentile(std::vector<double> values, double fraction) {
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()))];
+}
+
+static void report(const std::string& name, const RunResult& result) {
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(1)
+        << std::setw(10) << percentile(result.frameMicros, 0.5)
+        << std::setw(10) << percentile(result.frameMicros, 0.99)
+        << std::setw(10) << percentile(result.frameMicros, 1.0)
+        << std::setprecision(0) << std::setw(14) << result.updatesPerSecond << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        size_t writers = argc > 1 ? std::stoul(argv[1]) : std::max(1u, std::thread::hardware_concurrency());
+        double seconds = argc > 2 ? std::stod(argv[2]) : 3.0;
+        size_t cityCount = argc > 3 ? std::stoul(argv[3]) : 200;
+
+        std::vector<std::string> cities;
+        for (size_t i = 0; i < cityCount; ++i) {
+            cities.push_back("City " + std::to_string(i));
+        }
+
+        std::cout << writers << " writers, " << cityCount << " cities, " << seconds << " s at 60 Hz" << std::endl;
+        std::cout << std::left << std::setw(10) << "store" << std::right
+            << std::setw(10) << "p50 us" << std::setw(10) << "p99 us" << std::setw(10) << "max us"
+            << std::setw(14) << "updates/s" << std::endl;
+        report("locked", run<LockedWeatherData>(writers, seconds, cities));
+        report("rcu", run<IdWeatherData>(writers, seconds, cities));
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,146 @@
+/**
+ * @file TaskBenchmark.cpp
+ * @brief Heap allocations and time per task: UniqueTask and pooled futures against std::function and packaged_task
+ *
+ * Usage: TaskBenchmark [tasks] [threads]
+ * The callables look like the app's refresh lambdas: a pointer and a short
+ * city name. Every allocation in the process is counted through a replaced
+ * operator new.
+ *   wrap     - wrap the lambda, move it twice (into and out of a queue) and call it
+ *   enqueue  - submit it through ThreadPool and wait for the futures, in batches
+ *              of 256; "before" is the old std::bind + make_shared<packaged_task>
+ *              + std::function path, "after" is ThreadPool::enqueue
+ */
+#include "ThreadPool.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static std::atomic<size_t> allocations{ 0 };
+
+void* operator new(size_t bytes) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* block = std::malloc(bytes ? bytes : 1)) {
+        return block;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* block) noexcept {
+    std::free(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+    std::free(block);
+}
+
+struct Counters {
+    std::atomic<size_t> refreshed{ 0 };
+};
+
+struct RunResult {
+    double nsPerTask = 0;
+    double allocationsPerTask = 0;
+};
+
+template<class Body>
+static RunResult measure(size_t tasks, Body body) {
+    size_t before = allocations.load();
+    auto start = Clock::now();
+    body();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return { seconds * 1e9 / tasks, double(allocations.load() - before) / tasks };
+}
+
+template<class Wrapper>
+static RunResult runWrap(size_t tasks, const std::vector<std::string>& cities) {
+    Counters counters;
+    return measure(tasks, [&]() {
+        for (size_t i = 0; i < tasks; ++i) {
+            Wrapper queued([&counters, city = cities[i % cities.size()]]() { counters.refreshed += city.size(); });
+            Wrapper taken(std::move(queued));
+            taken();
+        }
+    });
+}
+
+// ThreadPool::enqueue as it was: three layers of wrapping around the callable
+template<class F>
+static auto legacyEnqueue(ThreadPool& pool, F&& f) -> std::future<std::invoke_result_t<F>> {
+    using return_type = std::invoke_result_t<F>;
+    auto task = std::make_shared<std::packaged_task<return_type()>>(std::bind(std::forward<F>(f)));
+    std::future<return_type> result = task->get_future();
+    std::function<void()> wrapped = [task]() { (*task)(); };
+    pool.post(std::move(wrapped));
+    return result;
+}
+
+template<bool Legacy>
+static RunResult runEnqueue(size_t tasks, size_t threads, const std::vector<std::string>& cities) {
+    constexpr size_t kBatch = 256;
+    ThreadPool pool(threads);
+    Counters counters;
+    std::vector<std::future<size_t>> futures;
+    futures.reserve(kBatch);
+
+    auto submitBatches = [&](size_t count) {
+        for (size_t i = 0; i < count; i += kBatch) {
+            for (size_t j = i; j < std::min(count, i + kBatch); ++j) {
+                auto refresh = [&counters, city = cities[j % cities.size()]]() { return counters.refreshed += city.size(); };
+                if constexpr (Legacy) {
+                    futures.push_back(legacyEnqueue(pool, std::move(refresh)));
+                }
+                else {
+                    futures.push_back(pool.enqueue(std::move(refresh)));
+                }
+            }
+            for (auto& future : futures) {
+                future.get();
+            }
+            futures.clear();
+        }
+    };
+
+    // One batch to warm the block pools and grow the worker rings
+    submitBatches(kBatch);
+    return measure(tasks, [&]() { submitBatches(tasks); });
+}
+
+static void report(const std::string& name, const RunResult& before, const RunResult& after) {
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed
+        << std::setprecision(1) << std::setw(12) << before.nsPerTask << std::setw(12) << after.nsPerTask
+        << std::setprecision(2) << std::setw(14) << before.allocationsPerTask << std::setw(14) << after.allocationsPerTask
+        << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        size_t tasks = argc > 1 ? std::stoul(argv[1]) : 1000000;
+        size_t threads = argc > 2 ? std::stoul(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+        const std::vector<std::string> cities = { "London", "Tel Aviv", "New York", "Jerusalem", "Paris", "Tokyo" };
+
+        std::cout << tasks << " tasks, " << threads << " pool threads, sizeof(std::function) "
+            << sizeof(std::function<void()>) << ", sizeof(UniqueTask) " << sizeof(UniqueTask) << std::endl;
+        std::cout << std::left << std::setw(10) << "case" << std::right
+            << std::setw(12) << "ns before" << std::setw(12) << "ns after"
+            << std::setw(14) << "allocs before" << std::setw(14) << "allocs after" << std::endl;
+
+        report("wrap", runWrap<std::function<void()>>(tasks, cities), runWrap<UniqueTask>(tasks, cities));
+        report("enqueue", runEnqueue<true>(tasks, threads, cities), runEnqueue<false>(tasks, threads, cities));
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
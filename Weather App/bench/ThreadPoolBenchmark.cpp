@@ -0,0 +1,240 @@
+/**
+ * @file ThreadPoolBenchmark.cpp
+ * @brief Throughput of the work-stealing ThreadPool against the single-lock queue it replaced, by thread count
+ *
+ * Usage: ThreadPoolBenchmark [tasks] [max threads] [work ns]
+ * Each run pushes small tasks that spin for about the given time:
+ *   post   - one submission per task from an outside thread
+ *   bulk   - the same tasks submitted in batches of 256
+ *   spawn  - tasks that submit their own children from inside the pool
+ * Thread counts go from 1 up to the maximum (the hardware concurrency by
+ * default) in powers of two. A second table shows how long one interactive
+ * task waits to start when it is posted right behind a refresh-sized burst
+ * of background tasks: FIFO in the single-lock queue, its own lane in ThreadPool.
+ */
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// The pool the app used before: one std::queue behind one mutex, notify_one per task
+class SingleLockPool {
+public:
+    using Task = std::function<void()>;
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex queueMutex;
+    std::condition_variable condition;
+    bool stop = false;
+
+public:
+    explicit SingleLockPool(size_t numThreads) {
+        for (size_t i = 0; i < numThreads; ++i) {
+            workers.emplace_back([this] {
+                while (true) {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock<std::mutex> lock(queueMutex);
+                        condition.wait(lock, [this] { return stop || !tasks.empty(); });
+                        if (stop && tasks.empty()) {
+                            return;
+                        }
+                        task = std::move(tasks.front());
+                        tasks.pop();
+                    }
+                    task();
+                }
+                });
+        }
+    }
+
+    ~SingleLockPool() {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            stop = true;
+        }
+        condition.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    void post(std::function<void()> task, RequestPriority = RequestPriority::Background) {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            tasks.push(std::move(task));
+        }
+        condition.notify_one();
+    }
+
+    void postBulk(std::vector<std::function<void()>> batch) {
+        for (auto& task : batch) {
+            post(std::move(task));
+        }
+    }
+};
+
+// Counts finished tasks and wakes the benchmark after the last one
+class Countdown {
+private:
+    std::atomic<size_t> remaining;
+    std::mutex mutex;
+    std::condition_variable finished;
+
+public:
+    explicit Countdown(size_t count) : remaining(count) {}
+
+    void done() {
+        if (remaining.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.notify_all();
+        }
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return remaining.load() == 0; });
+    }
+};
+
+static void spin(std::chrono::nanoseconds work) {
+    auto until = Clock::now() + work;
+    while (Clock::now() < until) {
+    }
+}
+
+template<class Pool>
+static double runPost(size_t threads, size_t tasks, std::chrono::nanoseconds work) {
+    Pool pool(threads);
+    Countdown countdown(tasks);
+    auto start = Clock::now();
+    for (size_t i = 0; i < tasks; ++i) {
+        pool.post([&countdown, work]() { spin(work); countdown.done(); });
+    }
+    countdown.wait();
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template<class Pool>
+static double runBulk(size_t threads, size_t tasks, std::chrono::nanoseconds work) {
+    constexpr size_t kBatch = 256;
+    Pool pool(threads);
+    Countdown countdown(tasks);
+    auto start = Clock::now();
+    for (size_t i = 0; i < tasks; i += kBatch) {
+        std::vector<typename Pool::Task> batch;
+        for (size_t j = i; j < std::min(tasks, i + kBatch); ++j) {
+            batch.emplace_back([&countdown, work]() { spin(work); countdown.done(); });
+        }
+        pool.postBulk(std::move(batch));
+    }
+    countdown.wait();
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// A binary tree of tasks: each one spins, then submits two children until the leaves
+template<class Pool>
+static void spawn(Pool& pool, Countdown& countdown, size_t depth, std::chrono::nanoseconds work) {
+    spin(work);
+    if (depth > 0) {
+        pool.post([&pool, &countdown, depth, work]() { spawn(pool, countdown, depth - 1, work); });
+        pool.post([&pool, &countdown, depth, work]() { spawn(pool, countdown, depth - 1, work); });
+    }
+    countdown.done();
+}
+
+template<class Pool>
+static double runSpawn(size_t threads, size_t tasks, std::chrono::nanoseconds work) {
+    size_t depth = 0;
+    while ((size_t(2) << (depth + 1)) - 1 <= tasks) {
+        depth++;
+    }
+    size_t nodes = (size_t(2) << depth) - 1;
+
+    Pool pool(threads);
+    Countdown countdown(nodes);
+    auto start = Clock::now();
+    pool.post([&pool, &countdown, depth, work]() { spawn(pool, countdown, depth, work); });
+    countdown.wait();
+    // Report per requested task so the columns compare
+    return std::chrono::duration<double>(Clock::now() - start).count() * tasks / nodes;
+}
+
+// Time from posting one interactive task behind a burst of background ones until it starts
+template<class Pool>
+static double runSelection(size_t threads, size_t burst, std::chrono::nanoseconds work) {
+    Pool pool(threads);
+    Countdown countdown(burst + 1);
+    for (size_t i = 0; i < burst; ++i) {
+        pool.post([&countdown, work]() { spin(work); countdown.done(); }, RequestPriority::Background);
+    }
+    auto posted = Clock::now();
+    std::atomic<Clock::rep> started{ 0 };
+    pool.post([&countdown, &started]() {
+        started = Clock::now().time_since_epoch().count();
+        countdown.done();
+        }, RequestPriority::Interactive);
+    countdown.wait();
+    return std::chrono::duration<double, std::milli>(Clock::duration(started.load()) - posted.time_since_epoch()).count();
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        size_t tasks = argc > 1 ? std::stoul(argv[1]) : 200000;
+        size_t maxThreads = argc > 2 ? std::stoul(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+        auto work = std::chrono::nanoseconds(argc > 3 ? std::stoll(argv[3]) : 500);
+
+        std::cout << tasks << " tasks of ~" << work.count() << " ns, hardware concurrency "
+            << std::thread::hardware_concurrency() << ", thousands of tasks/s" << std::endl;
+        std::cout << std::setw(8) << "threads"
+            << std::setw(12) << "post 1lock" << std::setw(12) << "post steal"
+            << std::setw(12) << "bulk 1lock" << std::setw(12) << "bulk steal"
+            << std::setw(12) << "spawn 1lock" << std::setw(12) << "spawn steal" << std::endl;
+
+        std::vector<size_t> threadCounts;
+        for (size_t threads = 1; threads < maxThreads; threads *= 2) {
+            threadCounts.push_back(threads);
+        }
+        threadCounts.push_back(maxThreads);
+
+        auto rate = [tasks](double seconds) { return tasks / seconds / 1000; };
+        for (size_t threads : threadCounts) {
+            std::cout << std::setw(8) << threads << std::fixed << std::setprecision(0)
+                << std::setw(12) << rate(runPost<SingleLockPool>(threads, tasks, work))
+                << std::setw(12) << rate(runPost<ThreadPool>(threads, tasks, work))
+                << std::setw(12) << rate(runBulk<SingleLockPool>(threads, tasks, work))
+                << std::setw(12) << rate(runBulk<ThreadPool>(threads, tasks, work))
+                << std::setw(12) << rate(runSpawn<SingleLockPool>(threads, tasks, work))
+                << std::setw(12) << rate(runSpawn<ThreadPool>(threads, tasks, work)) << std::endl;
+        }
+
+        constexpr size_t kBurst = 10000;
+        auto selectionWork = std::max(work, std::chrono::nanoseconds(10000));
+        std::cout << std::endl << "interactive task behind " << kBurst << " background tasks of ~"
+            << selectionWork.count() << " ns, ms until it starts" << std::endl;
+        std::cout << std::setw(8) << "threads" << std::setw(12) << "fifo" << std::setw(12) << "lanes" << std::endl;
+        for (size_t threads : threadCounts) {
+            std::cout << std::setw(8) << threads << std::fixed << std::setprecision(2)
+                << std::setw(12) << runSelection<SingleLockPool>(threads, kBurst, selectionWork)
+                << std::setw(12) << runSelection<ThreadPool>(threads, kBurst, selectionWork) << std::endl;
+        }
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
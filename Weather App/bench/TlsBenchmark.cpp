@@ -0,0 +1,147 @@
+/**
+ * @file TlsBenchmark.cpp
+ * @brief Cost of HTTPS against plaintext on the epoll transport, with warm connections and resumed sessions
+ *
+ * Usage: TlsBenchmark [requests] [concurrency] [server latency ms]
+ * Two MockWeatherServers, one plain and one with a self-signed certificate, are
+ * started in-process, and another pair that closes every connection after one
+ * response. Requests go out in waves of the given concurrency. Warm runs keep
+ * their connections; on cold runs every request pays for a new connection and
+ * handshake, either a full one or one resuming the session ticket of an
+ * earlier connection.
+ */
+#include "EventHttpClient.h"
+#include "MockWeatherServer.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct RunResult {
+    double seconds = 0;
+    size_t failures = 0;
+    std::string firstError;
+    std::vector<double> latenciesMs;
+    HttpPoolStats stats;
+};
+
+static double percentile(std::vector<double> values, double fraction) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()))];
+}
+
+static RunResult run(const std::string& host, const TlsOptions& tls, size_t requests, size_t concurrency) {
+    RunResult result;
+    EventHttpClient transport(1, tls);
+    transport.configure(concurrency, std::chrono::seconds(30));
+
+    std::mutex mutex;
+    std::condition_variable waveDone;
+    auto start = Clock::now();
+
+    for (size_t sent = 0; sent < requests;) {
+        size_t wave = std::min(concurrency, requests - sent);
+        size_t remaining = wave;
+        for (size_t i = 0; i < wave; ++i, ++sent) {
+            HttpTransport::Request request;
+            request.host = host;
+            request.path = "/data/2.5/weather?q=City" + std::to_string(sent % 1000) + "&appid=bench&units=metric";
+            auto started = Clock::now();
+            transport.get(std::move(request),
+                [](const HttpTransport::Response&) { return true; },
+                [](const char*, size_t) { return true; },
+                [&, started](HttpTransport::Response response) {
+                    double latency = std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+                    std::lock_guard<std::mutex> lock(mutex);
+                    result.latenciesMs.push_back(latency);
+                    if (response.status != 200) {
+                        result.failures++;
+                        if (result.firstError.empty()) {
+                            result.firstError = response.error;
+                        }
+                    }
+                    if (--remaining == 0) {
+                        waveDone.notify_all();
+                    }
+                });
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        waveDone.wait(lock, [&remaining] { return remaining == 0; });
+    }
+
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.stats = transport.getStats();
+    return result;
+}
+
+static void report(const std::string& name, size_t requests, const RunResult& result) {
+    std::cout << std::left << std::setw(28) << name << std::right
+        << std::fixed << std::setprecision(0) << std::setw(10) << (requests / result.seconds)
+        << std::setprecision(2) << std::setw(10) << percentile(result.latenciesMs, 0.5)
+        << std::setw(10) << percentile(result.latenciesMs, 0.99)
+        << std::setw(8) << result.stats.misses << std::setw(8) << result.stats.tlsHandshakes
+        << std::setw(8) << result.stats.tlsResumptions << std::setw(8) << result.failures << std::endl;
+    if (!result.firstError.empty()) {
+        std::cout << "  first error: " << result.firstError << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        size_t requests = argc > 1 ? std::stoul(argv[1]) : 4000;
+        size_t concurrency = argc > 2 ? std::stoul(argv[2]) : 16;
+        int latencyMs = argc > 3 ? std::stoi(argv[3]) : 0;
+
+        MockServerConfig config;
+        config.latency.median = std::chrono::milliseconds(latencyMs);
+        config.latency.p99 = config.latency.median;
+        config.threads = std::max<size_t>(64, concurrency * 2);
+        MockWeatherServer plainServer(config);
+        config.keepAliveRequests = 1;
+        MockWeatherServer coldPlainServer(config);
+        config.tls = true;
+        MockWeatherServer coldTlsServer(config);
+        config.keepAliveRequests = MockServerConfig().keepAliveRequests;
+        MockWeatherServer tlsServer(config);
+        for (MockWeatherServer* server : { &plainServer, &coldPlainServer, &coldTlsServer, &tlsServer }) {
+            server->start();
+        }
+
+        // The client trusts the stand-ins through their certificates, like any other CA
+        std::string caFile = "tls_benchmark_ca.pem";
+        std::ofstream(caFile, std::ios::binary) << tlsServer.getCertificatePem() << coldTlsServer.getCertificatePem();
+        TlsOptions resumed;
+        resumed.caFile = caFile;
+        TlsOptions full = resumed;
+        full.resumeSessions = false;
+
+        std::cout << requests << " requests in waves of " << concurrency << ", " << latencyMs << " ms server latency" << std::endl;
+        std::cout << std::left << std::setw(28) << "run" << std::right << std::setw(10) << "req/s"
+            << std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms" << std::setw(8) << "conns"
+            << std::setw(8) << "full" << std::setw(8) << "resumed" << std::setw(8) << "failed" << std::endl;
+
+        report("http, warm", requests, run(plainServer.getBaseUrl(), resumed, requests, concurrency));
+        report("https, warm", requests, run(tlsServer.getBaseUrl(), resumed, requests, concurrency));
+        report("http, cold", requests, run(coldPlainServer.getBaseUrl(), resumed, requests, concurrency));
+        report("https, cold, full handshake", requests, run(coldTlsServer.getBaseUrl(), full, requests, concurrency));
+        report("https, cold, resumed", requests, run(coldTlsServer.getBaseUrl(), resumed, requests, concurrency));
+
+        std::remove(caFile.c_str());
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,165 @@
+/**
+ * @file TransportBenchmark.cpp
+ * @brief Throughput and latency of the epoll transport against blocking clients on a thread pool
+ *
+ * Usage: TransportBenchmark [requests] [server latency ms] [pipeline depth] [host:port]
+ * Without a host, a MockWeatherServer answering after the given latency is
+ * started in-process. That server does not support pipelining, so only raise
+ * the depth against an external server.
+ */
+#include "BlockingHttpTransport.h"
+#include "EventHttpClient.h"
+#include "MockWeatherServer.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct RunResult {
+    double seconds = 0;
+    size_t failures = 0;
+    std::vector<double> latenciesMs;
+};
+
+// Collects completions from any thread and wakes the benchmark when all arrived
+class Completions {
+private:
+    std::mutex mutex;
+    std::condition_variable allDone;
+    size_t remaining;
+    RunResult& result;
+
+public:
+    Completions(size_t count, RunResult& result) : remaining(count), result(result) {}
+
+    void record(Clock::time_point started, const HttpTransport::Response& response) {
+        double latency = std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+        std::lock_guard<std::mutex> lock(mutex);
+        result.latenciesMs.push_back(latency);
+        if (response.status != 200) {
+            result.failures++;
+        }
+        if (--remaining == 0) {
+            allDone.notify_all();
+        }
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        allDone.wait(lock, [this] { return remaining == 0; });
+    }
+};
+
+static HttpTransport::Request makeRequest(const std::string& host, size_t index) {
+    HttpTransport::Request request;
+    request.host = host;
+    request.path = "/data/2.5/weather?q=City" + std::to_string(index % 1000) + "&appid=bench&units=metric";
+    return request;
+}
+
+// All requests are submitted at once; the engine keeps them in flight on its own thread
+static RunResult runEventLoop(const std::string& host, size_t requests, size_t connections, size_t pipelineDepth) {
+    RunResult result;
+    Completions completions(requests, result);
+    EventHttpClient transport(pipelineDepth);
+    transport.configure(connections, std::chrono::seconds(30));
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < requests; ++i) {
+        auto started = Clock::now();
+        transport.get(makeRequest(host, i),
+            [](const HttpTransport::Response&) { return true; },
+            [](const char*, size_t) { return true; },
+            [&completions, started](HttpTransport::Response response) { completions.record(started, response); });
+    }
+    completions.wait();
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return result;
+}
+
+// Blocking clients: concurrency is bounded by the number of pool threads
+static RunResult runBlocking(const std::string& host, size_t requests, size_t threads) {
+    RunResult result;
+    Completions completions(requests, result);
+    BlockingHttpTransport transport;
+    transport.configure(threads, std::chrono::seconds(30));
+
+    auto start = Clock::now();
+    {
+        ThreadPool pool(threads);
+        for (size_t i = 0; i < requests; ++i) {
+            auto started = Clock::now();
+            pool.post([&transport, &completions, &host, i, started]() {
+                transport.get(makeRequest(host, i),
+                    [](const HttpTransport::Response&) { return true; },
+                    [](const char*, size_t) { return true; },
+                    [&completions, started](HttpTransport::Response response) { completions.record(started, response); });
+                });
+        }
+        completions.wait();
+    }
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return result;
+}
+
+static double percentile(std::vector<double> values, double fraction) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()))];
+}
+
+static void report(const std::string& name, size_t ioThreads, size_t requests, const RunResult& result) {
+    std::cout << std::left << std::setw(22) << name
+        << std::right << std::setw(8) << ioThreads
+        << std::fixed << std::setprecision(0) << std::setw(12) << (requests / result.seconds)
+        << std::setprecision(1) << std::setw(10) << percentile(result.latenciesMs, 0.5)
+        << std::setw(10) << percentile(result.latenciesMs, 0.99)
+        << std::setw(10) << result.failures << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        size_t requests = argc > 1 ? std::stoul(argv[1]) : 5000;
+        int latencyMs = argc > 2 ? std::stoi(argv[2]) : 20;
+        size_t pipelineDepth = argc > 3 ? std::stoul(argv[3]) : 1;
+        std::string host = argc > 4 ? argv[4] : "";
+
+        // Stand-in for the provider: fixed latency, keep-alive, one thread per connection
+        MockServerConfig config;
+        config.latency.median = std::chrono::milliseconds(latencyMs);
+        config.threads = 512;
+        MockWeatherServer server(config);
+        if (host.empty()) {
+            server.start();
+            host = server.getBaseUrl();
+        }
+
+        std::cout << requests << " requests, " << latencyMs << " ms server latency, pipeline depth "
+            << pipelineDepth << ", host " << host << std::endl;
+        std::cout << std::left << std::setw(22) << "engine"
+            << std::right << std::setw(8) << "threads" << std::setw(12) << "req/s"
+            << std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms" << std::setw(10) << "failed" << std::endl;
+
+        report("blocking, 8 conns", 8, requests, runBlocking(host, requests, 8));
+        report("blocking, 64 conns", 64, requests, runBlocking(host, requests, 64));
+        report("epoll, 8 conns", 1, requests, runEventLoop(host, requests, 8, pipelineDepth));
+        report("epoll, 64 conns", 1, requests, runEventLoop(host, requests, 64, pipelineDepth));
+        report("epoll, 256 conns", 1, requests, runEventLoop(host, requests, 256, pipelineDepth));
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
\ No newline at end of file
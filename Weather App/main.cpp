@@ -3,11 +3,46 @@
  * @brief Main entry point for the Weather App
  */
 #include "WeatherApp.h"
+#include "CassetteTransport.h"
 #include <iostream>
+#include <string>
 
 int main(int argc, char* argv[]) {
     try {
-        WeatherApp app;
+        // --base-url host:port points the app at a local stand-in server (https://host:port
+        // with --ca-file cert.pem for a TLS one), --record file saves every exchange,
+        // --replay file (--fast) answers from a recording
+        std::string baseUrl;
+        std::unique_ptr<HttpTransport> transport;
+        TlsOptions tls;
+        bool fast = false;
+        for (int i = 1; i < argc; ++i) {
+            if (std::string(argv[i]) == "--fast") {
+                fast = true;
+            }
+            else if (std::string(argv[i]) == "--ca-file" && i + 1 < argc) {
+                tls.caFile = argv[i + 1];
+            }
+        }
+        for (int i = 1; i + 1 < argc; ++i) {
+            std::string option = argv[i];
+            if (option == "--base-url") {
+                baseUrl = argv[i + 1];
+            }
+            else if (option == "--record") {
+                transport = std::make_unique<CassetteRecorder>(argv[i + 1], WeatherAPI::createDefaultTransport(tls));
+            }
+            else if (option == "--replay") {
+                transport = std::make_unique<CassetteReplayer>(argv[i + 1],
+                    fast ? ReplayTiming::AsFastAsPossible : ReplayTiming::Original);
+            }
+        }
+
+        if (!transport && !tls.caFile.empty()) {
+            transport = WeatherAPI::createDefaultTransport(tls);
+        }
+
+        WeatherApp app(baseUrl, std::move(transport));
         app.initialize();
         app.run();
         return 0;